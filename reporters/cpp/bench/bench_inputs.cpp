@@ -0,0 +1,127 @@
+#include "bench_inputs.hpp"
+#include <chrono>
+
+namespace tdd_guard::bench {
+
+namespace {
+
+constexpr std::size_t TESTS_PER_SUITE = 100;
+constexpr std::string_view FAILURE_MESSAGE =
+    "tests/suite_test.cpp:42\nValue of: x\n  Actual: 1\nExpected: 2";
+
+auto append_diagnostic(std::string& out, std::size_t block) -> void {
+    const auto module = std::to_string(block % 500);
+    const auto line = std::to_string(10 + block % 900);
+    const bool colored = block % 4 == 0;
+
+    out += "[ " + std::to_string(block % 100) + "%] Building CXX object CMakeFiles/app.dir/src/module_" +
+           module + ".cpp.o\n";
+    out += "In file included from src/module_" + module + ".cpp:3:\n";
+    if (colored) {
+        out += "\x1b[01m\x1b[Ksrc/module_" + module + ".hpp:" + line +
+               ":17:\x1b[m\x1b[K \x1b[01;31m\x1b[Kerror: \x1b[m\x1b[K'value' was not declared in this scope\n";
+    } else {
+        out += "src/module_" + module + ".hpp:" + line + ":17: error: 'value' was not declared in this scope\n";
+    }
+    out += "  " + line + " |     return value + offset;\n";
+    out += "      |            ^~~~~\n";
+    out += "src/module_" + module + ".hpp:" + line + ":5: note: suggested alternative: 'values'\n";
+    out += "src/module_" + module + ".cpp:" + line + ":9: warning: unused variable 'tmp' [-Wunused-variable]\n";
+}
+
+} // anonymous namespace
+
+auto googletest_json(std::size_t tests) -> std::string {
+    std::string out = R"({"tests": )" + std::to_string(tests) +
+        R"(, "failures": 0, "timestamp": "2025-01-01T00:00:00Z", "name": "AllTests", "testsuites": [)";
+    for (std::size_t suite = 0; suite * TESTS_PER_SUITE < tests; ++suite) {
+        if (suite > 0) out += ",";
+        out += R"({"name": "Suite)" + std::to_string(suite) + R"(", "tests": 100, "testsuite": [)";
+        for (std::size_t i = 0; i < TESTS_PER_SUITE && suite * TESTS_PER_SUITE + i < tests; ++i) {
+            if (i > 0) out += ",";
+            out += R"({"name": "Test)" + std::to_string(i) +
+                   R"(", "file": "tests/suite_test.cpp", "line": 42, "status": "RUN", )"
+                   R"("result": "COMPLETED", "timestamp": "2025-01-01T00:00:00Z", "time": "0.001s")";
+            if (i % 10 == 0) {
+                out += R"(, "failures": [{"message": "tests/suite_test.cpp:42\nValue of: x\n  Actual: 1\nExpected: 2", "type": ""}])";
+            }
+            out += "}";
+        }
+        out += "]}";
+    }
+    return out + "]}";
+}
+
+auto catch2_json(std::size_t test_cases, std::size_t runs_per_case) -> std::string {
+    std::string out = R"({"version": 1, "metadata": {"name": "tests", "rng-seed": 1}, "test-run": {"test-cases": [)";
+    for (std::size_t tc = 0; tc < test_cases; ++tc) {
+        if (tc > 0) out += ",";
+        out += R"({"test-info": {"name": "Case)" + std::to_string(tc) +
+               R"(", "tags": ["gen"], "source-location": {"filename": "tests.cpp", "line": 1}}, "runs": [)";
+        for (std::size_t run = 0; run < runs_per_case; ++run) {
+            if (run > 0) out += ",";
+            out += R"({"run-idx": )" + std::to_string(run) +
+                   R"(, "path": [{"kind": "section", "name": "Case)" + std::to_string(tc) +
+                   R"(", "path": [{"kind": "section", "name": "value)" + std::to_string(run) +
+                   R"(", "path": [{"kind": "assertion", "status": true, "source-location": {"filename": "tests.cpp", "line": 2}}]}]},)"
+                   R"( {"kind": "assertion", "status": )" + (run % 4 == 0 ? "false" : "true") +
+                   R"(, "expression": {"original": "f(x) == 1", "expanded": "0 == 1"}}]})";
+        }
+        out += R"(], "totals": {"assertions": {"passed": )" + std::to_string(runs_per_case) +
+               R"(, "failed": )" + std::to_string(runs_per_case / 4) + "}}}";
+    }
+    return out + "]}}";
+}
+
+auto test_events(std::size_t tests) -> std::vector<TestEvent> {
+    std::vector<TestEvent> events;
+    events.reserve(tests);
+    for (std::size_t n = 0; n < tests; ++n) {
+        const auto i = n % TESTS_PER_SUITE;
+        TestEvent event;
+        event.name = "Test" + std::to_string(i);
+        event.full_name = "Suite" + std::to_string(n / TESTS_PER_SUITE) + "." + event.name;
+        if (i % 10 == 0) {
+            event.state = TestEvent::State::Failed;
+            event.failure_messages.emplace_back(FAILURE_MESSAGE);
+        } else {
+            event.state = TestEvent::State::Passed;
+        }
+        event.duration = std::chrono::microseconds(1000);
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+auto compiler_output(std::size_t bytes) -> CompilerOutput {
+    CompilerOutput output;
+    output.text.reserve(bytes + 1024);
+    for (std::size_t block = 0; output.text.size() < bytes; ++block) {
+        append_diagnostic(output.text, block);
+    }
+
+    const std::string_view text = output.text;
+    std::size_t start = 0;
+    while (start < text.size()) {
+        const auto end = text.find('\n', start);
+        output.lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return output;
+}
+
+auto test_count_label(std::size_t tests) -> std::string {
+    if (tests >= 1'000'000 && tests % 1'000'000 == 0) {
+        return std::to_string(tests / 1'000'000) + "M tests";
+    }
+    if (tests >= 1'000 && tests % 1'000 == 0) {
+        return std::to_string(tests / 1'000) + "k tests";
+    }
+    return std::to_string(tests) + " tests";
+}
+
+auto size_label(std::size_t bytes) -> std::string {
+    return std::to_string(bytes / MEGABYTE) + " MB";
+}
+
+} // namespace tdd_guard::bench
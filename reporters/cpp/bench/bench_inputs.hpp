@@ -0,0 +1,45 @@
+#pragma once
+
+#include "parser.hpp"
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tdd_guard::bench {
+
+// Scales run by default; the large ones are in test cases tagged [large],
+// which Catch2 skips unless asked for, e.g. `tdd-guard-cpp-bench [large]`
+constexpr std::array<std::size_t, 3> TEST_COUNTS = {1'000, 10'000, 100'000};
+constexpr std::array<std::size_t, 1> LARGE_TEST_COUNTS = {1'000'000};
+
+constexpr std::size_t MEGABYTE = 1024 * 1024;
+constexpr std::array<std::size_t, 2> OUTPUT_SIZES = {1 * MEGABYTE, 10 * MEGABYTE};
+constexpr std::array<std::size_t, 2> LARGE_OUTPUT_SIZES = {100 * MEGABYTE, 500 * MEGABYTE};
+
+// GoogleTest --gtest_output=json with 100 tests per suite and every tenth
+// test failing
+[[nodiscard]] auto googletest_json(std::size_t tests) -> std::string;
+
+// Catch2 --reporter json with every fourth run of a case failing
+[[nodiscard]] auto catch2_json(std::size_t test_cases, std::size_t runs_per_case) -> std::string;
+
+// The events googletest_json(tests) parses into
+[[nodiscard]] auto test_events(std::size_t tests) -> std::vector<TestEvent>;
+
+// GCC diagnostics with source excerpts, notes, warnings, build progress
+// and some colored lines, repeated to at least the given size
+struct CompilerOutput {
+    std::string text;
+    std::vector<std::string_view> lines;
+};
+
+[[nodiscard]] auto compiler_output(std::size_t bytes) -> CompilerOutput;
+
+// "10k tests", "1M tests"
+[[nodiscard]] auto test_count_label(std::size_t tests) -> std::string;
+// "1 MB", "500 MB"
+[[nodiscard]] auto size_label(std::size_t bytes) -> std::string;
+
+} // namespace tdd_guard::bench
@@ -0,0 +1,27 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "bench_inputs.hpp"
+#include "error_parser.hpp"
+
+namespace {
+
+auto bench_parse_error_buffer(std::size_t bytes) -> void {
+    const auto output = tdd_guard::bench::compiler_output(bytes);
+    BENCHMARK(tdd_guard::bench::size_label(bytes)) {
+        return tdd_guard::parse_error_buffer(output.lines).size();
+    };
+}
+
+} // anonymous namespace
+
+TEST_CASE("parse_error_buffer", "[benchmark][error_parser]") {
+    for (const auto bytes : tdd_guard::bench::OUTPUT_SIZES) {
+        bench_parse_error_buffer(bytes);
+    }
+}
+
+TEST_CASE("parse_error_buffer large", "[.][large][benchmark][error_parser]") {
+    for (const auto bytes : tdd_guard::bench::LARGE_OUTPUT_SIZES) {
+        bench_parse_error_buffer(bytes);
+    }
+}
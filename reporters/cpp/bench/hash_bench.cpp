@@ -0,0 +1,16 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "hash.hpp"
+#include <string>
+
+// A test binary is hashed whole whenever it was rebuilt, so throughput
+// decides what a cached run costs after a build
+TEST_CASE("hash64", "[benchmark][hash]") {
+    std::string data(64 << 20, '\0');
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i * 131 >> 3);
+    }
+    BENCHMARK("hash64 64 MiB") {
+        return tdd_guard::hash64(data);
+    };
+}
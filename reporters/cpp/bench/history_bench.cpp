@@ -0,0 +1,54 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nlohmann/json.hpp>
+#include "bench_inputs.hpp"
+#include "history.hpp"
+#include "reporter.hpp"
+#include "transformer.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Saves the test.json of a run of tests tests the way the reporter does,
+// then times reading it back before a sharded run
+auto bench_load(std::size_t tests) -> void {
+    char name[] = "/tmp/tdd-guard-history-bench-XXXXXX";
+    REQUIRE(::mkdtemp(name) != nullptr);
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(name, err);
+    REQUIRE(results_fd >= 0);
+    const auto output = tdd_guard::transform_events(tdd_guard::bench::test_events(tests), {});
+    REQUIRE(tdd_guard::save_results(results_fd, output, err));
+    const auto json = output.to_json();
+
+    const auto label = tdd_guard::bench::test_count_label(tests);
+    BENCHMARK("TestHistory::load " + label) {
+        return tdd_guard::TestHistory::load(results_fd).records().size();
+    };
+    BENCHMARK("DOM " + label) {
+        return nlohmann::json::parse(json)["testModules"].size();
+    };
+
+    ::close(results_fd);
+    std::error_code ec;
+    fs::remove_all(name, ec);
+}
+
+} // anonymous namespace
+
+TEST_CASE("TestHistory::load", "[benchmark][history]") {
+    for (const auto tests : tdd_guard::bench::TEST_COUNTS) {
+        bench_load(tests);
+    }
+}
+
+TEST_CASE("TestHistory::load large", "[.][large][benchmark][history]") {
+    for (const auto tests : tdd_guard::bench::LARGE_TEST_COUNTS) {
+        bench_load(tests);
+    }
+}
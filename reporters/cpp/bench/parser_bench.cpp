@@ -0,0 +1,191 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nlohmann/json.hpp>
+#include "allocation_tracker.hpp"
+#include "bench_inputs.hpp"
+#include "parser.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+// The document walk parse_googletest performed before streaming, kept as
+// the baseline for comparison
+auto parse_googletest_dom(const std::string& input) -> std::vector<tdd_guard::TestEvent> {
+    std::vector<tdd_guard::TestEvent> events;
+    auto data = json::parse(input);
+    for (const auto& suite : data["testsuites"]) {
+        std::string suite_name = suite.value("name", "");
+        for (const auto& test : suite["testsuite"]) {
+            tdd_guard::TestEvent event;
+            event.name = test.value("name", "");
+            event.full_name = suite_name + "." + event.name;
+            if (test.value("status", "") == "NOTRUN") {
+                event.state = tdd_guard::TestEvent::State::Skipped;
+            } else if (test.contains("failures") && !test["failures"].empty()) {
+                event.state = tdd_guard::TestEvent::State::Failed;
+                for (const auto& failure : test["failures"]) {
+                    event.failure_messages.push_back(failure.value("message", ""));
+                }
+            } else {
+                event.state = tdd_guard::TestEvent::State::Passed;
+            }
+            events.push_back(std::move(event));
+        }
+    }
+    return events;
+}
+
+// The two document walks parse_catch2 performed before streaming: section
+// names from the first run, then failed assertions across all runs
+auto parse_catch2_dom(const std::string& input) -> std::vector<tdd_guard::TestEvent> {
+    std::vector<tdd_guard::TestEvent> events;
+    auto data = json::parse(input);
+    for (const auto& test_case : data["test-run"]["test-cases"]) {
+        tdd_guard::TestEvent event;
+        event.name = test_case["test-info"].value("name", "");
+        const json* path = &test_case["runs"][0]["path"];
+        while (path != nullptr && path->is_array()) {
+            const json* next = nullptr;
+            for (const auto& item : *path) {
+                if (item.value("kind", "") == "section") {
+                    event.full_name += "/" + item.value("name", "");
+                    if (item.contains("path")) next = &item["path"];
+                }
+            }
+            path = next;
+        }
+        for (const auto& run : test_case["runs"]) {
+            for (const auto& item : run["path"]) {
+                if (item.value("kind", "") == "assertion" && !item.value("status", true)) {
+                    event.failure_messages.push_back(item["expression"].value("expanded", ""));
+                }
+            }
+        }
+        events.push_back(std::move(event));
+    }
+    return events;
+}
+
+// Each Catch2 case is one event however many runs it has
+constexpr std::size_t CATCH2_RUNS_PER_CASE = 2;
+
+auto bench_parse_googletest(std::size_t tests) -> void {
+    const auto input = tdd_guard::bench::googletest_json(tests);
+    BENCHMARK(tdd_guard::bench::test_count_label(tests)) {
+        tdd_guard::Parser parser;
+        parser.parse(input);
+        return parser.events().size();
+    };
+}
+
+auto bench_parse_catch2(std::size_t tests) -> void {
+    const auto input = tdd_guard::bench::catch2_json(tests, CATCH2_RUNS_PER_CASE);
+    BENCHMARK(tdd_guard::bench::test_count_label(tests)) {
+        tdd_guard::Parser parser;
+        parser.parse(input);
+        return parser.events().size();
+    };
+}
+
+} // anonymous namespace
+
+TEST_CASE("Parser::parse GoogleTest", "[benchmark][parser][googletest]") {
+    for (const auto tests : tdd_guard::bench::TEST_COUNTS) {
+        bench_parse_googletest(tests);
+    }
+}
+
+TEST_CASE("Parser::parse GoogleTest large", "[.][large][benchmark][parser][googletest]") {
+    for (const auto tests : tdd_guard::bench::LARGE_TEST_COUNTS) {
+        bench_parse_googletest(tests);
+    }
+}
+
+TEST_CASE("Parser::parse Catch2", "[benchmark][parser][catch2]") {
+    for (const auto tests : tdd_guard::bench::TEST_COUNTS) {
+        bench_parse_catch2(tests);
+    }
+}
+
+TEST_CASE("Parser::parse Catch2 large", "[.][large][benchmark][parser][catch2]") {
+    for (const auto tests : tdd_guard::bench::LARGE_TEST_COUNTS) {
+        bench_parse_catch2(tests);
+    }
+}
+
+TEST_CASE("GoogleTest parse time", "[benchmark][parser][googletest]") {
+    const auto input = tdd_guard::bench::googletest_json(20000);
+
+    BENCHMARK("streaming parser") {
+        tdd_guard::Parser parser;
+        parser.parse(input);
+        return parser.events().size();
+    };
+
+    BENCHMARK("DOM parser") {
+        return parse_googletest_dom(input).size();
+    };
+}
+
+TEST_CASE("GoogleTest parse memory", "[benchmark][parser][googletest]") {
+    const auto input = tdd_guard::bench::googletest_json(20000);
+
+    std::size_t streaming_peak = 0;
+    {
+        tdd_guard::testing::AllocationScope scope;
+        tdd_guard::Parser parser;
+        parser.parse(input);
+        streaming_peak = scope.stats().peak_bytes;
+    }
+
+    std::size_t dom_peak = 0;
+    {
+        tdd_guard::testing::AllocationScope scope;
+        auto events = parse_googletest_dom(input);
+        dom_peak = scope.stats().peak_bytes;
+    }
+
+    WARN("input " << input.size() << " bytes, streaming peak " << streaming_peak
+         << " bytes, DOM peak " << dom_peak << " bytes");
+    CHECK(streaming_peak < dom_peak);
+}
+
+TEST_CASE("Catch2 parse time", "[benchmark][parser][catch2]") {
+    const auto input = tdd_guard::bench::catch2_json(500, 40);
+
+    BENCHMARK("streaming parser") {
+        tdd_guard::Parser parser;
+        parser.parse(input);
+        return parser.events().size();
+    };
+
+    BENCHMARK("DOM parser") {
+        return parse_catch2_dom(input).size();
+    };
+}
+
+TEST_CASE("Catch2 parse memory", "[benchmark][parser][catch2]") {
+    const auto input = tdd_guard::bench::catch2_json(500, 40);
+
+    std::size_t streaming_peak = 0;
+    {
+        tdd_guard::testing::AllocationScope scope;
+        tdd_guard::Parser parser;
+        parser.parse(input);
+        streaming_peak = scope.stats().peak_bytes;
+    }
+
+    std::size_t dom_peak = 0;
+    {
+        tdd_guard::testing::AllocationScope scope;
+        auto events = parse_catch2_dom(input);
+        dom_peak = scope.stats().peak_bytes;
+    }
+
+    WARN("input " << input.size() << " bytes, streaming peak " << streaming_peak
+         << " bytes, DOM peak " << dom_peak << " bytes");
+    CHECK(streaming_peak < dom_peak);
+}
@@ -0,0 +1,492 @@
+// Drives the reporter binary through real pipes the way a test run does,
+// `./tests 2>&1 | tdd-guard-cpp --passthrough`, and measures what the
+// developer at the other end notices: passthrough throughput, how long each
+// line takes to come out again, and how long after EOF the results land.
+
+#include "bench_inputs.hpp"
+#include "json_writer.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr std::size_t READ_SIZE = 64 * 1024;
+constexpr auto SAVE_TIMEOUT = std::chrono::seconds(60);
+
+enum class InputKind { GoogleTest, Catch2, Compiler };
+
+struct Args {
+    fs::path reporter;
+    std::vector<std::string> reporter_args;
+    InputKind input = InputKind::GoogleTest;
+    std::size_t tests = 100'000;
+    std::size_t megabytes = 10;
+    double rate_mb_per_s = 0;
+    std::size_t chunk_size = 4096;
+    unsigned runs = 3;
+    std::string json_path;
+};
+
+struct RunResult {
+    std::size_t bytes = 0;
+    std::size_t lines = 0;
+    bool intact = false;
+    std::chrono::nanoseconds forwarding{};
+    // Per line, from the producer's write until the line came back out
+    std::vector<std::chrono::nanoseconds> latencies;
+    std::optional<std::chrono::nanoseconds> eof_to_saved;
+    std::chrono::nanoseconds eof_to_exit{};
+    int exit_status = -1;
+};
+
+auto usage() -> void {
+    std::cerr << "Usage: tdd-guard-cpp-pipe-bench [options] [-- reporter-args...]\n"
+                 "  --reporter PATH       reporter binary (default: tdd-guard-cpp beside this tool)\n"
+                 "  --input KIND          googletest, catch2 or compiler (default: googletest)\n"
+                 "  --tests N             tests in the JSON inputs (default: 100000)\n"
+                 "  --size MB             compiler output size (default: 10)\n"
+                 "  --rate MB/S           producer rate limit, 0 for none (default: 0)\n"
+                 "  --chunk BYTES         producer write size (default: 4096)\n"
+                 "  --runs N              runs to measure (default: 3)\n"
+                 "  --json FILE           also write the results as JSON\n";
+}
+
+auto parse_args(int argc, char* argv[]) -> std::optional<Args> {
+    Args args;
+    args.reporter = fs::read_symlink("/proc/self/exe").parent_path() / "tdd-guard-cpp";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--") {
+            args.reporter_args.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        if (arg == "--reporter" && has_value) {
+            args.reporter = argv[++i];
+        } else if (arg == "--input" && has_value) {
+            const std::string_view kind = argv[++i];
+            if (kind == "googletest") {
+                args.input = InputKind::GoogleTest;
+            } else if (kind == "catch2") {
+                args.input = InputKind::Catch2;
+            } else if (kind == "compiler") {
+                args.input = InputKind::Compiler;
+            } else {
+                return std::nullopt;
+            }
+        } else if (arg == "--tests" && has_value) {
+            args.tests = std::stoul(argv[++i]);
+        } else if (arg == "--size" && has_value) {
+            args.megabytes = std::stoul(argv[++i]);
+        } else if (arg == "--rate" && has_value) {
+            args.rate_mb_per_s = std::stod(argv[++i]);
+        } else if (arg == "--chunk" && has_value) {
+            args.chunk_size = std::max<std::size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--runs" && has_value) {
+            args.runs = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+        } else if (arg == "--json" && has_value) {
+            args.json_path = argv[++i];
+        } else {
+            return std::nullopt;
+        }
+    }
+    return args;
+}
+
+// Breaks compact JSON into lines indented the way GoogleTest and Catch2
+// print their reports
+auto pretty_json(std::string_view json) -> std::string {
+    std::string out;
+    out.reserve(json.size() * 2);
+    std::size_t depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    const auto newline = [&] {
+        out += '\n';
+        out.append(depth * 2, ' ');
+    };
+
+    for (const char c : json) {
+        if (in_string) {
+            out += c;
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
+            continue;
+        }
+        switch (c) {
+            case '"':
+                in_string = true;
+                out += c;
+                break;
+            case '{':
+            case '[':
+                out += c;
+                ++depth;
+                newline();
+                break;
+            case '}':
+            case ']':
+                --depth;
+                newline();
+                out += c;
+                break;
+            case ',':
+                out += c;
+                newline();
+                break;
+            case ' ':
+                break;
+            case ':':
+                out += ": ";
+                break;
+            default:
+                out += c;
+        }
+    }
+    out += '\n';
+    return out;
+}
+
+auto make_input(const Args& args) -> std::string {
+    switch (args.input) {
+        case InputKind::GoogleTest: return pretty_json(tdd_guard::bench::googletest_json(args.tests));
+        case InputKind::Catch2: return pretty_json(tdd_guard::bench::catch2_json(args.tests, 2));
+        case InputKind::Compiler: {
+            auto output = tdd_guard::bench::compiler_output(args.megabytes * tdd_guard::bench::MEGABYTE);
+            return std::move(output.text);
+        }
+    }
+    return {};
+}
+
+// Offsets just past each '\n'
+auto line_ends(std::string_view input) -> std::vector<std::size_t> {
+    std::vector<std::size_t> ends;
+    for (auto pos = input.find('\n'); pos != std::string_view::npos; pos = input.find('\n', pos + 1)) {
+        ends.push_back(pos + 1);
+    }
+    return ends;
+}
+
+auto write_all(int fd, std::string_view bytes) -> bool {
+    while (!bytes.empty()) {
+        const auto written = ::write(fd, bytes.data(), bytes.size());
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+auto since(Clock::time_point start) -> std::chrono::nanoseconds {
+    return Clock::now() - start;
+}
+
+// Waits for test.json to be renamed into the watched directory
+auto wait_for_rename(int inotify_fd, Clock::time_point deadline) -> bool {
+    alignas(inotify_event) char buffer[4096];
+    while (Clock::now() < deadline) {
+        pollfd pfd{.fd = inotify_fd, .events = POLLIN, .revents = 0};
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+        if (::poll(&pfd, 1, static_cast<int>(std::max<std::int64_t>(left.count(), 1))) <= 0) {
+            continue;
+        }
+        const auto length = ::read(inotify_fd, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && std::string_view(event->name) == "test.json") {
+                return true;
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return false;
+}
+
+auto run_once(const Args& args, std::string_view input, const std::vector<std::size_t>& ends)
+    -> std::optional<RunResult> {
+    char root_template[] = "/tmp/tdd-guard-pipe-bench-XXXXXX";
+    if (::mkdtemp(root_template) == nullptr) {
+        std::cerr << "Error creating project root: " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+    const fs::path root = root_template;
+    const auto data_dir = root / ".claude" / "tdd-guard" / "data";
+    fs::create_directories(data_dir);
+
+    const int inotify_fd = ::inotify_init1(IN_CLOEXEC);
+    if (inotify_fd < 0 || ::inotify_add_watch(inotify_fd, data_dir.c_str(), IN_MOVED_TO) < 0) {
+        std::cerr << "Error watching " << data_dir.string() << ": " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+
+    int to_reporter[2];
+    int from_reporter[2];
+    if (::pipe2(to_reporter, O_CLOEXEC) != 0 || ::pipe2(from_reporter, O_CLOEXEC) != 0) {
+        std::cerr << "Error creating pipes: " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+
+    std::vector<std::string> argv_strings = {args.reporter.string(), "--project-root", root.string(),
+                                             "--passthrough"};
+    argv_strings.insert(argv_strings.end(), args.reporter_args.begin(), args.reporter_args.end());
+    std::vector<char*> child_argv;
+    for (auto& arg : argv_strings) {
+        child_argv.push_back(arg.data());
+    }
+    child_argv.push_back(nullptr);
+
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        std::cerr << "Error starting reporter: " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+    if (pid == 0) {
+        ::dup2(to_reporter[0], STDIN_FILENO);
+        ::dup2(from_reporter[1], STDOUT_FILENO);
+        ::execv(child_argv[0], child_argv.data());
+        std::_Exit(127);
+    }
+    ::close(to_reporter[0]);
+    ::close(from_reporter[1]);
+
+    RunResult result;
+    result.bytes = input.size();
+    result.lines = ends.size();
+    result.latencies.resize(ends.size());
+    std::vector<std::atomic<Clock::rep>> sent(ends.size());
+
+    const auto start = Clock::now();
+    std::atomic<Clock::rep> last_byte{0};
+
+    // Matches each newline coming back to the line that was sent, since
+    // passthrough keeps the order; also checks the bytes are unchanged
+    std::thread reader([&] {
+        auto buffer = std::make_unique<char[]>(READ_SIZE);
+        std::size_t received = 0;
+        std::size_t line = 0;
+        bool intact = true;
+        while (true) {
+            const auto count = ::read(from_reporter[0], buffer.get(), READ_SIZE);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) break;
+            const auto now = Clock::now();
+            const std::string_view chunk(buffer.get(), static_cast<std::size_t>(count));
+            if (received + chunk.size() > input.size() || input.substr(received, chunk.size()) != chunk) {
+                intact = false;
+            }
+            received += chunk.size();
+            while (line < ends.size() && ends[line] <= received) {
+                const auto sent_at = Clock::time_point(Clock::duration(sent[line].load(std::memory_order_relaxed)));
+                result.latencies[line] = now - sent_at;
+                ++line;
+            }
+            last_byte.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+        }
+        result.intact = intact && received == input.size();
+        ::close(from_reporter[0]);
+    });
+
+    // Writes whole lines in chunks, like a buffered stdout, paced to the rate
+    std::size_t offset = 0;
+    std::size_t line = 0;
+    while (line < ends.size()) {
+        const auto first = line;
+        while (line < ends.size() && ends[line] - offset < args.chunk_size) {
+            ++line;
+        }
+        if (line == first) {
+            ++line;
+        }
+        const auto now = Clock::now().time_since_epoch().count();
+        for (auto i = first; i < line; ++i) {
+            sent[i].store(now, std::memory_order_relaxed);
+        }
+        if (!write_all(to_reporter[1], input.substr(offset, ends[line - 1] - offset))) {
+            std::cerr << "Error writing to reporter: " << std::strerror(errno) << "\n";
+            break;
+        }
+        offset = ends[line - 1];
+        if (args.rate_mb_per_s > 0) {
+            const auto due = std::chrono::duration<double>(static_cast<double>(offset) /
+                                                           (args.rate_mb_per_s * tdd_guard::bench::MEGABYTE));
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(due));
+        }
+    }
+    ::close(to_reporter[1]);
+    const auto eof = Clock::now();
+
+    if (wait_for_rename(inotify_fd, eof + SAVE_TIMEOUT)) {
+        result.eof_to_saved = since(eof);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    result.eof_to_exit = since(eof);
+    result.exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    reader.join();
+    ::close(inotify_fd);
+
+    result.forwarding = Clock::time_point(Clock::duration(last_byte.load())) - start;
+    std::error_code ec;
+    fs::remove_all(root, ec);
+    return result;
+}
+
+auto milliseconds(std::chrono::nanoseconds duration) -> double {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+auto microseconds(std::chrono::nanoseconds duration) -> double {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+auto throughput(const RunResult& run) -> double {
+    const auto seconds = std::chrono::duration<double>(run.forwarding).count();
+    return seconds > 0 ? static_cast<double>(run.bytes) / tdd_guard::bench::MEGABYTE / seconds : 0;
+}
+
+constexpr std::array<double, 5> PERCENTILES = {50, 90, 99, 99.9, 100};
+
+auto percentile(const std::vector<std::chrono::nanoseconds>& sorted, double p) -> std::chrono::nanoseconds {
+    if (sorted.empty()) {
+        return {};
+    }
+    const auto rank = static_cast<std::size_t>(p / 100 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+auto percentile_name(double p) -> std::string {
+    if (p == 100) {
+        return "max";
+    }
+    std::ostringstream name;
+    name << "p" << p;
+    return name.str();
+}
+
+auto print_run(std::ostream& out, unsigned index, RunResult& run) -> void {
+    std::sort(run.latencies.begin(), run.latencies.end());
+    out << "run " << index << ": " << std::fixed << std::setprecision(1)
+        << static_cast<double>(run.bytes) / tdd_guard::bench::MEGABYTE << " MB, " << run.lines << " lines in "
+        << milliseconds(run.forwarding) << " ms, " << throughput(run) << " MB/s"
+        << (run.intact ? "" : " (OUTPUT DIFFERS)") << "\n  latency";
+    for (const auto p : PERCENTILES) {
+        out << " " << percentile_name(p) << " " << microseconds(percentile(run.latencies, p)) << " us";
+    }
+    out << "\n  eof to test.json ";
+    if (run.eof_to_saved) {
+        out << milliseconds(*run.eof_to_saved) << " ms";
+    } else {
+        out << "never";
+    }
+    out << ", eof to exit " << milliseconds(run.eof_to_exit) << " ms, exit status " << run.exit_status << "\n";
+}
+
+auto write_json(const std::string& path, const Args& args, const std::vector<RunResult>& runs) -> bool {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    tdd_guard::JsonWriter writer(fd);
+    writer.begin_object();
+    writer.key("rateMbPerS");
+    writer.number(args.rate_mb_per_s);
+    writer.key("runs");
+    writer.begin_array();
+    for (const auto& run : runs) {
+        writer.begin_object();
+        writer.key("bytes");
+        writer.number(static_cast<std::uint64_t>(run.bytes));
+        writer.key("eofToExitMs");
+        writer.number(milliseconds(run.eof_to_exit));
+        if (run.eof_to_saved) {
+            writer.key("eofToSavedMs");
+            writer.number(milliseconds(*run.eof_to_saved));
+        }
+        writer.key("exitStatus");
+        writer.number(static_cast<double>(run.exit_status));
+        writer.key("intact");
+        writer.boolean(run.intact);
+        writer.key("latencyUs");
+        writer.begin_object();
+        for (const auto p : PERCENTILES) {
+            writer.key(percentile_name(p));
+            writer.number(microseconds(percentile(run.latencies, p)));
+        }
+        writer.end_object();
+        writer.key("lines");
+        writer.number(static_cast<std::uint64_t>(run.lines));
+        writer.key("throughputMbPerS");
+        writer.number(throughput(run));
+        writer.end_object();
+    }
+    writer.end_array();
+    writer.end_object();
+    const bool written = writer.flush();
+    return ::close(fd) == 0 && written;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    const auto args = parse_args(argc, argv);
+    if (!args) {
+        usage();
+        return 2;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const auto input = make_input(*args);
+    const auto ends = line_ends(input);
+
+    std::vector<RunResult> runs;
+    for (unsigned i = 1; i <= args->runs; ++i) {
+        auto run = run_once(*args, input, ends);
+        if (!run) {
+            return 1;
+        }
+        print_run(std::cout, i, *run);
+        runs.push_back(std::move(*run));
+    }
+
+    if (!args->json_path.empty() && !write_json(args->json_path, *args, runs)) {
+        std::cerr << "Error writing " << args->json_path << "\n";
+        return 1;
+    }
+
+    const bool ok = std::all_of(runs.begin(), runs.end(), [](const RunResult& run) {
+        return run.intact && run.eof_to_saved && run.exit_status == 0;
+    });
+    return ok ? 0 : 1;
+}
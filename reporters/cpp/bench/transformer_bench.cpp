@@ -0,0 +1,63 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include "bench_inputs.hpp"
+#include "transformer.hpp"
+#include <thread>
+#include <vector>
+
+namespace {
+
+// transform_events consumes its events, so every run gets a copy made
+// outside the measurement
+auto bench_transform(std::string name, std::size_t tests, unsigned threads) -> void {
+    const auto events = tdd_guard::bench::test_events(tests);
+    BENCHMARK_ADVANCED(std::move(name))(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::vector<tdd_guard::TestEvent>> inputs(static_cast<std::size_t>(meter.runs()), events);
+        meter.measure([&](int run) {
+            return tdd_guard::transform_events(std::move(inputs[static_cast<std::size_t>(run)]), {}, threads)
+                .test_modules.size();
+        });
+    };
+}
+
+auto bench_transform_events(std::size_t tests) -> void {
+    const auto label = tdd_guard::bench::test_count_label(tests);
+    bench_transform(label, tests, 1);
+    const auto threads = std::thread::hardware_concurrency();
+    if (threads > 1) {
+        bench_transform(label + ", " + std::to_string(threads) + " threads", tests, threads);
+    }
+}
+
+auto bench_to_json(std::size_t tests) -> void {
+    const auto output = tdd_guard::transform_events(tdd_guard::bench::test_events(tests), {});
+    BENCHMARK(tdd_guard::bench::test_count_label(tests)) {
+        return output.to_json().size();
+    };
+}
+
+} // anonymous namespace
+
+TEST_CASE("transform_events", "[benchmark][transformer]") {
+    for (const auto tests : tdd_guard::bench::TEST_COUNTS) {
+        bench_transform_events(tests);
+    }
+}
+
+TEST_CASE("transform_events large", "[.][large][benchmark][transformer]") {
+    for (const auto tests : tdd_guard::bench::LARGE_TEST_COUNTS) {
+        bench_transform_events(tests);
+    }
+}
+
+TEST_CASE("TddGuardOutput::to_json", "[benchmark][transformer]") {
+    for (const auto tests : tdd_guard::bench::TEST_COUNTS) {
+        bench_to_json(tests);
+    }
+}
+
+TEST_CASE("TddGuardOutput::to_json large", "[.][large][benchmark][transformer]") {
+    for (const auto tests : tdd_guard::bench::LARGE_TEST_COUNTS) {
+        bench_to_json(tests);
+    }
+}
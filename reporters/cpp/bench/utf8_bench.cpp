@@ -0,0 +1,71 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nlohmann/json.hpp>
+#include "utf8.hpp"
+#include <string>
+
+namespace {
+
+constexpr std::size_t MESSAGE_SIZE = 8 * 1024 * 1024;
+
+// Assertion output as GoogleTest prints it, repeated to size
+auto make_message(std::string_view line) -> std::string {
+    std::string out;
+    out.reserve(MESSAGE_SIZE + line.size());
+    while (out.size() < MESSAGE_SIZE) {
+        out += line;
+    }
+    return out;
+}
+
+// nlohmann validates every string while dumping; the cost of that check
+// alone is the baseline
+auto nlohmann_validates(const std::string& text) -> bool {
+    try {
+        (void)nlohmann::json(text).dump();
+        return true;
+    } catch (const nlohmann::json::type_error&) {
+        return false;
+    }
+}
+
+} // anonymous namespace
+
+TEST_CASE("UTF-8 validation of ASCII messages", "[benchmark][utf8]") {
+    const auto message = make_message("tests/suite_test.cpp:42: Failure\nValue of: x\n  Actual: 1\nExpected: 2\n");
+
+    BENCHMARK("is_valid_utf8") {
+        return tdd_guard::is_valid_utf8(message);
+    };
+
+    BENCHMARK("nlohmann dump") {
+        return nlohmann_validates(message);
+    };
+}
+
+TEST_CASE("UTF-8 validation of multilingual messages", "[benchmark][utf8]") {
+    const auto message = make_message("Expected: \"gr\xC3\xBC\xC3\x9F \xE4\xB8\x96\xE7\x95\x8C \xF0\x9F\x98\x80\"\n");
+
+    BENCHMARK("is_valid_utf8") {
+        return tdd_guard::is_valid_utf8(message);
+    };
+
+    BENCHMARK("nlohmann dump") {
+        return nlohmann_validates(message);
+    };
+}
+
+TEST_CASE("UTF-8 repair of binary messages", "[benchmark][utf8]") {
+    const auto message = make_message("buffer: \x01\xFF\xFE\x80 path caf\xE9.cpp\n");
+
+    BENCHMARK("repair_utf8") {
+        auto copy = message;
+        tdd_guard::repair_utf8(copy);
+        return copy.size();
+    };
+
+    BENCHMARK("copy only") {
+        auto copy = message;
+        return copy.size();
+    };
+}
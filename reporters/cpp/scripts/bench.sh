@@ -0,0 +1,28 @@
+#!/bin/bash
+# TDD Guard C++ Benchmarks
+# Builds the benchmarks in release mode and records the results as Catch2
+# XML, one file per version, so runs can be compared across versions
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/.." && pwd)"
+BUILD_DIR="$PROJECT_ROOT/build-bench"
+BENCH="$BUILD_DIR/tdd-guard-cpp-bench"
+RESULTS_DIR="${BENCH_RESULTS_DIR:-$PROJECT_ROOT/bench-results}"
+VERSION="$(git -C "$PROJECT_ROOT" describe --tags --always --dirty 2>/dev/null || echo unknown)"
+RESULTS="$RESULTS_DIR/$VERSION.xml"
+
+cd "$PROJECT_ROOT"
+
+echo "Building benchmarks..."
+cmake -B "$BUILD_DIR" -S "$PROJECT_ROOT" -DCMAKE_BUILD_TYPE=Release -DBUILD_BENCHMARKS=ON
+cmake --build "$BUILD_DIR" --target tdd-guard-cpp-bench
+
+# Extra arguments go to Catch2, e.g. "[large]" for the 1M test and 500 MB
+# inputs or "--benchmark-samples 20" for quicker runs
+mkdir -p "$RESULTS_DIR"
+echo "Running benchmarks..."
+"$BENCH" --reporter xml --out "$RESULTS" "$@"
+
+echo "Benchmark results saved to $RESULTS"
@@ -36,3 +36,7 @@ echo "Running tests..."
     "$REPORTER" --project-root "$PROJECT_ROOT" --passthrough
 
 echo "Test results saved to .claude/tdd-guard/data/test.json"
+
+# The startup budget is a wall-clock check, hidden from the default run
+echo "Checking startup time..."
+"$TESTS" "[startup]"
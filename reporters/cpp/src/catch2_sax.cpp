@@ -0,0 +1,430 @@
+#include "catch2_sax.hpp"
+#include <string_view>
+
+namespace tdd_guard {
+
+Catch2Sax::Catch2Sax(std::vector<TestEvent>& events) : events_(events) {}
+
+auto Catch2Sax::succeeded() const -> bool {
+    return valid_ && has_cases_;
+}
+
+auto Catch2Sax::claimed() const -> bool {
+    return has_cases_;
+}
+
+auto Catch2Sax::current() const -> Frame {
+    return frames_.empty() ? Frame::Skip : frames_.back();
+}
+
+auto Catch2Sax::invalid() -> bool {
+    valid_ = false;
+    return false;
+}
+
+auto Catch2Sax::push(Frame frame) -> bool {
+    frames_.push_back(frame);
+    return true;
+}
+
+// Any value that does not open a frame of interest. Type mismatches are
+// recorded where they are seen and only fail the document if the DOM walk
+// would have looked at that field.
+auto Catch2Sax::other_value() -> bool {
+    started_ = true;
+    switch (current()) {
+        case Frame::Document:
+            if (key_ == Key::TestRun) return invalid();
+            break;
+        case Frame::TestRun:
+            if (key_ == Key::TestCases) return invalid();
+            break;
+        case Frame::Info:
+            if (key_ == Key::Name) case_name_invalid_ = true;
+            break;
+        case Frame::Runs:
+            // A test case whose first run is not an object is skipped
+            if (run_count_++ == 0) case_skipped_ = true;
+            break;
+        case Frame::Item: {
+            auto& item = items_.back();
+            if (key_ == Key::Kind) {
+                item.kind_field = Field::Invalid;
+            } else if (key_ == Key::Name) {
+                item.name_field = Field::Invalid;
+            } else if (key_ == Key::Status) {
+                item.status_field = Field::Invalid;
+            } else if (key_ == Key::Path) {
+                item.has_path = true;
+                item.path = Chain{};
+            }
+            break;
+        }
+        case Frame::Expression:
+            if (key_ == Key::Expanded) items_.back().expanded_field = Field::Invalid;
+            break;
+        case Frame::Assertions:
+            if (key_ == Key::Failed || key_ == Key::Skipped || key_ == Key::Passed) {
+                assertions_invalid_ = true;
+            }
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+auto Catch2Sax::count(int value) -> bool {
+    switch (key_) {
+        case Key::Failed: failed_ = value; break;
+        case Key::Skipped: skipped_ = value; break;
+        case Key::Passed: passed_ = value; break;
+        default: break;
+    }
+    return true;
+}
+
+auto Catch2Sax::null() -> bool {
+    return other_value();
+}
+
+auto Catch2Sax::boolean(bool value) -> bool {
+    if (current() == Frame::Item && key_ == Key::Status) {
+        auto& item = items_.back();
+        item.status_field = Field::Valid;
+        item.status = value;
+        return true;
+    }
+    if (current() == Frame::Assertions) {
+        return count(value ? 1 : 0);
+    }
+    return other_value();
+}
+
+auto Catch2Sax::number_integer(std::int64_t value) -> bool {
+    if (current() == Frame::Assertions) {
+        return count(static_cast<int>(value));
+    }
+    return other_value();
+}
+
+auto Catch2Sax::number_unsigned(std::uint64_t value) -> bool {
+    if (current() == Frame::Assertions) {
+        return count(static_cast<int>(value));
+    }
+    return other_value();
+}
+
+auto Catch2Sax::number_float(double value, const std::string& /*text*/) -> bool {
+    if (current() == Frame::Assertions) {
+        return count(static_cast<int>(value));
+    }
+    return other_value();
+}
+
+auto Catch2Sax::string(std::string& value) -> bool {
+    switch (current()) {
+        case Frame::Info:
+            if (key_ != Key::Name) break;
+            case_name_ = value;
+            case_name_invalid_ = false;
+            return true;
+        case Frame::Item: {
+            auto& item = items_.back();
+            if (key_ == Key::Kind) {
+                item.kind_field = Field::Valid;
+                item.kind = value;
+                return true;
+            }
+            if (key_ == Key::Name) {
+                item.name_field = Field::Valid;
+                item.name = value;
+                return true;
+            }
+            break;
+        }
+        case Frame::Expression:
+            if (key_ != Key::Expanded) break;
+            items_.back().expanded_field = Field::Valid;
+            items_.back().expanded = value;
+            return true;
+        default:
+            break;
+    }
+    return other_value();
+}
+
+auto Catch2Sax::start_object(std::size_t /*elements*/) -> bool {
+    if (!started_) {
+        started_ = true;
+        return push(Frame::Document);
+    }
+
+    switch (current()) {
+        case Frame::Document:
+            if (key_ == Key::TestRun) return push(Frame::TestRun);
+            break;
+        case Frame::Cases:
+            begin_case();
+            return push(Frame::Case);
+        case Frame::Case:
+            if (key_ == Key::TestInfo) return push(Frame::Info);
+            if (key_ == Key::Totals) return push(Frame::Totals);
+            break;
+        case Frame::Totals:
+            if (key_ == Key::Assertions) {
+                has_assertions_ = true;
+                return push(Frame::Assertions);
+            }
+            break;
+        case Frame::Runs:
+            ++run_count_;
+            return push(Frame::Run);
+        case Frame::Path:
+            items_.emplace_back();
+            return push(Frame::Item);
+        case Frame::Item:
+            if (key_ == Key::Expression) {
+                items_.back().has_expression = true;
+                return push(Frame::Expression);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if (!other_value()) {
+        return false;
+    }
+    return push(Frame::Skip);
+}
+
+auto Catch2Sax::key(std::string& name) -> bool {
+    const std::string_view view = name;
+    switch (current()) {
+        case Frame::Document:
+            key_ = view == "test-run" ? Key::TestRun : Key::Other;
+            break;
+        case Frame::TestRun:
+            key_ = view == "test-cases" ? Key::TestCases : Key::Other;
+            break;
+        case Frame::Case:
+            key_ = view == "test-info" ? Key::TestInfo
+                 : view == "runs" ? Key::Runs
+                 : view == "totals" ? Key::Totals
+                 : Key::Other;
+            break;
+        case Frame::Info:
+            key_ = view == "name" ? Key::Name : Key::Other;
+            break;
+        case Frame::Run:
+            key_ = view == "path" ? Key::Path : Key::Other;
+            break;
+        case Frame::Item:
+            key_ = view == "kind" ? Key::Kind
+                 : view == "name" ? Key::Name
+                 : view == "status" ? Key::Status
+                 : view == "expression" ? Key::Expression
+                 : view == "path" ? Key::Path
+                 : Key::Other;
+            break;
+        case Frame::Expression:
+            key_ = view == "expanded" ? Key::Expanded : Key::Other;
+            break;
+        case Frame::Totals:
+            key_ = view == "assertions" ? Key::Assertions : Key::Other;
+            break;
+        case Frame::Assertions:
+            key_ = view == "failed" ? Key::Failed
+                 : view == "skipped" ? Key::Skipped
+                 : view == "passed" ? Key::Passed
+                 : Key::Other;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+auto Catch2Sax::end_object() -> bool {
+    const auto frame = current();
+    frames_.pop_back();
+
+    if (frame == Frame::Case) {
+        return end_case();
+    }
+    if (frame == Frame::Item) {
+        end_item();
+        items_.pop_back();
+    }
+    return true;
+}
+
+auto Catch2Sax::start_array(std::size_t /*elements*/) -> bool {
+    if (started_) {
+        switch (current()) {
+            case Frame::TestRun:
+                if (key_ == Key::TestCases) {
+                    has_cases_ = true;
+                    return push(Frame::Cases);
+                }
+                break;
+            case Frame::Case:
+                if (key_ == Key::Runs) return push(Frame::Runs);
+                break;
+            case Frame::Run:
+                if (key_ == Key::Path) {
+                    levels_.push_back(Level{.sections = run_count_ == 1, .top = true, .chain = {}, .deeper = {}});
+                    return push(Frame::Path);
+                }
+                break;
+            case Frame::Item:
+                // Section names are only followed through the first run
+                if (key_ == Key::Path && levels_.back().sections) {
+                    levels_.push_back(Level{.sections = true, .top = false, .chain = {}, .deeper = {}});
+                    return push(Frame::Path);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!other_value()) {
+        return false;
+    }
+    return push(Frame::Skip);
+}
+
+auto Catch2Sax::end_array() -> bool {
+    const auto frame = current();
+    frames_.pop_back();
+
+    if (frame == Frame::Path) {
+        end_path();
+    }
+    return true;
+}
+
+auto Catch2Sax::begin_case() -> void {
+    case_name_.clear();
+    case_name_invalid_ = false;
+    case_skipped_ = false;
+    run_count_ = 0;
+    sections_ = Chain{};
+    has_assertions_ = false;
+    assertions_invalid_ = false;
+    failed_ = 0;
+    skipped_ = 0;
+    passed_ = 0;
+    failures_.clear();
+    failures_invalid_ = false;
+}
+
+auto Catch2Sax::end_item() -> void {
+    auto& item = items_.back();
+    auto& level = levels_.back();
+
+    if (level.sections) {
+        if (item.kind_field == Field::Invalid) {
+            level.chain.invalid = true;
+        } else if (item.kind == "section") {
+            if (item.name_field == Field::Invalid) {
+                level.chain.invalid = true;
+            } else {
+                level.chain.names.push_back(std::move(item.name));
+            }
+            if (item.has_path) {
+                level.deeper = std::move(item.path);
+            }
+        }
+    }
+
+    if (level.top) {
+        if (item.kind_field == Field::Invalid) {
+            failures_invalid_ = true;
+        } else if (item.kind == "assertion") {
+            if (item.status_field == Field::Invalid) {
+                failures_invalid_ = true;
+            } else if (!item.status && item.has_expression) {
+                if (item.expanded_field == Field::Invalid) {
+                    failures_invalid_ = true;
+                } else if (!item.expanded.empty()) {
+                    failures_.push_back(std::move(item.expanded));
+                }
+            }
+        }
+    }
+}
+
+auto Catch2Sax::end_path() -> void {
+    auto level = std::move(levels_.back());
+    levels_.pop_back();
+    if (!level.sections) {
+        return;
+    }
+
+    auto chain = std::move(level.chain);
+    for (auto& name : level.deeper.names) {
+        chain.names.push_back(std::move(name));
+    }
+    chain.invalid = chain.invalid || level.deeper.invalid;
+
+    if (level.top) {
+        sections_ = std::move(chain);
+    } else {
+        items_.back().has_path = true;
+        items_.back().path = std::move(chain);
+    }
+}
+
+auto Catch2Sax::end_case() -> bool {
+    if (case_name_invalid_) {
+        return invalid();
+    }
+    if (case_skipped_) {
+        return true;
+    }
+    if (sections_.invalid || assertions_invalid_) {
+        return invalid();
+    }
+
+    TestEvent event;
+    const auto& section_names = sections_.names;
+    if (section_names.empty()) {
+        event.name = case_name_;
+        event.full_name = case_name_;
+    } else {
+        event.name = section_names.back();
+        if (!case_name_.empty() && section_names.front() != case_name_) {
+            event.full_name = case_name_ + "/" + section_names[0];
+        } else {
+            event.full_name = section_names[0];
+        }
+        for (size_t i = 1; i < section_names.size(); ++i) {
+            event.full_name += "/" + section_names[i];
+        }
+    }
+
+    if (!has_assertions_) {
+        event.state = TestEvent::State::Unknown;
+    } else if (skipped_ > 0 && failed_ == 0 && passed_ == 0) {
+        event.state = TestEvent::State::Skipped;
+    } else if (failed_ > 0) {
+        event.state = TestEvent::State::Failed;
+    } else {
+        event.state = TestEvent::State::Passed;
+    }
+
+    if (event.state == TestEvent::State::Failed) {
+        if (failures_invalid_) {
+            return invalid();
+        }
+        event.failure_messages = std::move(failures_);
+    }
+
+    events_.push_back(std::move(event));
+    return true;
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "json_stream.hpp"
+#include "parser.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tdd_guard {
+
+// Builds TestEvents from Catch2 JSON in a single pass while it is being
+// tokenized. Section names and failed assertion expansions are collected
+// together as each test case streams past, so memory is bounded by the
+// nesting depth of one test case rather than the whole run.
+class Catch2Sax final : public JsonHandler {
+public:
+    explicit Catch2Sax(std::vector<TestEvent>& events);
+
+    // True when the document was a complete Catch2 report
+    [[nodiscard]] auto succeeded() const -> bool;
+    // True once the test-run.test-cases array has been reached, which identifies the
+    // framework before any test has been read
+    [[nodiscard]] auto claimed() const -> bool;
+
+    auto null() -> bool override;
+    auto boolean(bool value) -> bool override;
+    auto number_integer(std::int64_t value) -> bool override;
+    auto number_unsigned(std::uint64_t value) -> bool override;
+    auto number_float(double value, const std::string& text) -> bool override;
+    auto string(std::string& value) -> bool override;
+
+    auto start_object(std::size_t elements) -> bool override;
+    auto key(std::string& name) -> bool override;
+    auto end_object() -> bool override;
+    auto start_array(std::size_t elements) -> bool override;
+    auto end_array() -> bool override;
+
+private:
+    enum class Frame {
+        Document, TestRun, Cases, Case, Info, Runs, Run, Path, Item, Expression,
+        Totals, Assertions, Skip
+    };
+    enum class Key {
+        Other, TestRun, TestCases, TestInfo, Runs, Totals, Assertions, Name, Path,
+        Kind, Status, Expression, Expanded, Failed, Skipped, Passed
+    };
+    // A string or boolean field read from a path item, checked only if the
+    // original DOM lookup would have been evaluated
+    enum class Field { Missing, Valid, Invalid };
+
+    // Section names along the path a run descends into
+    struct Chain {
+        std::vector<std::string> names;
+        bool invalid = false;
+    };
+
+    // An open "path" array. Only the last section carrying a path at each
+    // level is descended into, so its chain replaces any earlier one.
+    struct Level {
+        bool sections = false;
+        bool top = false;
+        Chain chain;
+        Chain deeper;
+    };
+
+    struct Item {
+        Field kind_field = Field::Missing;
+        std::string kind;
+        Field name_field = Field::Missing;
+        std::string name;
+        Field status_field = Field::Missing;
+        bool status = true;
+        bool has_expression = false;
+        Field expanded_field = Field::Missing;
+        std::string expanded;
+        bool has_path = false;
+        Chain path;
+    };
+
+    std::vector<TestEvent>& events_;
+    std::vector<Frame> frames_;
+    std::vector<Level> levels_;
+    std::vector<Item> items_;
+    Key key_ = Key::Other;
+    bool started_ = false;
+    bool has_cases_ = false;
+    bool valid_ = true;
+
+    // State of the test case currently being read
+    std::string case_name_;
+    bool case_name_invalid_ = false;
+    bool case_skipped_ = false;
+    std::size_t run_count_ = 0;
+    Chain sections_;
+    bool has_assertions_ = false;
+    bool assertions_invalid_ = false;
+    int failed_ = 0;
+    int skipped_ = 0;
+    int passed_ = 0;
+    std::vector<std::string> failures_;
+    bool failures_invalid_ = false;
+
+    [[nodiscard]] auto current() const -> Frame;
+    auto invalid() -> bool;
+    auto other_value() -> bool;
+    auto count(int value) -> bool;
+    auto push(Frame frame) -> bool;
+    auto begin_case() -> void;
+    auto end_case() -> bool;
+    auto end_item() -> void;
+    auto end_path() -> void;
+};
+
+} // namespace tdd_guard
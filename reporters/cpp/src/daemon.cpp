@@ -0,0 +1,386 @@
+#include "daemon.hpp"
+#include "hash.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace tdd_guard {
+
+namespace {
+
+// Bumped whenever the messages below change; a daemon declines requests
+// from other versions so those clients run in-process instead
+constexpr std::uint32_t PROTOCOL_VERSION = 2;
+
+constexpr std::uint32_t FLAG_SINGLE_THREADED = 1;
+
+// Followed by the project root as given on the command line. The client's
+// stdin and stdout travel with it as SCM_RIGHTS.
+struct Request {
+    std::uint32_t version;
+    std::uint32_t flags;
+    // The client's build_identity()
+    std::uint64_t build;
+};
+
+enum class Reply : std::uint32_t { Done, Declined };
+
+// Followed by whatever the run wrote to its error stream
+struct Response {
+    Reply reply;
+    std::int32_t status;
+};
+
+constexpr std::size_t MAX_MESSAGE = 64 * 1024;
+// Clients send their request as soon as they connect
+constexpr int REQUEST_TIMEOUT_MS = 5000;
+constexpr int PASSED_FDS = 2;
+
+auto make_address(const fs::path& socket_path) -> std::optional<sockaddr_un> {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto& native = socket_path.native();
+    if (native.empty() || native.size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+    return address;
+}
+
+auto connect_to(const sockaddr_un& address) -> int {
+    const int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+auto same_user(int fd) -> bool {
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    return ::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 &&
+           credentials.uid == ::geteuid();
+}
+
+auto send_response(int fd, Reply reply, int status, std::string_view errors) -> void {
+    std::string message(sizeof(Response), '\0');
+    const Response response{.reply = reply, .status = status};
+    std::memcpy(message.data(), &response, sizeof(response));
+    message.append(errors.substr(0, MAX_MESSAGE - sizeof(Response)));
+    (void)::send(fd, message.data(), message.size(), MSG_NOSIGNAL);
+}
+
+} // anonymous namespace
+
+auto build_identity() -> std::uint64_t {
+    struct stat binary{};
+    if (::stat("/proc/self/exe", &binary) != 0) {
+        return 0;
+    }
+    const std::array<std::uint64_t, 5> fields = {
+        static_cast<std::uint64_t>(binary.st_dev), static_cast<std::uint64_t>(binary.st_ino),
+        static_cast<std::uint64_t>(binary.st_size), static_cast<std::uint64_t>(binary.st_mtim.tv_sec),
+        static_cast<std::uint64_t>(binary.st_mtim.tv_nsec)
+    };
+    const auto identity = hash64({reinterpret_cast<const char*>(fields.data()), sizeof(fields)});
+    return identity != 0 ? identity : 1;
+}
+
+auto default_socket_path() -> fs::path {
+    if (const char* socket = std::getenv("TDD_GUARD_CPP_SOCKET"); socket != nullptr && *socket != '\0') {
+        return socket;
+    }
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime != nullptr && *runtime != '\0') {
+        return fs::path(runtime) / "tdd-guard-cpp.sock";
+    }
+    return "/tmp/tdd-guard-cpp-" + std::to_string(::geteuid()) + ".sock";
+}
+
+Daemon::~Daemon() {
+    for (const int fd : {listen_fd_, stop_pipe_[0], stop_pipe_[1]}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    for (auto& [root, dir] : results_dirs_) {
+        ::close(dir.fd);
+    }
+    if (!socket_path_.empty()) {
+        ::unlink(socket_path_.c_str());
+    }
+}
+
+auto Daemon::listen(const fs::path& socket_path, std::ostream& err) -> bool {
+    const auto address = make_address(socket_path);
+    if (!address) {
+        err << "Error: socket path is empty or too long: " << socket_path.string() << "\n";
+        return false;
+    }
+
+    if (const int running = connect_to(*address); running >= 0) {
+        ::close(running);
+        err << "Error: a daemon is already listening on " << socket_path.string() << "\n";
+        return false;
+    }
+    // Replace only a stale socket, never some other file at that path
+    struct stat existing{};
+    if (::lstat(socket_path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            err << "Error: not a socket: " << socket_path.string() << "\n";
+            return false;
+        }
+        ::unlink(socket_path.c_str());
+    }
+
+    if (::pipe2(stop_pipe_, O_CLOEXEC | O_NONBLOCK) != 0) {
+        err << "Error creating pipe: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        err << "Error creating socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // Only the owner may connect, whatever the umask
+    const auto old_mask = ::umask(0077);
+    const int bound = ::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&*address), sizeof(*address));
+    ::umask(old_mask);
+    if (bound != 0 || ::listen(listen_fd_, SOMAXCONN) != 0) {
+        err << "Error listening on " << socket_path.string() << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    socket_path_ = socket_path;
+    return true;
+}
+
+auto Daemon::serve() -> void {
+    std::array<pollfd, 2> fds = {
+        pollfd{.fd = listen_fd_, .events = POLLIN, .revents = 0},
+        pollfd{.fd = stop_pipe_[0], .events = POLLIN, .revents = 0},
+    };
+    while (true) {
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if ((fds[0].revents & POLLIN) == 0) {
+            continue;
+        }
+        const int client = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            continue;
+        }
+        {
+            const std::lock_guard lock(mutex_);
+            ++active_;
+        }
+        std::thread([this, client] {
+            handle(client);
+            ::close(client);
+            const std::lock_guard lock(mutex_);
+            if (--active_ == 0) {
+                idle_.notify_all();
+            }
+        }).detach();
+    }
+
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return active_ == 0; });
+}
+
+auto Daemon::stop() -> void {
+    const char byte = 0;
+    (void)::write(stop_pipe_[1], &byte, 1);
+}
+
+auto Daemon::handle(int client_fd) -> void {
+    // A client that connects and sends nothing must not keep stop() from
+    // ending serve()
+    std::array<pollfd, 2> ready = {
+        pollfd{.fd = client_fd, .events = POLLIN, .revents = 0},
+        pollfd{.fd = stop_pipe_[0], .events = POLLIN, .revents = 0},
+    };
+    int polled = 0;
+    do {
+        polled = ::poll(ready.data(), ready.size(), REQUEST_TIMEOUT_MS);
+    } while (polled < 0 && errno == EINTR);
+    if (polled <= 0 || ready[0].revents == 0) {
+        send_response(client_fd, Reply::Declined, 1, "");
+        return;
+    }
+
+    std::string message(MAX_MESSAGE, '\0');
+    iovec data{.iov_base = message.data(), .iov_len = message.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * PASSED_FDS)];
+    msghdr header{};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+
+    const auto received = ::recvmsg(client_fd, &header, MSG_CMSG_CLOEXEC);
+    std::array<int, PASSED_FDS> fds = {-1, -1};
+    std::size_t fd_count = 0;
+    for (auto* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            fd_count = std::min<std::size_t>((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int), PASSED_FDS);
+            std::memcpy(fds.data(), CMSG_DATA(cmsg), fd_count * sizeof(int));
+        }
+    }
+    const auto close_fds = [&] {
+        for (std::size_t i = 0; i < fd_count; ++i) {
+            ::close(fds[i]);
+        }
+    };
+
+    Request request{};
+    if (received < static_cast<ssize_t>(sizeof(Request)) || fd_count != PASSED_FDS ||
+        (header.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0 || !same_user(client_fd)) {
+        close_fds();
+        send_response(client_fd, Reply::Declined, 1, "");
+        return;
+    }
+    std::memcpy(&request, message.data(), sizeof(request));
+    if (request.version != PROTOCOL_VERSION || request.build != build_ || build_ == 0) {
+        close_fds();
+        send_response(client_fd, Reply::Declined, 1, "");
+        return;
+    }
+    const std::string project_root = message.substr(sizeof(Request), received - sizeof(Request));
+
+    std::ostringstream err;
+    int status = 1;
+    if (const int results_fd = results_dir(project_root, err); results_fd >= 0) {
+        const PassthroughOptions options{.single_threaded = (request.flags & FLAG_SINGLE_THREADED) != 0};
+        status = run_passthrough(results_fd, fds[0], fds[1], options, err);
+        ::close(results_fd);
+    }
+    // Close the client's pipes before replying so whoever reads its stdout
+    // sees EOF as soon as the client exits
+    close_fds();
+    send_response(client_fd, Reply::Done, status, err.view());
+}
+
+// A descriptor of its own for the caller. Cached directories are checked
+// against what the root's path names now, which catches moved, deleted and
+// re-pointed roots without resolving the path again.
+auto Daemon::results_dir(const std::string& project_root, std::ostream& err) -> int {
+    const std::lock_guard lock(mutex_);
+    if (const auto cached = results_dirs_.find(project_root); cached != results_dirs_.end()) {
+        struct stat current{};
+        if (::stat(cached->second.path.c_str(), &current) == 0 && current.st_dev == cached->second.device &&
+            current.st_ino == cached->second.inode) {
+            return ::fcntl(cached->second.fd, F_DUPFD_CLOEXEC, 0);
+        }
+        ::close(cached->second.fd);
+        results_dirs_.erase(cached);
+    }
+
+    const auto validated_root = validate_project_root(project_root, err);
+    if (!validated_root) {
+        return -1;
+    }
+    const int fd = open_results_dir(*validated_root, err);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat opened{};
+    ::fstat(fd, &opened);
+    results_dirs_.emplace(project_root, ResultsDir{
+        .fd = fd,
+        .device = opened.st_dev,
+        .inode = opened.st_ino,
+        .path = fs::path(project_root) / ".claude" / "tdd-guard" / "data"
+    });
+    return ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+}
+
+auto run_with_daemon(const fs::path& socket_path, std::string_view project_root, int in_fd, int out_fd,
+                     const PassthroughOptions& options, std::ostream& err) -> std::optional<int> {
+    const auto address = make_address(socket_path);
+    const auto build = build_identity();
+    if (!address || build == 0 || sizeof(Request) + project_root.size() > MAX_MESSAGE) {
+        return std::nullopt;
+    }
+    const int fd = connect_to(*address);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    // The pipes go only to a daemon of the same user
+    if (!same_user(fd)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    std::string message(sizeof(Request), '\0');
+    const Request request{
+        .version = PROTOCOL_VERSION,
+        .flags = options.single_threaded ? FLAG_SINGLE_THREADED : 0,
+        .build = build
+    };
+    std::memcpy(message.data(), &request, sizeof(request));
+    message.append(project_root);
+
+    const std::array<int, PASSED_FDS> fds = {in_fd, out_fd};
+    iovec data{.iov_base = message.data(), .iov_len = message.size()};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+    msghdr header{};
+    header.msg_iov = &data;
+    header.msg_iovlen = 1;
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    auto* cmsg = CMSG_FIRSTHDR(&header);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(fds));
+
+    if (::sendmsg(fd, &header, MSG_NOSIGNAL) < 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    std::string reply(MAX_MESSAGE, '\0');
+    ssize_t received = -1;
+    do {
+        received = ::recv(fd, reply.data(), reply.size(), 0);
+    } while (received < 0 && errno == EINTR);
+    ::close(fd);
+
+    if (received < static_cast<ssize_t>(sizeof(Response))) {
+        // The daemon took the input and went away; it cannot be run again
+        err << "Error: lost connection to the daemon on " << socket_path.string() << "\n";
+        return 1;
+    }
+    Response response{};
+    std::memcpy(&response, reply.data(), sizeof(response));
+    if (response.reply == Reply::Declined) {
+        return std::nullopt;
+    }
+    err << std::string_view(reply).substr(sizeof(Response), received - sizeof(Response));
+    return response.status;
+}
+
+} // namespace tdd_guard
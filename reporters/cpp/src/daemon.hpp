@@ -0,0 +1,78 @@
+#pragma once
+
+#include "reporter.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+
+namespace tdd_guard {
+
+// $TDD_GUARD_CPP_SOCKET, else tdd-guard-cpp.sock in $XDG_RUNTIME_DIR, else
+// /tmp/tdd-guard-cpp-<uid>.sock
+[[nodiscard]] auto default_socket_path() -> std::filesystem::path;
+
+// Identifies the reporter binary this process runs by the file behind
+// /proc/self/exe, which a rebuild or an upgrade replaces or touches. 0 when
+// the binary cannot be examined.
+[[nodiscard]] auto build_identity() -> std::uint64_t;
+
+// Serves passthrough runs for clients of the same user. A client hands over
+// its stdin and stdout, the daemon forwards and saves exactly as an
+// in-process run would and replies with the exit status. Project roots are
+// validated once; their results directories stay open between runs.
+// Clients of another build are declined and run in-process, so a daemon
+// left running from before a rebuild never handles their runs.
+class Daemon {
+public:
+    explicit Daemon(std::uint64_t build = build_identity()) : build_(build) {}
+    ~Daemon();
+    Daemon(const Daemon&) = delete;
+    auto operator=(const Daemon&) -> Daemon& = delete;
+
+    // Binds the socket, replacing a stale one no daemon answers on
+    [[nodiscard]] auto listen(const std::filesystem::path& socket_path, std::ostream& err) -> bool;
+
+    // Accepts clients until stop(), then waits for runs in progress
+    auto serve() -> void;
+
+    // Safe to call from a signal handler
+    auto stop() -> void;
+
+private:
+    struct ResultsDir {
+        int fd = -1;
+        dev_t device = 0;
+        ino_t inode = 0;
+        std::filesystem::path path;
+    };
+
+    std::uint64_t build_;
+    std::filesystem::path socket_path_;
+    int listen_fd_ = -1;
+    int stop_pipe_[2] = {-1, -1};
+
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::size_t active_ = 0;
+    std::unordered_map<std::string, ResultsDir> results_dirs_;
+
+    auto handle(int client_fd) -> void;
+    auto results_dir(const std::string& project_root, std::ostream& err) -> int;
+};
+
+// Has the daemon on socket_path forward in_fd to out_fd and save the report
+// under project_root. Empty when no daemon accepted the run, in which case
+// nothing has been read and the caller runs in-process.
+[[nodiscard]] auto run_with_daemon(const std::filesystem::path& socket_path, std::string_view project_root,
+                                   int in_fd, int out_fd, const PassthroughOptions& options,
+                                   std::ostream& err) -> std::optional<int>;
+
+} // namespace tdd_guard
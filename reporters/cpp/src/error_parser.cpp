@@ -1,27 +1,39 @@
 #include "error_parser.hpp"
-#include <algorithm>
-#include <ranges>
-#include <regex>
+#include <cstring>
 
 namespace tdd_guard {
 
 namespace {
 
-// GCC/Clang format: file.cpp:10:5: error: message (also matches "fatal error:")
-const std::regex GCC_ERROR_RE{R"(^(.+?):(\d+):(\d+):\s*(?:fatal\s+)?error:\s*(.+))"};
-// GCC/Clang format without column: file.cpp:10: error: message (also matches "fatal error:")
-const std::regex GCC_ERROR_NO_COL_RE{R"(^(.+?):(\d+):\s*(?:fatal\s+)?error:\s*(.+))"};
-// MSVC format: file.cpp(10): error C2001: message
-const std::regex MSVC_ERROR_RE{R"(^(.+?)\((\d+)\):\s*error\s+C(\d+):\s*(.+))"};
-// Simple error: error: message (no location)
-const std::regex SIMPLE_ERROR_RE{R"(^error:\s*(.+))"};
-// Note lines
-const std::regex NOTE_RE{R"(^\s*note:\s*(.+))"};
-// ANSI escape codes for stripping
-const std::regex ANSI_ESCAPE_RE{R"(\x1b\[[0-9;]*m)"};
+// Removes SGR color sequences (ESC '[' [0-9;]* 'm'). Returns the line
+// itself when it has none, otherwise the stripped copy held in scratch.
+auto strip_ansi_codes(std::string_view s, std::string& scratch) -> std::string_view {
+    auto escape = s.find('\x1b');
+    if (escape == std::string_view::npos) {
+        return s;
+    }
 
-auto strip_ansi_codes(std::string_view s) -> std::string {
-    return std::regex_replace(std::string(s), ANSI_ESCAPE_RE, "");
+    scratch.clear();
+    std::size_t copied = 0;
+    while (escape != std::string_view::npos) {
+        auto pos = escape + 1;
+        if (pos < s.size() && s[pos] == '[') {
+            ++pos;
+            while (pos < s.size() && ((s[pos] >= '0' && s[pos] <= '9') || s[pos] == ';')) ++pos;
+            if (pos < s.size() && s[pos] == 'm') {
+                scratch.append(s.substr(copied, escape - copied));
+                copied = pos + 1;
+                escape = s.find('\x1b', copied);
+                continue;
+            }
+        }
+        escape = s.find('\x1b', escape + 1);
+    }
+    if (copied == 0) {
+        return s;
+    }
+    scratch.append(s.substr(copied));
+    return scratch;
 }
 
 auto append_to_field(std::optional<std::string>& field, std::string_view text) -> void {
@@ -44,105 +56,299 @@ auto has_error_indicator(std::string_view line) -> bool {
            line.find("fatal error:") != std::string_view::npos;
 }
 
-auto parse_error_line(std::string_view line) -> std::optional<CompilationError> {
-    std::string line_str(line);
-    std::smatch match;
+// The recognized forms, tried in this order:
+//   GCC/Clang:    file:line:column: [fatal ]error: message
+//   GCC/Clang:    file:line: [fatal ]error: message
+//   MSVC:         file(line): error Cnnnn: message
+//   Simple:       error: message
+//   Note:         note: message (attached to the preceding error)
+// They are matched with the semantics of the ECMAScript patterns they
+// replace: the file is the shortest prefix after which the rest matches,
+// whitespace is [ \t\n\v\f\r] and message text stops at a line break.
+// Every check starting at a candidate ':' or '(' stops before the third
+// delimiter after it, so a line is scanned in linear time without
+// recursion however long it is.
+
+auto is_space(char c) -> bool {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// Characters the message and file text cannot contain
+auto is_line_break(char c) -> bool {
+    return c == '\n' || c == '\r';
+}
 
-    // GCC/Clang format with full location: file.cpp:10:5: error: message
-    if (std::regex_search(line_str, match, GCC_ERROR_RE)) {
-        return CompilationError{
-            .file = match[1].str(),
-            .line = static_cast<uint32_t>(std::stoul(match[2].str())),
-            .column = static_cast<uint32_t>(std::stoul(match[3].str())),
-            .message = match[4].str()
-        };
+auto is_digit(char c) -> bool {
+    return c >= '0' && c <= '9';
+}
+
+auto skip_spaces(std::string_view line, std::size_t pos) -> std::size_t {
+    while (pos < line.size() && is_space(line[pos])) ++pos;
+    return pos;
+}
+
+auto skip_digits(std::string_view line, std::size_t pos) -> std::size_t {
+    while (pos < line.size() && is_digit(line[pos])) ++pos;
+    return pos;
+}
+
+auto has_at(std::string_view line, std::size_t pos, std::string_view text) -> bool {
+    return pos <= line.size() && line.substr(pos).starts_with(text);
+}
+
+// Digits that overflow 32 bits clamp instead of wrapping
+auto to_number(std::string_view digits) -> uint32_t {
+    uint64_t value = 0;
+    for (const char c : digits) {
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+        if (value > UINT32_MAX) {
+            return UINT32_MAX;
+        }
     }
+    return static_cast<uint32_t>(value);
+}
 
-    // GCC/Clang format without column: file.cpp:10: error: message
-    if (std::regex_search(line_str, match, GCC_ERROR_NO_COL_RE)) {
-        return CompilationError{
-            .file = match[1].str(),
-            .line = static_cast<uint32_t>(std::stoul(match[2].str())),
-            .message = match[3].str()
-        };
+// Matches \s*(.+) from pos. Trailing whitespace alone still yields its last
+// character that is not a line break, as the backtracking pattern did.
+auto match_message(std::string_view line, std::size_t pos) -> std::optional<std::string_view> {
+    auto start = skip_spaces(line, pos);
+    if (start == line.size()) {
+        while (start > pos && is_line_break(line[start - 1])) --start;
+        if (start == pos) {
+            return std::nullopt;
+        }
+        --start;
     }
 
-    // MSVC format: file.cpp(10): error C2001: message
-    if (std::regex_search(line_str, match, MSVC_ERROR_RE)) {
-        return CompilationError{
-            .code = "C" + match[3].str(),
-            .file = match[1].str(),
-            .line = static_cast<uint32_t>(std::stoul(match[2].str())),
-            .message = match[4].str()
-        };
+    auto end = start;
+    while (end < line.size() && !is_line_break(line[end])) ++end;
+    return line.substr(start, end - start);
+}
+
+// Matches \s*(?:fatal\s+)?error:\s*(.+) from pos
+auto match_error_message(std::string_view line, std::size_t pos) -> std::optional<std::string_view> {
+    pos = skip_spaces(line, pos);
+    if (has_at(line, pos, "fatal")) {
+        const auto after = skip_spaces(line, pos + 5);
+        if (after == pos + 5) {
+            return std::nullopt;
+        }
+        pos = after;
+    }
+    if (!has_at(line, pos, "error:")) {
+        return std::nullopt;
     }
+    return match_message(line, pos + 6);
+}
 
-    // Simple error format: error: message
-    if (std::regex_search(line_str, match, SIMPLE_ERROR_RE)) {
-        return CompilationError{.message = match[1].str()};
+// Matches (\d+) followed by terminator at pos; returns the digits
+auto match_number(std::string_view line, std::size_t pos, char terminator)
+    -> std::optional<std::string_view> {
+    const auto end = skip_digits(line, pos);
+    if (end == pos || end == line.size() || line[end] != terminator) {
+        return std::nullopt;
     }
+    return line.substr(pos, end - pos);
+}
 
-    return std::nullopt;
+// file:line:column: error at the ':' ending the file
+auto match_gcc(std::string_view line, std::size_t colon) -> std::optional<CompilationError> {
+    const auto line_number = match_number(line, colon + 1, ':');
+    if (!line_number) return std::nullopt;
+    const auto column_start = colon + 1 + line_number->size() + 1;
+    const auto column = match_number(line, column_start, ':');
+    if (!column) return std::nullopt;
+    const auto message = match_error_message(line, column_start + column->size() + 1);
+    if (!message) return std::nullopt;
+
+    return CompilationError{
+        .file = std::string(line.substr(0, colon)),
+        .line = to_number(*line_number),
+        .column = to_number(*column),
+        .message = std::string(*message)
+    };
 }
 
-} // anonymous namespace
+// file:line: error at the ':' ending the file
+auto match_gcc_no_column(std::string_view line, std::size_t colon) -> std::optional<CompilationError> {
+    const auto line_number = match_number(line, colon + 1, ':');
+    if (!line_number) return std::nullopt;
+    const auto message = match_error_message(line, colon + 1 + line_number->size() + 1);
+    if (!message) return std::nullopt;
 
-auto parse_error_buffer(const std::vector<std::string>& lines)
-    -> std::vector<CompilationError> {
+    return CompilationError{
+        .file = std::string(line.substr(0, colon)),
+        .line = to_number(*line_number),
+        .message = std::string(*message)
+    };
+}
 
-    std::vector<std::string> cleaned;
-    cleaned.reserve(lines.size());
-    for (const auto& line : lines) {
-        cleaned.push_back(strip_ansi_codes(line));
-    }
+// file(line): error Cnnnn: at the '(' ending the file
+auto match_msvc(std::string_view line, std::size_t paren) -> std::optional<CompilationError> {
+    const auto line_number = match_number(line, paren + 1, ')');
+    if (!line_number) return std::nullopt;
+    auto pos = paren + 1 + line_number->size() + 1;
+    if (!has_at(line, pos, ":")) return std::nullopt;
+    pos = skip_spaces(line, pos + 1);
+    if (!has_at(line, pos, "error")) return std::nullopt;
+    const auto after = skip_spaces(line, pos + 5);
+    if (after == pos + 5 || !has_at(line, after, "C")) return std::nullopt;
+    const auto code = match_number(line, after + 1, ':');
+    if (!code) return std::nullopt;
+    const auto message = match_message(line, after + 1 + code->size() + 1);
+    if (!message) return std::nullopt;
 
-    std::vector<CompilationError> errors;
-    std::optional<CompilationError> current_error;
+    return CompilationError{
+        .code = "C" + std::string(*code),
+        .file = std::string(line.substr(0, paren)),
+        .line = to_number(*line_number),
+        .message = std::string(*message)
+    };
+}
 
-    for (const auto& line : cleaned) {
-        if (is_boilerplate(line)) {
-            continue;
-        }
+auto parse_error_line(std::string_view line) -> std::optional<CompilationError> {
+    // The file name is at least one character and cannot span a line break
+    std::size_t file_limit = 0;
+    while (file_limit < line.size() && !is_line_break(line[file_limit])) ++file_limit;
 
-        if (auto error = parse_error_line(line); error.has_value()) {
-            if (current_error.has_value()) {
-                errors.push_back(std::move(*current_error));
+    // One pass over the candidate file ends: the first full GCC match wins
+    // outright, otherwise the first match of each later form is kept
+    std::optional<CompilationError> no_column;
+    std::optional<CompilationError> msvc;
+    for (std::size_t pos = 1; pos < file_limit; ++pos) {
+        if (line[pos] == ':') {
+            if (auto error = match_gcc(line, pos)) {
+                return error;
+            }
+            if (!no_column) {
+                no_column = match_gcc_no_column(line, pos);
             }
-            current_error = std::move(*error);
-            continue;
+        } else if (line[pos] == '(' && !msvc) {
+            msvc = match_msvc(line, pos);
+        }
+    }
+
+    if (no_column) {
+        return no_column;
+    }
+    if (msvc) {
+        return msvc;
+    }
+    if (has_at(line, 0, "error:")) {
+        if (auto message = match_message(line, 6)) {
+            return CompilationError{.message = std::string(*message)};
         }
+    }
+    return std::nullopt;
+}
+
+// Matches ^\s*note:\s*(.+)
+auto match_note(std::string_view line) -> std::optional<std::string_view> {
+    const auto pos = skip_spaces(line, 0);
+    if (!has_at(line, pos, "note:")) {
+        return std::nullopt;
+    }
+    return match_message(line, pos + 5);
+}
+
+} // anonymous namespace
 
-        // Parse note lines and attach to current error
-        if (current_error.has_value()) {
-            std::smatch match;
-            std::string line_str(line);
+auto ErrorParser::add_line(std::string_view raw_line, bool has_escape) -> void {
+    const auto line = has_escape ? strip_ansi_codes(raw_line, scratch_) : raw_line;
 
-            if (std::regex_search(line_str, match, NOTE_RE)) {
-                append_to_field(current_error->note, match[1].str());
+    // Without a marker the line can neither start an error nor call for the
+    // fallback; at most it is a note
+    if (find_error_marker(line) == std::string_view::npos) {
+        if (current_.has_value()) {
+            if (auto note = match_note(line); note && !is_boilerplate(line)) {
+                append_to_field(current_->note, *note);
             }
         }
+        return;
     }
 
-    if (current_error.has_value()) {
-        errors.push_back(std::move(*current_error));
+    found_error_ = found_error_ || has_error_indicator(line);
+
+    if (is_boilerplate(line)) {
+        return;
     }
 
-    // Fallback: if no structured errors but error indicators exist, create generic error
-    if (errors.empty()) {
-        bool found_error = std::ranges::any_of(cleaned, has_error_indicator);
-        if (found_error) {
-            std::string all_output;
-            for (const auto& line : cleaned) {
-                all_output += line + "\n";
-            }
-            errors.push_back(CompilationError{
-                .message = "Compilation failed",
-                .note = all_output
-            });
+    if (auto error = parse_error_line(line); error.has_value()) {
+        if (current_.has_value()) {
+            errors_.push_back(std::move(*current_));
+        }
+        current_ = std::move(*error);
+        found_structured_ = true;
+        return;
+    }
+
+    // Parse note lines and attach to current error
+    if (current_.has_value()) {
+        if (auto note = match_note(line)) {
+            append_to_field(current_->note, *note);
         }
     }
+}
+
+auto ErrorParser::finish() -> std::vector<CompilationError> {
+    if (current_.has_value()) {
+        errors_.push_back(std::move(*current_));
+        current_.reset();
+    }
+    return std::move(errors_);
+}
+
+auto ErrorParser::needs_fallback() const -> bool {
+    return found_error_ && !found_structured_;
+}
+
+auto ErrorParser::has_open_error() const -> bool {
+    return current_.has_value();
+}
+
+auto find_error_marker(std::string_view text) -> std::size_t {
+    constexpr std::string_view marker = "error";
+    // memmem is vectorized in common C libraries, unlike a search that
+    // stops at every 'e'
+    const void* found = ::memmem(text.data(), text.size(), marker.data(), marker.size());
+    if (found == nullptr) {
+        return std::string_view::npos;
+    }
+    return static_cast<std::size_t>(static_cast<const char*>(found) - text.data());
+}
+
+auto fallback_error(std::span<const std::string_view> lines) -> CompilationError {
+    std::string scratch;
+    std::string all_output;
+    for (const auto raw_line : lines) {
+        all_output += strip_ansi_codes(raw_line, scratch);
+        all_output += "\n";
+    }
+    return CompilationError{
+        .message = "Compilation failed",
+        .note = all_output
+    };
+}
 
+auto parse_error_buffer(std::span<const std::string_view> lines)
+    -> std::vector<CompilationError> {
+    ErrorParser parser;
+    for (const auto line : lines) {
+        parser.add_line(line);
+    }
+
+    // Fallback: if no structured errors but error indicators exist, create generic error
+    auto errors = parser.finish();
+    if (parser.needs_fallback()) {
+        errors.push_back(fallback_error(lines));
+    }
     return errors;
 }
 
+auto parse_error_buffer(const std::vector<std::string>& lines)
+    -> std::vector<CompilationError> {
+    const std::vector<std::string_view> views(lines.begin(), lines.end());
+    return parse_error_buffer(views);
+}
+
 } // namespace tdd_guard
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tdd_guard {
@@ -17,6 +20,42 @@ struct CompilationError {
     std::optional<std::string> note = std::nullopt;
 };
 
+// Incremental form of parse_error_buffer for lines that arrive one at a time
+class ErrorParser {
+public:
+    // Lines known to contain no ESC byte skip color stripping
+    auto add_line(std::string_view line, bool has_escape = true) -> void;
+
+    // Closes the error being assembled and returns every error parsed
+    [[nodiscard]] auto finish() -> std::vector<CompilationError>;
+
+    // True when lines mentioned errors but none could be parsed; the output
+    // is then reported through fallback_error instead
+    [[nodiscard]] auto needs_fallback() const -> bool;
+
+    // True once an error has been parsed; any later line may add a note
+    // to it. Before that, only lines with an error marker can matter.
+    [[nodiscard]] auto has_open_error() const -> bool;
+
+private:
+    std::vector<CompilationError> errors_;
+    std::optional<CompilationError> current_;
+    std::string scratch_;
+    bool found_error_ = false;
+    bool found_structured_ = false;
+};
+
+// Offset of the first "error" in text, or npos. Every line that parse
+// recognizes or that calls for the fallback contains one, once color
+// codes are stripped.
+[[nodiscard]] auto find_error_marker(std::string_view text) -> std::size_t;
+
+// Generic error carrying the whole ANSI-stripped output
+[[nodiscard]] auto fallback_error(std::span<const std::string_view> lines) -> CompilationError;
+
+[[nodiscard]] auto parse_error_buffer(std::span<const std::string_view> lines)
+    -> std::vector<CompilationError>;
+
 [[nodiscard]] auto parse_error_buffer(const std::vector<std::string>& lines)
     -> std::vector<CompilationError>;
 
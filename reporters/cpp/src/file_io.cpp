@@ -0,0 +1,68 @@
+#include "file_io.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace tdd_guard {
+
+namespace {
+
+// Numbers the temp files of this process
+constinit std::atomic<std::uint64_t> temp_count{0};
+
+// Creates a temp file for name that no other save uses, whether it runs in
+// this process, such as the daemon's concurrent clients, or in another one
+auto open_temp(int dir_fd, const std::string& name, std::string& temp) -> int {
+    for (;;) {
+        temp = name + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(temp_count++);
+        const int fd = ::openat(dir_fd, temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        // A file left behind by a process that had the same pid is skipped
+        if (fd >= 0 || errno != EEXIST) {
+            return fd;
+        }
+    }
+}
+
+} // anonymous namespace
+
+auto write_all(int fd, std::string_view data) -> bool {
+    while (!data.empty()) {
+        const auto written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+auto replace_file_with(int dir_fd, const std::string& name, const std::function<bool(int)>& write) -> bool {
+    std::string temp;
+    const int fd = open_temp(dir_fd, name, temp);
+    if (fd < 0) {
+        return false;
+    }
+    const bool written = write(fd);
+    int error = errno;
+    const bool closed = ::close(fd) == 0;
+    if (written && closed && ::renameat(dir_fd, temp.c_str(), dir_fd, name.c_str()) == 0) {
+        return true;
+    }
+    if (written) {
+        error = errno;
+    }
+    ::unlinkat(dir_fd, temp.c_str(), 0);
+    errno = error;
+    return false;
+}
+
+auto replace_file(int dir_fd, const std::string& name, std::string_view content) -> bool {
+    return replace_file_with(dir_fd, name, [content](int fd) { return write_all(fd, content); });
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace tdd_guard {
+
+// Writes all of data to fd, retrying after signals. Returns false once fd
+// stops accepting data.
+[[nodiscard]] auto write_all(int fd, std::string_view data) -> bool;
+
+// Writes name in dir_fd through a temp file renamed into place, so readers
+// find either the old file or the new one. Each call has a temp file of its
+// own, so saves of the same name may run at once. write fills the temp file
+// through its descriptor and returns false once writing fails. The temp
+// file is removed whenever name is not replaced. Returns false with errno
+// set.
+[[nodiscard]] auto replace_file_with(int dir_fd, const std::string& name, const std::function<bool(int)>& write)
+    -> bool;
+
+// replace_file_with for content already in memory
+[[nodiscard]] auto replace_file(int dir_fd, const std::string& name, std::string_view content) -> bool;
+
+} // namespace tdd_guard
@@ -0,0 +1,239 @@
+#include "googletest_sax.hpp"
+#include <string_view>
+
+namespace tdd_guard {
+
+namespace {
+
+auto compose_full_name(const std::string& suite_name, const std::string& test_name) -> std::string {
+    return suite_name.empty() ? test_name : suite_name + "." + test_name;
+}
+
+} // anonymous namespace
+
+GoogleTestSax::GoogleTestSax(std::vector<TestEvent>& events) : events_(events) {}
+
+auto GoogleTestSax::succeeded() const -> bool {
+    return valid_ && has_suites_;
+}
+
+auto GoogleTestSax::claimed() const -> bool {
+    return has_suites_;
+}
+
+auto GoogleTestSax::current() const -> Frame {
+    return frames_.empty() ? Frame::Skip : frames_.back();
+}
+
+auto GoogleTestSax::invalid() -> bool {
+    valid_ = false;
+    return false;
+}
+
+// Any value that does not open a frame of interest. Type mismatches on
+// fields the reporter reads fail the document, as the DOM lookups did.
+auto GoogleTestSax::scalar() -> bool {
+    started_ = true;
+    switch (current()) {
+        case Frame::Document:
+            if (key_ == Key::TestSuites) return invalid();
+            break;
+        case Frame::Suite:
+            if (key_ == Key::Name) suite_name_valid_ = false;
+            break;
+        case Frame::Test:
+            if (key_ == Key::Name || key_ == Key::Status) return invalid();
+            break;
+        case Frame::Failures:
+            ++test_failure_count_;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+auto GoogleTestSax::null() -> bool {
+    return scalar();
+}
+
+auto GoogleTestSax::boolean(bool /*value*/) -> bool {
+    return scalar();
+}
+
+auto GoogleTestSax::number_integer(std::int64_t /*value*/) -> bool {
+    return scalar();
+}
+
+auto GoogleTestSax::number_unsigned(std::uint64_t /*value*/) -> bool {
+    return scalar();
+}
+
+auto GoogleTestSax::number_float(double /*value*/, const std::string& /*text*/) -> bool {
+    return scalar();
+}
+
+auto GoogleTestSax::string(std::string& value) -> bool {
+    switch (current()) {
+        case Frame::Suite:
+            if (key_ != Key::Name) break;
+            suite_name_ = value;
+            suite_name_valid_ = true;
+            // Tests already read were named without the suite prefix
+            for (auto i = suite_first_event_; i < events_.size(); ++i) {
+                events_[i].full_name = compose_full_name(suite_name_, events_[i].name);
+            }
+            return true;
+        case Frame::Test:
+            if (key_ == Key::Name) {
+                test_.name = value;
+                return true;
+            }
+            if (key_ == Key::Status) {
+                test_skipped_ = value == "NOTRUN";
+                return true;
+            }
+            if (key_ == Key::Time) {
+                test_.duration = parse_duration(value);
+                return true;
+            }
+            break;
+        case Frame::Failure:
+            if (key_ == Key::Message) {
+                test_.failure_messages.push_back(value);
+            }
+            return true;
+        default:
+            break;
+    }
+    return scalar();
+}
+
+auto GoogleTestSax::start_object(std::size_t /*elements*/) -> bool {
+    if (!started_) {
+        started_ = true;
+        frames_.push_back(Frame::Document);
+        return true;
+    }
+
+    switch (current()) {
+        case Frame::Suites:
+            suite_name_.clear();
+            suite_name_valid_ = true;
+            suite_has_tests_ = false;
+            suite_first_event_ = events_.size();
+            frames_.push_back(Frame::Suite);
+            return true;
+        case Frame::Tests:
+            test_ = TestEvent{};
+            test_skipped_ = false;
+            test_failure_count_ = 0;
+            frames_.push_back(Frame::Test);
+            return true;
+        case Frame::Failures:
+            ++test_failure_count_;
+            frames_.push_back(Frame::Failure);
+            return true;
+        default:
+            break;
+    }
+
+    if (!scalar()) {
+        return false;
+    }
+    frames_.push_back(Frame::Skip);
+    return true;
+}
+
+auto GoogleTestSax::key(std::string& name) -> bool {
+    const std::string_view view = name;
+    switch (current()) {
+        case Frame::Document:
+            key_ = view == "testsuites" ? Key::TestSuites : Key::Other;
+            break;
+        case Frame::Suite:
+            key_ = view == "name" ? Key::Name
+                 : view == "testsuite" ? Key::TestSuite
+                 : Key::Other;
+            break;
+        case Frame::Test:
+            key_ = view == "name" ? Key::Name
+                 : view == "status" ? Key::Status
+                 : view == "time" ? Key::Time
+                 : view == "failures" ? Key::Failures
+                 : Key::Other;
+            break;
+        case Frame::Failure:
+            key_ = view == "message" ? Key::Message : Key::Other;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+auto GoogleTestSax::end_object() -> bool {
+    const auto frame = current();
+    frames_.pop_back();
+
+    if (frame == Frame::Test) {
+        if (test_skipped_) {
+            test_.state = TestEvent::State::Skipped;
+            test_.failure_messages.clear();
+        } else if (test_failure_count_ > 0) {
+            test_.state = TestEvent::State::Failed;
+        } else {
+            test_.state = TestEvent::State::Passed;
+        }
+        test_.full_name = compose_full_name(suite_name_, test_.name);
+        events_.push_back(std::move(test_));
+    } else if (frame == Frame::Suite) {
+        if (suite_has_tests_ && !suite_name_valid_) {
+            return invalid();
+        }
+    }
+    return true;
+}
+
+auto GoogleTestSax::start_array(std::size_t /*elements*/) -> bool {
+    if (started_) {
+        switch (current()) {
+            case Frame::Document:
+                if (key_ == Key::TestSuites) {
+                    has_suites_ = true;
+                    frames_.push_back(Frame::Suites);
+                    return true;
+                }
+                break;
+            case Frame::Suite:
+                if (key_ == Key::TestSuite) {
+                    suite_has_tests_ = true;
+                    frames_.push_back(Frame::Tests);
+                    return true;
+                }
+                break;
+            case Frame::Test:
+                if (key_ == Key::Failures) {
+                    test_failure_count_ = 0;
+                    frames_.push_back(Frame::Failures);
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (!scalar()) {
+        return false;
+    }
+    frames_.push_back(Frame::Skip);
+    return true;
+}
+
+auto GoogleTestSax::end_array() -> bool {
+    frames_.pop_back();
+    return true;
+}
+
+} // namespace tdd_guard
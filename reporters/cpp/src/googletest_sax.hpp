@@ -0,0 +1,63 @@
+#pragma once
+
+#include "json_stream.hpp"
+#include "parser.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tdd_guard {
+
+// Builds TestEvents from GoogleTest JSON while it is being tokenized instead
+// of walking a DOM. Only testsuites[].testsuite[] entries are retained; keys
+// the reporter does not use are skipped without copying their values.
+class GoogleTestSax final : public JsonHandler {
+public:
+    explicit GoogleTestSax(std::vector<TestEvent>& events);
+
+    // True when the document was a complete GoogleTest report
+    [[nodiscard]] auto succeeded() const -> bool;
+    // True once the testsuites array has been reached, which identifies the
+    // framework before any test has been read
+    [[nodiscard]] auto claimed() const -> bool;
+
+    auto null() -> bool override;
+    auto boolean(bool value) -> bool override;
+    auto number_integer(std::int64_t value) -> bool override;
+    auto number_unsigned(std::uint64_t value) -> bool override;
+    auto number_float(double value, const std::string& text) -> bool override;
+    auto string(std::string& value) -> bool override;
+
+    auto start_object(std::size_t elements) -> bool override;
+    auto key(std::string& name) -> bool override;
+    auto end_object() -> bool override;
+    auto start_array(std::size_t elements) -> bool override;
+    auto end_array() -> bool override;
+
+private:
+    enum class Frame { Document, Suites, Suite, Tests, Test, Failures, Failure, Skip };
+    enum class Key { Other, TestSuites, TestSuite, Name, Status, Time, Failures, Message };
+
+    std::vector<TestEvent>& events_;
+    std::vector<Frame> frames_;
+    Key key_ = Key::Other;
+    bool started_ = false;
+    bool has_suites_ = false;
+    bool valid_ = true;
+
+    // State of the suite and test currently being read
+    std::string suite_name_;
+    bool suite_name_valid_ = true;
+    bool suite_has_tests_ = false;
+    std::size_t suite_first_event_ = 0;
+    TestEvent test_;
+    bool test_skipped_ = false;
+    std::size_t test_failure_count_ = 0;
+
+    [[nodiscard]] auto current() const -> Frame;
+    auto scalar() -> bool;
+    auto invalid() -> bool;
+};
+
+} // namespace tdd_guard
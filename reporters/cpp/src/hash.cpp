@@ -0,0 +1,100 @@
+#include "hash.hpp"
+#include <bit>
+#include <cstring>
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr std::uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+auto swap_bytes(std::uint64_t value) -> std::uint64_t {
+    return __builtin_bswap64(value);
+}
+
+auto swap_bytes(std::uint32_t value) -> std::uint32_t {
+    return __builtin_bswap32(value);
+}
+
+// Input is read little-endian, as the reference implementation does
+auto read64(const char* p) -> std::uint64_t {
+    std::uint64_t value = 0;
+    std::memcpy(&value, p, sizeof(value));
+    return std::endian::native == std::endian::little ? value : swap_bytes(value);
+}
+
+auto read32(const char* p) -> std::uint32_t {
+    std::uint32_t value = 0;
+    std::memcpy(&value, p, sizeof(value));
+    return std::endian::native == std::endian::little ? value : swap_bytes(value);
+}
+
+auto mix_lane(std::uint64_t acc, std::uint64_t input) -> std::uint64_t {
+    acc += input * PRIME2;
+    return std::rotl(acc, 31) * PRIME1;
+}
+
+auto merge_lane(std::uint64_t acc, std::uint64_t value) -> std::uint64_t {
+    acc ^= mix_lane(0, value);
+    return acc * PRIME1 + PRIME4;
+}
+
+} // anonymous namespace
+
+auto hash64(std::string_view data, std::uint64_t seed) -> std::uint64_t {
+    const char* p = data.data();
+    const char* const end = p + data.size();
+    std::uint64_t hash = 0;
+
+    if (data.size() >= 32) {
+        // Four independent lanes keep the multipliers busy
+        std::uint64_t v1 = seed + PRIME1 + PRIME2;
+        std::uint64_t v2 = seed + PRIME2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - PRIME1;
+        const char* const limit = end - 32;
+        do {
+            v1 = mix_lane(v1, read64(p));
+            v2 = mix_lane(v2, read64(p + 8));
+            v3 = mix_lane(v3, read64(p + 16));
+            v4 = mix_lane(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+        hash = merge_lane(hash, v1);
+        hash = merge_lane(hash, v2);
+        hash = merge_lane(hash, v3);
+        hash = merge_lane(hash, v4);
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += data.size();
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= mix_lane(0, read64(p));
+        hash = std::rotl(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end) {
+        hash ^= std::uint64_t{read32(p)} * PRIME1;
+        hash = std::rotl(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= std::uint64_t{static_cast<unsigned char>(*p)} * PRIME5;
+        hash = std::rotl(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} // namespace tdd_guard
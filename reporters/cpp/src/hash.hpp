@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace tdd_guard {
+
+// XXH64: a fast non-cryptographic hash, several GB/s per core, for telling
+// whether content changed. Not for anything an attacker controls.
+[[nodiscard]] auto hash64(std::string_view data, std::uint64_t seed = 0) -> std::uint64_t;
+
+} // namespace tdd_guard
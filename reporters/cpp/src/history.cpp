@@ -0,0 +1,203 @@
+#include "history.hpp"
+#include "json_stream.hpp"
+#include "mapped_file.hpp"
+#include "transformer.hpp"
+#include <cmath>
+#include <cstdint>
+
+namespace tdd_guard {
+
+namespace {
+
+// Collects testModules[].tests[] entries. Everything else, errors and the
+// timing summary included, is skipped without copying. Unlike OutputReader
+// this does not reject the document: history only orders and balances the
+// next run, so the tests of a test.json cut short by a crash are still
+// worth more than none.
+class HistoryReader final : public JsonHandler {
+public:
+    explicit HistoryReader(std::vector<TestRecord>& records) : records_(records) {}
+
+    auto null() -> bool override {
+        return true;
+    }
+    auto boolean(bool /*value*/) -> bool override {
+        return true;
+    }
+    auto number_integer(std::int64_t value) -> bool override {
+        return number(static_cast<double>(value));
+    }
+    auto number_unsigned(std::uint64_t value) -> bool override {
+        return number(static_cast<double>(value));
+    }
+    auto number_float(double value, const std::string& /*text*/) -> bool override {
+        return number(value);
+    }
+
+    auto string(std::string& value) -> bool override {
+        if (current() == Frame::Test) {
+            if (key_ == Key::FullName) {
+                test_.full_name = std::move(value);
+            } else if (key_ == Key::State) {
+                test_.state = parse_state(value).value_or(TestEvent::State::Unknown);
+            }
+        }
+        return true;
+    }
+
+    auto start_object(std::size_t /*elements*/) -> bool override {
+        if (!started_) {
+            started_ = true;
+            frames_.push_back(Frame::Document);
+        } else if (current() == Frame::Modules) {
+            frames_.push_back(Frame::Module);
+        } else if (current() == Frame::Tests) {
+            test_ = TestRecord{};
+            frames_.push_back(Frame::Test);
+        } else {
+            frames_.push_back(Frame::Skip);
+        }
+        return true;
+    }
+
+    auto key(std::string& name) -> bool override {
+        const std::string_view view = name;
+        switch (current()) {
+            case Frame::Document:
+                key_ = view == "testModules" ? Key::TestModules : Key::Other;
+                break;
+            case Frame::Module:
+                key_ = view == "tests" ? Key::Tests : Key::Other;
+                break;
+            case Frame::Test:
+                key_ = view == "fullName" ? Key::FullName
+                     : view == "duration" ? Key::Duration
+                     : view == "state"    ? Key::State
+                                          : Key::Other;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    auto end_object() -> bool override {
+        if (current() == Frame::Test && !test_.full_name.empty()) {
+            records_.push_back(std::move(test_));
+        }
+        frames_.pop_back();
+        return true;
+    }
+
+    auto start_array(std::size_t /*elements*/) -> bool override {
+        if (!started_) {
+            return false;
+        }
+        if (current() == Frame::Document && key_ == Key::TestModules) {
+            frames_.push_back(Frame::Modules);
+        } else if (current() == Frame::Module && key_ == Key::Tests) {
+            frames_.push_back(Frame::Tests);
+        } else {
+            frames_.push_back(Frame::Skip);
+        }
+        return true;
+    }
+
+    auto end_array() -> bool override {
+        frames_.pop_back();
+        return true;
+    }
+
+private:
+    enum class Frame { Document, Modules, Module, Tests, Test, Skip };
+    enum class Key { Other, TestModules, Tests, FullName, Duration, State };
+
+    std::vector<TestRecord>& records_;
+    std::vector<Frame> frames_;
+    Key key_ = Key::Other;
+    bool started_ = false;
+    TestRecord test_;
+
+    [[nodiscard]] auto current() const -> Frame {
+        return frames_.empty() ? Frame::Skip : frames_.back();
+    }
+
+    // Durations are saved in milliseconds
+    auto number(double value) -> bool {
+        if (current() == Frame::Test && key_ == Key::Duration && value >= 0) {
+            test_.duration = std::chrono::microseconds(std::llround(value * 1000));
+        }
+        return true;
+    }
+};
+
+} // anonymous namespace
+
+auto TestHistory::load(int results_fd) -> TestHistory {
+    const auto file = MappedFile::open(results_fd, "test.json");
+    return parse(file.content());
+}
+
+auto TestHistory::parse(std::string_view json) -> TestHistory {
+    TestHistory history;
+    HistoryReader reader(history.records_);
+    JsonStream stream(reader);
+    stream.feed(json);
+    history.build_index();
+    return history;
+}
+
+// Hashing rather than sorting keeps this linear; test.json lists tests in
+// the order they ran, which is seldom the order of their names
+auto TestHistory::build_index() -> void {
+    index_.reserve(records_.size());
+    for (const auto& record : records_) {
+        const std::string_view name = record.full_name;
+        auto& entry = index_[name];
+        if (entry.record == nullptr) {
+            entry.record = &record;
+        }
+        for (auto slash = name.rfind('/'); slash != std::string_view::npos && slash > 0;
+             slash = name.rfind('/', slash - 1)) {
+            auto& parent = index_[name.substr(0, slash)];
+            if (record.duration) {
+                parent.sections = parent.sections.value_or(std::chrono::microseconds(0)) + *record.duration;
+            }
+            parent.section_failed = parent.section_failed || record.state == TestEvent::State::Failed;
+        }
+    }
+}
+
+auto TestHistory::entry(std::string_view name) const -> const Entry* {
+    const auto it = index_.find(name);
+    return it != index_.end() ? &it->second : nullptr;
+}
+
+auto TestHistory::records() const -> const std::vector<TestRecord>& {
+    return records_;
+}
+
+auto TestHistory::find(std::string_view full_name) const -> const TestRecord* {
+    const auto* found = entry(full_name);
+    return found != nullptr ? found->record : nullptr;
+}
+
+auto TestHistory::duration_of(std::string_view name) const -> std::optional<std::chrono::microseconds> {
+    const auto* found = entry(name);
+    if (found == nullptr) {
+        return std::nullopt;
+    }
+    auto total = found->record != nullptr ? found->record->duration : std::nullopt;
+    if (found->sections) {
+        total = total.value_or(std::chrono::microseconds(0)) + *found->sections;
+    }
+    return total;
+}
+
+auto TestHistory::failed(std::string_view name) const -> bool {
+    const auto* found = entry(name);
+    return found != nullptr &&
+           (found->section_failed || (found->record != nullptr && found->record->state == TestEvent::State::Failed));
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "parser.hpp"
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tdd_guard {
+
+// What a previous run saved about one test
+struct TestRecord {
+    std::string full_name;
+    TestEvent::State state = TestEvent::State::Unknown;
+    std::optional<std::chrono::microseconds> duration = std::nullopt;
+};
+
+// The tests of the previous run, read from its test.json with JsonStream
+// rather than a DOM, and indexed by name
+class TestHistory {
+public:
+    TestHistory() = default;
+    // The index refers to the names in records_
+    TestHistory(const TestHistory&) = delete;
+    auto operator=(const TestHistory&) -> TestHistory& = delete;
+    TestHistory(TestHistory&&) noexcept = default;
+    auto operator=(TestHistory&&) noexcept -> TestHistory& = default;
+
+    // Maps test.json rather than reading it into a string. Empty when the
+    // results directory holds no readable test.json.
+    [[nodiscard]] static auto load(int results_fd) -> TestHistory;
+    // Whatever was read before the JSON ended or stopped matching the
+    // layout test.json is written in
+    [[nodiscard]] static auto parse(std::string_view json) -> TestHistory;
+
+    // In the order they were saved
+    [[nodiscard]] auto records() const -> const std::vector<TestRecord>&;
+    // The first record saved under full_name
+    [[nodiscard]] auto find(std::string_view full_name) const -> const TestRecord*;
+    // Time the test took in the previous run, including its Catch2 sections,
+    // which are saved as "name/section"
+    [[nodiscard]] auto duration_of(std::string_view name) const -> std::optional<std::chrono::microseconds>;
+    // Whether the test, or one of its Catch2 sections, failed in the
+    // previous run
+    [[nodiscard]] auto failed(std::string_view name) const -> bool;
+
+private:
+    // A name saved as a test, as the prefix of Catch2 sections saved as
+    // "name/section", or as both
+    struct Entry {
+        const TestRecord* record = nullptr;
+        std::optional<std::chrono::microseconds> sections;
+        bool section_failed = false;
+    };
+
+    std::vector<TestRecord> records_;
+    std::unordered_map<std::string_view, Entry> index_;
+
+    auto build_index() -> void;
+    [[nodiscard]] auto entry(std::string_view name) const -> const Entry*;
+};
+
+} // namespace tdd_guard
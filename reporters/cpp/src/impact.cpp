@@ -0,0 +1,843 @@
+#include "impact.hpp"
+#include "file_io.hpp"
+#include "json_stream.hpp"
+#include "mapped_file.hpp"
+#include "reporter.hpp"
+#include "runner.hpp"
+#include "saved_output.hpp"
+#include "shards.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace tdd_guard {
+
+namespace {
+
+// Written by the results directory's owner alone, so the file does not
+// need to be portable between machines: version 1 stores integers in the
+// host's byte order. Version 2 adds the links between targets.
+constexpr std::string_view INDEX_MAGIC = "TGIX";
+constexpr std::uint32_t INDEX_VERSION = 2;
+constexpr const char* INDEX_NAME = "index";
+constexpr const char* IMPACT_DIR = "impact";
+
+struct CompileCommand {
+    std::string directory;
+    std::string file;
+    std::string output;
+    std::string command;
+    std::vector<std::string> arguments;
+};
+
+// Collects the entries of compile_commands.json
+class CompileCommandsReader final : public JsonHandler {
+public:
+    explicit CompileCommandsReader(std::vector<CompileCommand>& commands) : commands_(commands) {}
+
+    auto null() -> bool override {
+        return true;
+    }
+    auto boolean(bool /*value*/) -> bool override {
+        return true;
+    }
+    auto number_integer(std::int64_t /*value*/) -> bool override {
+        return true;
+    }
+    auto number_unsigned(std::uint64_t /*value*/) -> bool override {
+        return true;
+    }
+    auto number_float(double /*value*/, const std::string& /*text*/) -> bool override {
+        return true;
+    }
+
+    auto string(std::string& value) -> bool override {
+        if (current() == Frame::Arguments) {
+            commands_.back().arguments.push_back(std::move(value));
+        } else if (current() == Frame::Entry) {
+            auto& command = commands_.back();
+            switch (key_) {
+                case Key::Directory: command.directory = std::move(value); break;
+                case Key::File: command.file = std::move(value); break;
+                case Key::Output: command.output = std::move(value); break;
+                case Key::Command: command.command = std::move(value); break;
+                default: break;
+            }
+        }
+        return true;
+    }
+
+    auto start_object(std::size_t /*elements*/) -> bool override {
+        if (current() == Frame::Entries) {
+            commands_.emplace_back();
+            frames_.push_back(Frame::Entry);
+        } else {
+            frames_.push_back(Frame::Skip);
+        }
+        return true;
+    }
+
+    auto key(std::string& name) -> bool override {
+        const std::string_view view = name;
+        key_ = view == "directory" ? Key::Directory
+             : view == "file"      ? Key::File
+             : view == "output"    ? Key::Output
+             : view == "command"   ? Key::Command
+             : view == "arguments" ? Key::Arguments
+                                   : Key::Other;
+        return true;
+    }
+
+    auto end_object() -> bool override {
+        frames_.pop_back();
+        return true;
+    }
+
+    auto start_array(std::size_t /*elements*/) -> bool override {
+        if (frames_.empty()) {
+            frames_.push_back(Frame::Entries);
+        } else if (current() == Frame::Entry && key_ == Key::Arguments) {
+            frames_.push_back(Frame::Arguments);
+        } else {
+            frames_.push_back(Frame::Skip);
+        }
+        return true;
+    }
+
+    auto end_array() -> bool override {
+        frames_.pop_back();
+        return true;
+    }
+
+private:
+    enum class Frame { Entries, Entry, Arguments, Skip };
+    enum class Key { Other, Directory, File, Output, Command, Arguments };
+
+    std::vector<CompileCommand>& commands_;
+    std::vector<Frame> frames_;
+    Key key_ = Key::Other;
+
+    [[nodiscard]] auto current() const -> Frame {
+        return frames_.empty() ? Frame::Skip : frames_.back();
+    }
+};
+
+// Splits a command line the way a POSIX shell would for the plain words,
+// quotes and backslashes compilers' command lines use
+auto split_command(std::string_view command) -> std::vector<std::string> {
+    std::vector<std::string> words;
+    std::string word;
+    bool in_word = false;
+    char quote = 0;
+    for (std::size_t i = 0; i < command.size(); ++i) {
+        const char c = command[i];
+        if (quote != 0) {
+            if (c == quote) {
+                quote = 0;
+            } else if (c == '\\' && quote == '"' && i + 1 < command.size()) {
+                word += command[++i];
+            } else {
+                word += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_word = true;
+        } else if (c == '\\' && i + 1 < command.size()) {
+            word += command[++i];
+            in_word = true;
+        } else if (c == ' ' || c == '\t' || c == '\n') {
+            if (in_word) {
+                words.push_back(std::move(word));
+                word.clear();
+                in_word = false;
+            }
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (in_word) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+// The value of an option given as "-MF file" or "-MFfile"
+auto option_value(const std::vector<std::string>& arguments, std::string_view option) -> std::optional<std::string> {
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        const std::string_view argument = arguments[i];
+        if (argument == option && i + 1 < arguments.size()) {
+            return arguments[i + 1];
+        }
+        if (argument.size() > option.size() && argument.starts_with(option)) {
+            return std::string(argument.substr(option.size()));
+        }
+    }
+    return std::nullopt;
+}
+
+auto absolute_in(const std::string& directory, const std::string& path) -> std::string {
+    return (fs::path(directory) / path).lexically_normal().string();
+}
+
+auto mtime_of(const struct stat& st) -> std::int64_t {
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+}
+
+auto now() -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+template<typename T>
+auto put(std::string& out, T value) -> void {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+auto put_string(std::string& out, std::string_view text) -> void {
+    put(out, static_cast<std::uint32_t>(text.size()));
+    out += text;
+}
+
+// Reads what put wrote, failing once anything runs past the end
+class IndexReader {
+public:
+    explicit IndexReader(std::string_view data) : data_(data) {}
+
+    template<typename T>
+    auto get(T& value) -> bool {
+        if (data_.size() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    auto get_string(std::string& text) -> bool {
+        std::uint32_t size = 0;
+        if (!get(size) || data_.size() < size) {
+            return false;
+        }
+        text.assign(data_.substr(0, size));
+        data_.remove_prefix(size);
+        return true;
+    }
+
+    auto take(std::string_view bytes) -> bool {
+        if (!data_.starts_with(bytes)) {
+            return false;
+        }
+        data_.remove_prefix(bytes.size());
+        return true;
+    }
+
+    [[nodiscard]] auto remaining() const -> std::size_t {
+        return data_.size();
+    }
+
+private:
+    std::string_view data_;
+};
+
+auto modified_after(const char* path, std::int64_t time) -> bool {
+    struct stat st {};
+    return ::stat(path, &st) != 0 || mtime_of(st) > time;
+}
+
+// The paths of a build statement, with Ninja's $ escapes undone
+struct NinjaBuild {
+    std::vector<std::string> outputs;
+    std::vector<std::string> inputs;
+};
+
+// Reads the build statement starting after "build " at pos, up to the end
+// of its line. Implicit inputs count; order-only ones and validations do
+// not.
+auto read_ninja_build(std::string_view manifest, std::size_t& pos) -> NinjaBuild {
+    enum class Part { Outputs, Rule, Inputs, Rest };
+    NinjaBuild build;
+    auto part = Part::Outputs;
+    std::string word;
+    bool in_word = false;
+    const auto end_word = [&] {
+        if (!in_word) {
+            return;
+        }
+        if (part == Part::Outputs) {
+            if (word != "|") {
+                build.outputs.push_back(std::move(word));
+            }
+        } else if (part == Part::Rule) {
+            part = Part::Inputs;
+        } else if (part == Part::Inputs) {
+            if (word == "||" || word == "|@") {
+                part = Part::Rest;
+            } else if (word != "|") {
+                build.inputs.push_back(std::move(word));
+            }
+        }
+        word.clear();
+        in_word = false;
+    };
+
+    for (; pos < manifest.size() && manifest[pos] != '\n'; ++pos) {
+        const char c = manifest[pos];
+        if (c == '$' && pos + 1 < manifest.size()) {
+            const char next = manifest[++pos];
+            if (next == '\n' || next == '\r') {
+                // A continued line; the indentation of the next is not part of it
+                if (next == '\r' && pos + 1 < manifest.size() && manifest[pos + 1] == '\n') {
+                    ++pos;
+                }
+                while (pos + 1 < manifest.size() && manifest[pos + 1] == ' ') {
+                    ++pos;
+                }
+                end_word();
+            } else {
+                word += next;
+                in_word = true;
+            }
+        } else if (c == ' ' || c == '\r') {
+            end_word();
+        } else if (c == ':' && part == Part::Outputs) {
+            end_word();
+            part = Part::Rule;
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    end_word();
+    return build;
+}
+
+// The artefact a line of a link.txt script writes: the file after -o, or
+// the archive an ar command creates
+auto link_output(const std::vector<std::string>& words) -> std::optional<std::string> {
+    if (auto output = option_value(words, "-o")) {
+        return output;
+    }
+    if (words.size() > 2 && fs::path(words[0]).filename().string().ends_with("ar")) {
+        return words[2];
+    }
+    return std::nullopt;
+}
+
+// The links between the targets of a CMake Makefile build, read from the
+// link.txt script in each target's CMakeFiles/<target>.dir. Empty when no
+// target has one.
+auto read_link_scripts(const std::vector<std::pair<std::string, std::string>>& target_dirs)
+    -> std::optional<std::vector<TargetLink>> {
+    // The target whose script writes each file, and what each script reads
+    std::unordered_map<std::string, std::string> owners;
+    std::vector<std::pair<std::string, std::vector<std::string>>> inputs;
+    for (const auto& [target, dir] : target_dirs) {
+        const auto script_path = dir + "/link.txt";
+        const auto script = MappedFile::open(AT_FDCWD, script_path.c_str());
+        if (script.content().empty()) {
+            continue;
+        }
+        // Commands run in the directory holding CMakeFiles
+        const auto base = fs::path(dir).parent_path().parent_path().string();
+        auto& read = inputs.emplace_back(target, std::vector<std::string>{}).second;
+        std::string_view lines = script.content();
+        while (!lines.empty()) {
+            const auto end = lines.find('\n');
+            const auto words = split_command(lines.substr(0, end));
+            lines.remove_prefix(end == std::string_view::npos ? lines.size() : end + 1);
+            const auto output = link_output(words);
+            if (output) {
+                owners.emplace(absolute_in(base, *output), target);
+            }
+            for (std::size_t i = 1; i < words.size(); ++i) {
+                if (!words[i].starts_with('-') && (!output || words[i] != *output)) {
+                    read.push_back(absolute_in(base, words[i]));
+                }
+            }
+        }
+    }
+    if (inputs.empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<TargetLink> links;
+    for (const auto& [target, files] : inputs) {
+        for (const auto& file : files) {
+            if (const auto it = owners.find(file); it != owners.end() && it->second != target) {
+                links.push_back({.target = target, .library = it->second});
+            }
+        }
+    }
+    std::sort(links.begin(), links.end());
+    links.erase(std::unique(links.begin(), links.end()), links.end());
+    return links;
+}
+
+} // anonymous namespace
+
+auto parse_depfile(std::string_view depfile) -> std::vector<std::string> {
+    std::vector<std::string> files;
+    std::string word;
+    bool prerequisites = false;
+    const auto end_word = [&] {
+        if (prerequisites && !word.empty()) {
+            files.push_back(std::move(word));
+        }
+        word.clear();
+    };
+
+    for (std::size_t i = 0; i < depfile.size(); ++i) {
+        const char c = depfile[i];
+        const char next = i + 1 < depfile.size() ? depfile[i + 1] : '\0';
+        if (c == '\\' && (next == '\n' || (next == '\r' && i + 2 < depfile.size() && depfile[i + 2] == '\n'))) {
+            // A continued line
+            end_word();
+            i += next == '\r' ? 2 : 1;
+        } else if (c == '\\' && (next == ' ' || next == '#' || next == '\\')) {
+            word += next;
+            ++i;
+        } else if (c == '$' && next == '$') {
+            word += '$';
+            ++i;
+        } else if (c == ':' && !prerequisites && (next == ' ' || next == '\t' || next == '\n' || next == '\r' ||
+                                                  next == '\0')) {
+            word.clear();
+            prerequisites = true;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            end_word();
+        } else if (c == '\n') {
+            // The next rule starts with its targets
+            end_word();
+            prerequisites = false;
+        } else {
+            word += c;
+        }
+    }
+    end_word();
+    return files;
+}
+
+auto object_target(std::string_view object) -> std::string {
+    constexpr std::string_view CMAKE_DIR = "CMakeFiles/";
+    if (const auto start = object.rfind(CMAKE_DIR); start != std::string_view::npos) {
+        const auto name = object.substr(start + CMAKE_DIR.size());
+        if (const auto end = name.find(".dir/"); end != std::string_view::npos) {
+            return std::string(name.substr(0, end));
+        }
+    }
+
+    // Meson's private directory is the first component ending in ".p"
+    std::size_t start = 0;
+    while (start < object.size()) {
+        auto end = object.find('/', start);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        const auto component = object.substr(start, end - start);
+        if (component.size() > 2 && component.ends_with(".p")) {
+            return std::string(component.substr(0, component.size() - 2));
+        }
+        start = end + 1;
+    }
+    return {};
+}
+
+auto parse_ninja_links(std::string_view manifest) -> std::vector<TargetLink> {
+    constexpr std::string_view BUILD = "build ";
+    std::unordered_map<std::string, std::string> owners;
+    std::vector<std::pair<std::string, std::vector<std::string>>> statements;
+    for (std::size_t pos = 0; pos < manifest.size(); ++pos) {
+        if (manifest.substr(pos).starts_with(BUILD)) {
+            pos += BUILD.size();
+            auto build = read_ninja_build(manifest, pos);
+            std::string target;
+            for (const auto& input : build.inputs) {
+                if (target = object_target(input); !target.empty()) {
+                    break;
+                }
+            }
+            if (!target.empty()) {
+                for (auto& output : build.outputs) {
+                    owners.emplace(std::move(output), target);
+                }
+                statements.emplace_back(std::move(target), std::move(build.inputs));
+            }
+        } else {
+            pos = std::min(manifest.find('\n', pos), manifest.size());
+        }
+    }
+
+    std::vector<TargetLink> links;
+    for (const auto& [target, inputs] : statements) {
+        for (const auto& input : inputs) {
+            if (const auto it = owners.find(input); it != owners.end() && it->second != target) {
+                links.push_back({.target = target, .library = it->second});
+            }
+        }
+    }
+    std::sort(links.begin(), links.end());
+    links.erase(std::unique(links.begin(), links.end()), links.end());
+    return links;
+}
+
+auto ImpactIndex::load(int dir_fd) -> ImpactIndex {
+    const auto file = MappedFile::open(dir_fd, INDEX_NAME);
+    IndexReader reader(file.content());
+    ImpactIndex index;
+    std::uint32_t version = 0;
+    std::uint32_t file_count = 0;
+    if (!reader.take(INDEX_MAGIC) || !reader.get(version) || version != INDEX_VERSION ||
+        !reader.get(index.last_run_) || !reader.get(file_count)) {
+        return {};
+    }
+
+    index.files_.resize(file_count);
+    for (auto& path : index.files_) {
+        if (!reader.get_string(path)) {
+            return {};
+        }
+    }
+    index.file_ids_.reserve(file_count);
+    for (std::uint32_t id = 0; id < file_count; ++id) {
+        index.file_ids_.emplace(index.files_[id], id);
+    }
+
+    std::uint32_t unit_count = 0;
+    if (!reader.get(unit_count)) {
+        return {};
+    }
+    index.units_.resize(unit_count);
+    for (auto& unit : index.units_) {
+        std::uint32_t files = 0;
+        if (!reader.get_string(unit.depfile) || !reader.get_string(unit.target) || !reader.get(unit.mtime) ||
+            !reader.get(unit.size) || !reader.get(files) || reader.remaining() / sizeof(std::uint32_t) < files) {
+            return {};
+        }
+        unit.files.resize(files);
+        for (auto& id : unit.files) {
+            if (!reader.get(id) || id >= file_count) {
+                return {};
+            }
+        }
+    }
+
+    std::uint8_t links_known = 0;
+    std::uint32_t link_count = 0;
+    if (!reader.get(links_known) || !reader.get(index.ninja_mtime_) || !reader.get(index.ninja_size_) ||
+        !reader.get(link_count) || reader.remaining() / (2 * sizeof(std::uint32_t)) < link_count) {
+        return {};
+    }
+    index.links_known_ = links_known != 0;
+    index.links_.resize(link_count);
+    for (auto& link : index.links_) {
+        if (!reader.get_string(link.target) || !reader.get_string(link.library)) {
+            return {};
+        }
+    }
+    return index;
+}
+
+auto ImpactIndex::save(int dir_fd, std::ostream& err) const -> bool {
+    std::string out(INDEX_MAGIC);
+    put(out, INDEX_VERSION);
+    put(out, last_run_);
+    put(out, static_cast<std::uint32_t>(files_.size()));
+    for (const auto& path : files_) {
+        put_string(out, path);
+    }
+    put(out, static_cast<std::uint32_t>(units_.size()));
+    for (const auto& unit : units_) {
+        put_string(out, unit.depfile);
+        put_string(out, unit.target);
+        put(out, unit.mtime);
+        put(out, unit.size);
+        put(out, static_cast<std::uint32_t>(unit.files.size()));
+        for (const auto id : unit.files) {
+            put(out, id);
+        }
+    }
+    put(out, static_cast<std::uint8_t>(links_known_ ? 1 : 0));
+    put(out, ninja_mtime_);
+    put(out, ninja_size_);
+    put(out, static_cast<std::uint32_t>(links_.size()));
+    for (const auto& link : links_) {
+        put_string(out, link.target);
+        put_string(out, link.library);
+    }
+
+    if (!replace_file(dir_fd, INDEX_NAME, out)) {
+        err << "Error saving the impact index: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    return true;
+}
+
+auto ImpactIndex::intern(const std::string& path) -> std::uint32_t {
+    const auto [it, inserted] = file_ids_.try_emplace(path, static_cast<std::uint32_t>(files_.size()));
+    if (inserted) {
+        files_.push_back(path);
+    }
+    return it->second;
+}
+
+auto ImpactIndex::update(const fs::path& build_dir, std::ostream& err) -> bool {
+    const auto database = (build_dir / "compile_commands.json").string();
+    const auto file = MappedFile::open(AT_FDCWD, database.c_str());
+    std::vector<CompileCommand> commands;
+    CompileCommandsReader reader(commands);
+    JsonStream stream(reader);
+    stream.feed(file.content());
+    if (!stream.complete()) {
+        err << "Error reading " << database << "\n";
+        return false;
+    }
+
+    // Units already read, by depfile
+    std::unordered_map<std::string, Unit*> previous;
+    previous.reserve(units_.size());
+    for (auto& unit : units_) {
+        previous.emplace(unit.depfile, &unit);
+    }
+
+    // Ids are handed out afresh, so files no unit lists any more are dropped
+    auto old_files = std::move(files_);
+    files_.clear();
+    file_ids_.clear();
+    std::vector<Unit> units;
+    units.reserve(commands.size());
+    for (auto& command : commands) {
+        const auto arguments =
+            command.arguments.empty() ? split_command(command.command) : std::move(command.arguments);
+        auto object = !command.output.empty() ? command.output : option_value(arguments, "-o").value_or("");
+        auto target = object_target(object);
+        if (target.empty()) {
+            continue;
+        }
+
+        Unit unit;
+        unit.depfile = absolute_in(command.directory, option_value(arguments, "-MF").value_or(object + ".d"));
+        unit.target = std::move(target);
+        struct stat st {};
+        const bool built = ::stat(unit.depfile.c_str(), &st) == 0;
+        if (built) {
+            unit.mtime = mtime_of(st);
+            unit.size = static_cast<std::uint64_t>(st.st_size);
+        }
+
+        const auto it = previous.find(unit.depfile);
+        if (built && it != previous.end() && it->second->mtime == unit.mtime && it->second->size == unit.size &&
+            it->second->target == unit.target) {
+            for (const auto id : it->second->files) {
+                unit.files.push_back(intern(old_files[id]));
+            }
+        } else {
+            // Before the first build only the source itself is known
+            unit.files.push_back(intern(absolute_in(command.directory, command.file)));
+            if (built) {
+                const auto depfile = MappedFile::open(AT_FDCWD, unit.depfile.c_str());
+                for (const auto& path : parse_depfile(depfile.content())) {
+                    unit.files.push_back(intern(absolute_in(command.directory, path)));
+                }
+            } else {
+                // Read again once the object has been built
+                unit.mtime = -1;
+            }
+        }
+        units.push_back(std::move(unit));
+    }
+    units_ = std::move(units);
+    update_links(build_dir);
+    return true;
+}
+
+auto ImpactIndex::update_links(const fs::path& build_dir) -> void {
+    const auto manifest_path = (build_dir / "build.ninja").string();
+    struct stat st {};
+    if (::stat(manifest_path.c_str(), &st) == 0) {
+        const auto mtime = mtime_of(st);
+        const auto size = static_cast<std::uint64_t>(st.st_size);
+        if (mtime != ninja_mtime_ || size != ninja_size_) {
+            const auto manifest = MappedFile::open(AT_FDCWD, manifest_path.c_str());
+            links_ = parse_ninja_links(manifest.content());
+            links_known_ = true;
+            ninja_mtime_ = mtime;
+            ninja_size_ = size;
+        }
+        return;
+    }
+
+    // Each target's objects sit in the directory its link.txt is in
+    std::vector<std::pair<std::string, std::string>> target_dirs;
+    for (const auto& unit : units_) {
+        const auto marker = "CMakeFiles/" + unit.target + ".dir/";
+        if (const auto end = unit.depfile.rfind(marker); end != std::string::npos) {
+            target_dirs.emplace_back(unit.target, unit.depfile.substr(0, end + marker.size() - 1));
+        }
+    }
+    std::sort(target_dirs.begin(), target_dirs.end());
+    target_dirs.erase(std::unique(target_dirs.begin(), target_dirs.end()), target_dirs.end());
+    auto links = read_link_scripts(target_dirs);
+    links_known_ = links.has_value();
+    links_ = links ? std::move(*links) : std::vector<TargetLink>{};
+    ninja_mtime_ = -1;
+    ninja_size_ = 0;
+}
+
+auto ImpactIndex::knows(std::string_view target) const -> bool {
+    return std::any_of(units_.begin(), units_.end(), [&](const Unit& unit) { return unit.target == target; });
+}
+
+auto ImpactIndex::knows_links() const -> bool {
+    return links_known_;
+}
+
+auto ImpactIndex::targets_using(std::span<const std::string> files) const -> std::vector<std::string> {
+    std::vector<char> changed(files_.size(), 0);
+    for (const auto& path : files) {
+        if (const auto it = file_ids_.find(path); it != file_ids_.end()) {
+            changed[it->second] = 1;
+        }
+    }
+
+    std::vector<std::string> targets;
+    for (const auto& unit : units_) {
+        if (std::any_of(unit.files.begin(), unit.files.end(), [&](std::uint32_t id) { return changed[id] != 0; })) {
+            targets.push_back(unit.target);
+        }
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+    // Then whatever links those, until nothing new turns up
+    for (std::size_t reached = 0; reached != targets.size();) {
+        reached = targets.size();
+        for (const auto& link : links_) {
+            if (std::binary_search(targets.begin(), targets.begin() + static_cast<std::ptrdiff_t>(reached),
+                                   link.library)) {
+                targets.push_back(link.target);
+            }
+        }
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    }
+    return targets;
+}
+
+auto ImpactIndex::modified_since(std::int64_t time) const -> std::vector<std::string> {
+    std::vector<std::string> modified;
+    for (const auto& path : files_) {
+        if (modified_after(path.c_str(), time)) {
+            modified.push_back(path);
+        }
+    }
+    return modified;
+}
+
+auto ImpactIndex::last_run() const -> std::int64_t {
+    return last_run_;
+}
+
+auto ImpactIndex::set_last_run(std::int64_t time) -> void {
+    last_run_ = time;
+}
+
+auto run_impacted(int results_fd, std::span<char* const> binaries, const ImpactOptions& options, int out_fd,
+                  int err_fd, std::ostream& err) -> int {
+    if (binaries.empty()) {
+        err << "Error: no test binaries given after --\n";
+        return 127;
+    }
+    if (results_fd < 0) {
+        return 1;
+    }
+    const int dir_fd = open_results_subdir(results_fd, IMPACT_DIR, err);
+    if (dir_fd < 0) {
+        return 1;
+    }
+
+    const auto started = now();
+    auto index = ImpactIndex::load(dir_fd);
+    const bool indexed = index.update(options.build_dir, err);
+    std::vector<std::string> changed;
+    if (options.changed.empty()) {
+        changed = index.modified_since(index.last_run());
+    } else {
+        for (const auto& path : options.changed) {
+            changed.push_back(fs::absolute(path).lexically_normal().string());
+        }
+    }
+    const auto targets = index.targets_using(changed);
+    // Without the links between targets, a change to a library cannot be
+    // followed to the tests linking it
+    const auto is_binary = [&](const std::string& target) {
+        return std::any_of(binaries.begin(), binaries.end(),
+                           [&](const char* binary) { return fs::path(binary).filename() == target; });
+    };
+    const bool unlinked_change =
+        !index.knows_links() && !std::all_of(targets.begin(), targets.end(), is_binary);
+
+    std::vector<TddGuardOutput> parts;
+    {
+        IgnoreInterrupts ignore_interrupts;
+        for (char* binary : binaries) {
+            const auto target = fs::path(binary).filename().string();
+            const auto report = target + ".json";
+            const bool affected = !indexed || unlinked_change || !index.knows(target) ||
+                                  std::binary_search(targets.begin(), targets.end(), target) ||
+                                  (options.changed.empty() && modified_after(binary, index.last_run()));
+            if (!affected) {
+                const auto saved = MappedFile::open(dir_fd, report.c_str());
+                if (auto cached = parse_saved_output(saved.content())) {
+                    parts.push_back(std::move(*cached));
+                    continue;
+                }
+            }
+
+            auto output = run_binary(std::span(&binary, 1), out_fd, err_fd, err);
+            // A binary that did not run or was cut short by a signal reports
+            // nothing worth keeping, and its last report is stale now
+            if (!output || (output->process && output->process->signal)) {
+                ::unlinkat(dir_fd, report.c_str(), 0);
+            }
+            if (!output) {
+                parts.push_back(TddGuardOutput{
+                    .test_modules = {},
+                    .reason = "failed",
+                    .timing = std::nullopt,
+                    .process = ProcessExit{.exit_code = 127}
+                });
+                continue;
+            }
+            if (!output->process || !output->process->signal) {
+                (void)save_output(dir_fd, report, *output, err);
+            }
+            parts.push_back(std::move(*output));
+        }
+    }
+
+    if (indexed) {
+        index.set_last_run(started);
+        (void)index.save(dir_fd, err);
+    }
+    ::close(dir_fd);
+
+    const auto merged = merge_outputs(std::move(parts));
+    if (!save_results(results_fd, merged, err)) {
+        return 1;
+    }
+    return merged.process ? exit_status(*merged.process) : 0;
+}
+
+} // namespace tdd_guard
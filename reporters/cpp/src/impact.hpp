@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tdd_guard {
+
+struct ImpactOptions {
+    // Build directory holding compile_commands.json
+    std::filesystem::path build_dir;
+    // Files changed since the last run. When empty, the indexed files
+    // modified since the last run started are taken instead.
+    std::vector<std::filesystem::path> changed;
+};
+
+// Prerequisites of the rules in a depfile written by the compiler's -MD
+// family of flags, in Make syntax. Targets are left out.
+[[nodiscard]] auto parse_depfile(std::string_view depfile) -> std::vector<std::string>;
+
+// The build target an object file belongs to, taken from the directory
+// CMake (CMakeFiles/<target>.dir) or Meson (<target>.p) builds it in.
+// Empty for other layouts.
+[[nodiscard]] auto object_target(std::string_view object) -> std::string;
+
+// A build target linking a library another target of the build builds
+struct TargetLink {
+    std::string target;
+    std::string library;
+
+    auto operator<=>(const TargetLink&) const = default;
+};
+
+// The links between targets in a Ninja manifest, as CMake and Meson write
+// it. A build statement belongs to the target of the objects among its
+// inputs, and links every library among its explicit and implicit inputs
+// that a statement of another target outputs. Sorted.
+[[nodiscard]] auto parse_ninja_links(std::string_view manifest) -> std::vector<TargetLink>;
+
+// Which sources and headers each build target was compiled from, read from
+// compile_commands.json and the depfile of every object it lists, and which
+// targets link which, read from build.ninja or else from the link.txt
+// scripts of CMake's Makefile generator. Saved in a compact binary form,
+// with each file path stored once, and updated by reading only the
+// depfiles and build.ninja that changed since.
+class ImpactIndex {
+public:
+    // Empty when nothing was saved or what was saved cannot be read
+    [[nodiscard]] static auto load(int dir_fd) -> ImpactIndex;
+    [[nodiscard]] auto save(int dir_fd, std::ostream& err) const -> bool;
+
+    // Rereads compile_commands.json, the depfiles whose size or mtime
+    // changed and the links between targets. Returns false after reporting
+    // why compile_commands.json could not be read.
+    auto update(const std::filesystem::path& build_dir, std::ostream& err) -> bool;
+
+    // Whether any object of the target was indexed
+    [[nodiscard]] auto knows(std::string_view target) const -> bool;
+    // Whether the build told which targets link which
+    [[nodiscard]] auto knows_links() const -> bool;
+    // Targets built from any of the files, which are absolute and normal,
+    // and the targets linking those; sorted
+    [[nodiscard]] auto targets_using(std::span<const std::string> files) const -> std::vector<std::string>;
+    // Indexed files modified after time, or no longer there
+    [[nodiscard]] auto modified_since(std::int64_t time) const -> std::vector<std::string>;
+
+    // When the last run that used the index started, in nanoseconds since
+    // the epoch; 0 before the first
+    [[nodiscard]] auto last_run() const -> std::int64_t;
+    auto set_last_run(std::int64_t time) -> void;
+
+private:
+    // One object: its depfile as last read, and the files it lists
+    struct Unit {
+        std::string depfile;
+        std::string target;
+        std::int64_t mtime = 0;
+        std::uint64_t size = 0;
+        std::vector<std::uint32_t> files;
+    };
+
+    std::vector<std::string> files_;
+    std::unordered_map<std::string, std::uint32_t> file_ids_;
+    std::vector<Unit> units_;
+    std::vector<TargetLink> links_;
+    bool links_known_ = false;
+    // build.ninja as last read; -1 when the links came from elsewhere
+    std::int64_t ninja_mtime_ = -1;
+    std::uint64_t ninja_size_ = 0;
+    std::int64_t last_run_ = 0;
+
+    auto intern(const std::string& path) -> std::uint32_t;
+    auto update_links(const std::filesystem::path& build_dir) -> void;
+};
+
+// Runs only the test binaries the changed files reach, each as run_binary
+// runs it, and saves test.json with their reports together with the
+// reports the other binaries saved when they last ran. A binary the index
+// does not know, that has no saved report or, without explicit changes,
+// that was rebuilt since the last run, always runs. So does every binary
+// when a changed file belongs to another target and the build did not tell
+// what links it. Returns the worst status among the reports, as
+// run_command returns it.
+[[nodiscard]] auto run_impacted(int results_fd, std::span<char* const> binaries, const ImpactOptions& options,
+                                int out_fd, int err_fd, std::ostream& err) -> int;
+
+} // namespace tdd_guard
@@ -0,0 +1,68 @@
+#include "input_buffer.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace tdd_guard {
+
+auto InputBuffer::append(std::string_view bytes) -> void {
+    if (bytes.empty()) {
+        return;
+    }
+
+    auto space = prepare(bytes.size());
+    std::memcpy(space.data(), bytes.data(), bytes.size());
+    commit(bytes.size());
+}
+
+auto InputBuffer::prepare(std::size_t size) -> std::span<char> {
+    // Grow by half instead of doubling, so at most a third of the capacity
+    // is unused. A reallocation still holds the old and new buffers at once,
+    // about 2.5 times what is buffered.
+    if (size_ + size > capacity_) {
+        const auto capacity = std::max(size_ + size, capacity_ + capacity_ / 2);
+        auto data = std::make_unique_for_overwrite<char[]>(capacity);
+        if (size_ > 0) {
+            std::memcpy(data.get(), data_.get(), size_);
+        }
+        data_ = std::move(data);
+        capacity_ = capacity;
+    }
+
+    return {data_.get() + size_, capacity_ - size_};
+}
+
+auto InputBuffer::commit(std::size_t size) -> void {
+    TDD_GUARD_TIME_PHASE(ScanLines);
+    scan_lines({data_.get() + size_, size}, size_, open_line_, line_ends_, line_infos_);
+    size_ += size;
+}
+
+auto InputBuffer::content() const -> std::string_view {
+    return {data_.get(), size_};
+}
+
+auto InputBuffer::empty() const -> bool {
+    return size_ == 0;
+}
+
+auto InputBuffer::line_count() const -> std::size_t {
+    const auto terminated_end = line_ends_.empty() ? 0 : line_ends_.back() + 1;
+    return line_ends_.size() + (terminated_end < size_ ? 1 : 0);
+}
+
+auto InputBuffer::complete_line_count() const -> std::size_t {
+    return line_ends_.size();
+}
+
+auto InputBuffer::line_info(std::size_t index) const -> LineInfo {
+    return index < line_infos_.size() ? line_infos_[index] : open_line_;
+}
+
+auto InputBuffer::line(std::size_t index) const -> std::string_view {
+    const auto begin = index == 0 ? 0 : line_ends_[index - 1] + 1;
+    const auto end = index < line_ends_.size() ? line_ends_[index] : size_;
+    return content().substr(begin, end - begin);
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "line_scan.hpp"
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace tdd_guard {
+
+// Holds the reporter input exactly once. Lines are indexed by their end
+// offsets so the index stays valid while the storage grows; views are only
+// materialized on request. The same scan that finds line ends records what
+// each line starts with and whether it carries escape sequences.
+class InputBuffer {
+public:
+    auto append(std::string_view bytes) -> void;
+
+    // Exposes at least `size` writable bytes past the current content so
+    // readers can fill the buffer directly, then commit what they wrote
+    [[nodiscard]] auto prepare(std::size_t size) -> std::span<char>;
+    auto commit(std::size_t size) -> void;
+
+    [[nodiscard]] auto content() const -> std::string_view;
+    [[nodiscard]] auto empty() const -> bool;
+    [[nodiscard]] auto line_count() const -> std::size_t;
+    // Lines ended by '\n', which no later input can extend
+    [[nodiscard]] auto complete_line_count() const -> std::size_t;
+    [[nodiscard]] auto line(std::size_t index) const -> std::string_view;
+    [[nodiscard]] auto line_info(std::size_t index) const -> LineInfo;
+
+private:
+    std::unique_ptr<char[]> data_;
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;
+    // Offset of each '\n'; an unterminated final line ends at size_
+    std::vector<std::size_t> line_ends_;
+    std::vector<LineInfo> line_infos_;
+    LineInfo open_line_;
+};
+
+} // namespace tdd_guard
@@ -0,0 +1,487 @@
+#include "json_stream.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <system_error>
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr auto UNKNOWN_SIZE = std::numeric_limits<std::size_t>::max();
+
+auto is_whitespace(char c) -> bool {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+auto is_digit(char c) -> bool {
+    return c >= '0' && c <= '9';
+}
+
+// ASCII a string can hold as is: no quote, backslash or control character
+auto is_plain_string_char(unsigned char c) -> bool {
+    return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+auto is_number_char(char c) -> bool {
+    return is_digit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+auto hex_value(unsigned char c) -> int {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+auto append_utf8(std::string& out, std::uint32_t code_point) -> void {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+// Checks the JSON number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+auto is_valid_number(std::string_view text, bool& integral) -> bool {
+    std::size_t i = 0;
+    const auto digits = [&] {
+        const auto start = i;
+        while (i < text.size() && is_digit(text[i])) ++i;
+        return i - start;
+    };
+
+    if (i < text.size() && text[i] == '-') ++i;
+    if (i < text.size() && text[i] == '0') {
+        ++i;
+    } else if (digits() == 0) {
+        return false;
+    }
+
+    integral = true;
+    if (i < text.size() && text[i] == '.') {
+        ++i;
+        integral = false;
+        if (digits() == 0) return false;
+    }
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        integral = false;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) ++i;
+        if (digits() == 0) return false;
+    }
+    return i == text.size();
+}
+
+} // anonymous namespace
+
+JsonStream::JsonStream(JsonHandler& handler) : handler_(handler) {}
+
+auto JsonStream::complete() const -> bool {
+    return status_ == Status::Complete;
+}
+
+auto JsonStream::failed() const -> bool {
+    return status_ == Status::Failed;
+}
+
+auto JsonStream::checkpoint() -> void {
+    saved_status_ = status_;
+    saved_expect_ = expect_;
+    saved_containers_.assign(containers_.begin(), containers_.end());
+}
+
+auto JsonStream::rollback() -> void {
+    status_ = saved_status_;
+    expect_ = saved_expect_;
+    containers_.assign(saved_containers_.begin(), saved_containers_.end());
+    token_ = Token::None;
+    escape_ = Escape::None;
+    unicode_digits_ = 0;
+    high_surrogate_ = 0;
+    utf8_remaining_ = 0;
+    utf8_lower_ = 0x80;
+    utf8_upper_ = 0xBF;
+}
+
+auto JsonStream::fail() -> void {
+    status_ = Status::Failed;
+}
+
+auto JsonStream::feed(std::string_view bytes) -> std::size_t {
+    std::size_t pos = 0;
+    while (pos < bytes.size() && status_ == Status::Running) {
+        switch (token_) {
+            case Token::String:
+                pos = scan_string(bytes, pos);
+                continue;
+            case Token::Number:
+            case Token::Literal:
+                pos = scan_word(bytes, pos);
+                continue;
+            case Token::None:
+                break;
+        }
+
+        const char c = bytes[pos];
+        if (is_whitespace(c)) {
+            ++pos;
+            continue;
+        }
+        ++pos;
+
+        switch (expect_) {
+            case Expect::ValueOrEnd:
+                if (c == ']') {
+                    end_container();
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::Value:
+                begin_value(c);
+                break;
+            case Expect::KeyOrEnd:
+                if (c == '}') {
+                    end_container();
+                    break;
+                }
+                [[fallthrough]];
+            case Expect::Key:
+                if (c != '"') {
+                    fail();
+                    break;
+                }
+                token_ = Token::String;
+                string_is_key_ = true;
+                buffer_.clear();
+                break;
+            case Expect::Colon:
+                if (c == ':') {
+                    expect_ = Expect::Value;
+                } else {
+                    fail();
+                }
+                break;
+            case Expect::CommaOrEnd:
+                if (c == ',') {
+                    expect_ = containers_.back() == '{' ? Expect::Key : Expect::Value;
+                } else if (c == (containers_.back() == '{' ? '}' : ']')) {
+                    end_container();
+                } else {
+                    fail();
+                }
+                break;
+        }
+    }
+    return pos;
+}
+
+auto JsonStream::begin_value(char c) -> void {
+    switch (c) {
+        case '{':
+            containers_.push_back('{');
+            expect_ = Expect::KeyOrEnd;
+            if (!handler_.start_object(UNKNOWN_SIZE)) fail();
+            return;
+        case '[':
+            containers_.push_back('[');
+            expect_ = Expect::ValueOrEnd;
+            if (!handler_.start_array(UNKNOWN_SIZE)) fail();
+            return;
+        case '"':
+            token_ = Token::String;
+            string_is_key_ = false;
+            buffer_.clear();
+            return;
+        case 't':
+        case 'f':
+        case 'n':
+            token_ = Token::Literal;
+            buffer_.assign(1, c);
+            return;
+        default:
+            if (c == '-' || is_digit(c)) {
+                token_ = Token::Number;
+                buffer_.assign(1, c);
+                return;
+            }
+            fail();
+    }
+}
+
+auto JsonStream::end_value() -> void {
+    if (containers_.empty()) {
+        status_ = Status::Complete;
+    } else {
+        expect_ = Expect::CommaOrEnd;
+    }
+}
+
+auto JsonStream::end_container() -> void {
+    const bool object = containers_.back() == '{';
+    containers_.pop_back();
+    if (!(object ? handler_.end_object() : handler_.end_array())) {
+        fail();
+        return;
+    }
+    end_value();
+}
+
+// Copies runs of plain characters in one go; escapes, multi-byte UTF-8
+// sequences and the closing quote are handled one byte at a time.
+auto JsonStream::scan_string(std::string_view bytes, std::size_t pos) -> std::size_t {
+    auto run_start = pos;
+    const auto flush = [&] {
+        buffer_.append(bytes.data() + run_start, pos - run_start);
+    };
+
+    while (pos < bytes.size()) {
+        if (utf8_remaining_ == 0 && escape_ == Escape::None && high_surrogate_ == 0) {
+            while (pos < bytes.size() && is_plain_string_char(static_cast<unsigned char>(bytes[pos]))) {
+                ++pos;
+            }
+            if (pos == bytes.size()) {
+                break;
+            }
+        }
+        const auto c = static_cast<unsigned char>(bytes[pos]);
+
+        if (utf8_remaining_ > 0) {
+            if (c < utf8_lower_ || c > utf8_upper_) {
+                fail();
+                return pos;
+            }
+            utf8_lower_ = 0x80;
+            utf8_upper_ = 0xBF;
+            --utf8_remaining_;
+            ++pos;
+            continue;
+        }
+
+        if (escape_ != Escape::None) {
+            scan_escape(c);
+            ++pos;
+            run_start = pos;
+            if (status_ == Status::Failed) return pos;
+            continue;
+        }
+
+        if (c == '"' || c == '\\' || c < 0x20 || high_surrogate_ != 0) {
+            flush();
+            ++pos;
+            run_start = pos;
+            if (c == '\\') {
+                escape_ = Escape::Backslash;
+                continue;
+            }
+            if (c == '"' && high_surrogate_ == 0) {
+                end_string();
+            } else {
+                fail();
+            }
+            return pos;
+        }
+
+        if (c >= 0x80 && !scan_utf8_lead(c)) {
+            fail();
+            return pos;
+        }
+        ++pos;
+    }
+
+    flush();
+    return pos;
+}
+
+auto JsonStream::scan_escape(unsigned char c) -> void {
+    if (escape_ == Escape::Unicode) {
+        const int digit = hex_value(c);
+        if (digit < 0) {
+            fail();
+            return;
+        }
+        code_unit_ = (code_unit_ << 4) | static_cast<std::uint32_t>(digit);
+        if (++unicode_digits_ < 4) {
+            return;
+        }
+
+        escape_ = Escape::None;
+        if (code_unit_ >= 0xD800 && code_unit_ <= 0xDBFF) {
+            if (high_surrogate_ != 0) {
+                fail();
+            } else {
+                high_surrogate_ = code_unit_;
+            }
+        } else if (code_unit_ >= 0xDC00 && code_unit_ <= 0xDFFF) {
+            if (high_surrogate_ == 0) {
+                fail();
+                return;
+            }
+            append_utf8(buffer_, 0x10000 + ((high_surrogate_ - 0xD800) << 10) + (code_unit_ - 0xDC00));
+            high_surrogate_ = 0;
+        } else if (high_surrogate_ != 0) {
+            fail();
+        } else {
+            append_utf8(buffer_, code_unit_);
+        }
+        return;
+    }
+
+    escape_ = Escape::None;
+    if (high_surrogate_ != 0 && c != 'u') {
+        fail();
+        return;
+    }
+    switch (c) {
+        case '"': buffer_ += '"'; break;
+        case '\\': buffer_ += '\\'; break;
+        case '/': buffer_ += '/'; break;
+        case 'b': buffer_ += '\b'; break;
+        case 'f': buffer_ += '\f'; break;
+        case 'n': buffer_ += '\n'; break;
+        case 'r': buffer_ += '\r'; break;
+        case 't': buffer_ += '\t'; break;
+        case 'u':
+            escape_ = Escape::Unicode;
+            unicode_digits_ = 0;
+            code_unit_ = 0;
+            break;
+        default:
+            fail();
+    }
+}
+
+// Records how many continuation bytes follow a UTF-8 lead byte and the
+// range the first of them must fall in to rule out overlong encodings and
+// surrogates, as the JSON grammar requires.
+auto JsonStream::scan_utf8_lead(unsigned char c) -> bool {
+    if (c >= 0xC2 && c <= 0xDF) {
+        utf8_remaining_ = 1;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        utf8_remaining_ = 2;
+        if (c == 0xE0) utf8_lower_ = 0xA0;
+        if (c == 0xED) utf8_upper_ = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        utf8_remaining_ = 3;
+        if (c == 0xF0) utf8_lower_ = 0x90;
+        if (c == 0xF4) utf8_upper_ = 0x8F;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+auto JsonStream::end_string() -> void {
+    token_ = Token::None;
+    if (string_is_key_) {
+        expect_ = Expect::Colon;
+        if (!handler_.key(buffer_)) fail();
+        return;
+    }
+    if (!handler_.string(buffer_)) {
+        fail();
+        return;
+    }
+    end_value();
+}
+
+// Numbers and literals end at the first byte that cannot continue them,
+// which is left for the caller to read as the next token.
+auto JsonStream::scan_word(std::string_view bytes, std::size_t pos) -> std::size_t {
+    const bool number = token_ == Token::Number;
+    const auto start = pos;
+    while (pos < bytes.size() &&
+           (number ? is_number_char(bytes[pos]) : (bytes[pos] >= 'a' && bytes[pos] <= 'z'))) {
+        ++pos;
+    }
+    buffer_.append(bytes.data() + start, pos - start);
+    if (pos == bytes.size()) {
+        return pos;
+    }
+
+    token_ = Token::None;
+    if (number) {
+        end_number();
+    } else {
+        end_literal();
+    }
+    return pos;
+}
+
+auto JsonStream::end_number() -> void {
+    bool integral = false;
+    if (!is_valid_number(buffer_, integral)) {
+        fail();
+        return;
+    }
+
+    const auto* first = buffer_.data();
+    const auto* last = first + buffer_.size();
+    bool accepted = false;
+    bool converted = false;
+    if (integral && buffer_.front() == '-') {
+        std::int64_t value = 0;
+        if (std::from_chars(first, last, value).ec == std::errc{}) {
+            converted = true;
+            accepted = handler_.number_integer(value);
+        }
+    } else if (integral) {
+        std::uint64_t value = 0;
+        if (std::from_chars(first, last, value).ec == std::errc{}) {
+            converted = true;
+            accepted = handler_.number_unsigned(value);
+        }
+    }
+    // Integers out of 64-bit range are read as floating point
+    if (!converted) {
+        double value = 0;
+        // Tiny values round to zero as with strtod; overflow is an error
+        if (std::from_chars(first, last, value).ec != std::errc{}) {
+            value = std::strtod(buffer_.c_str(), nullptr);
+            if (!std::isfinite(value)) {
+                fail();
+                return;
+            }
+        }
+        accepted = handler_.number_float(value, buffer_);
+    }
+
+    if (!accepted) {
+        fail();
+        return;
+    }
+    end_value();
+}
+
+auto JsonStream::end_literal() -> void {
+    bool accepted = false;
+    if (buffer_ == "true") {
+        accepted = handler_.boolean(true);
+    } else if (buffer_ == "false") {
+        accepted = handler_.boolean(false);
+    } else if (buffer_ == "null") {
+        accepted = handler_.null();
+    } else {
+        fail();
+        return;
+    }
+
+    if (!accepted) {
+        fail();
+        return;
+    }
+    end_value();
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tdd_guard {
+
+// Receives values from JsonStream as they are tokenized. The interface
+// mirrors the nlohmann::json SAX handler; returning false stops the stream.
+class JsonHandler {
+public:
+    virtual ~JsonHandler() = default;
+
+    virtual auto null() -> bool = 0;
+    virtual auto boolean(bool value) -> bool = 0;
+    virtual auto number_integer(std::int64_t value) -> bool = 0;
+    virtual auto number_unsigned(std::uint64_t value) -> bool = 0;
+    virtual auto number_float(double value, const std::string& text) -> bool = 0;
+    virtual auto string(std::string& value) -> bool = 0;
+    virtual auto start_object(std::size_t elements) -> bool = 0;
+    virtual auto key(std::string& name) -> bool = 0;
+    virtual auto end_object() -> bool = 0;
+    virtual auto start_array(std::size_t elements) -> bool = 0;
+    virtual auto end_array() -> bool = 0;
+};
+
+// Incremental tokenizer for a single JSON document. Input may be split at
+// any byte; every byte is examined once and values reach the handler as
+// soon as they are complete, so parsing keeps pace with the producer.
+class JsonStream {
+public:
+    explicit JsonStream(JsonHandler& handler);
+
+    // Consumes bytes up to the end of the document and returns how many
+    // were used. Stops early once the document is complete or has failed.
+    auto feed(std::string_view bytes) -> std::size_t;
+
+    [[nodiscard]] auto complete() const -> bool;
+    [[nodiscard]] auto failed() const -> bool;
+
+    // Remembers the position between two tokens, such as the start of a
+    // line, so input that turns out not to belong to the document can be
+    // undone with rollback(). Values already passed to the handler stay.
+    auto checkpoint() -> void;
+    auto rollback() -> void;
+
+private:
+    enum class Expect { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd };
+    enum class Token { None, String, Number, Literal };
+    enum class Escape { None, Backslash, Unicode };
+    enum class Status { Running, Complete, Failed };
+
+    JsonHandler& handler_;
+    Status status_ = Status::Running;
+    Expect expect_ = Expect::Value;
+    std::vector<char> containers_;
+
+    Status saved_status_ = Status::Running;
+    Expect saved_expect_ = Expect::Value;
+    std::vector<char> saved_containers_;
+
+    // Token spanning feed calls
+    Token token_ = Token::None;
+    bool string_is_key_ = false;
+    std::string buffer_;
+    Escape escape_ = Escape::None;
+    int unicode_digits_ = 0;
+    std::uint32_t code_unit_ = 0;
+    std::uint32_t high_surrogate_ = 0;
+    // Continuation bytes still expected for a multi-byte UTF-8 sequence and
+    // the range the next one must fall in
+    int utf8_remaining_ = 0;
+    unsigned char utf8_lower_ = 0x80;
+    unsigned char utf8_upper_ = 0xBF;
+
+    auto fail() -> void;
+    auto begin_value(char c) -> void;
+    auto end_value() -> void;
+    auto end_container() -> void;
+    auto scan_string(std::string_view bytes, std::size_t pos) -> std::size_t;
+    auto scan_escape(unsigned char c) -> void;
+    auto scan_utf8_lead(unsigned char c) -> bool;
+    auto end_string() -> void;
+    auto scan_word(std::string_view bytes, std::size_t pos) -> std::size_t;
+    auto end_number() -> void;
+    auto end_literal() -> void;
+};
+
+} // namespace tdd_guard
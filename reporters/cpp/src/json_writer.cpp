@@ -0,0 +1,148 @@
+#include "json_writer.hpp"
+#include "file_io.hpp"
+#include <charconv>
+#include <utility>
+
+namespace tdd_guard {
+
+namespace {
+
+auto needs_escape(unsigned char c) -> bool {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+} // anonymous namespace
+
+JsonWriter::JsonWriter(int fd) : fd_(fd) {
+    buffer_.reserve(BUFFER_SIZE);
+}
+
+auto JsonWriter::begin_object() -> void {
+    separate();
+    put('{');
+    needs_comma_ = false;
+}
+
+auto JsonWriter::end_object() -> void {
+    put('}');
+    needs_comma_ = true;
+}
+
+auto JsonWriter::begin_array() -> void {
+    separate();
+    put('[');
+    needs_comma_ = false;
+}
+
+auto JsonWriter::end_array() -> void {
+    put(']');
+    needs_comma_ = true;
+}
+
+auto JsonWriter::key(std::string_view name) -> void {
+    separate();
+    put_escaped(name);
+    put(':');
+    needs_comma_ = false;
+}
+
+auto JsonWriter::string(std::string_view value) -> void {
+    separate();
+    put_escaped(value);
+    needs_comma_ = true;
+}
+
+auto JsonWriter::number(double value) -> void {
+    separate();
+    char text[32];
+    const auto result = std::to_chars(text, text + sizeof(text), value);
+    put(std::string_view(text, static_cast<std::size_t>(result.ptr - text)));
+    needs_comma_ = true;
+}
+
+auto JsonWriter::number(std::uint64_t value) -> void {
+    separate();
+    char text[24];
+    const auto result = std::to_chars(text, text + sizeof(text), value);
+    put(std::string_view(text, static_cast<std::size_t>(result.ptr - text)));
+    needs_comma_ = true;
+}
+
+auto JsonWriter::boolean(bool value) -> void {
+    separate();
+    put(value ? std::string_view("true") : std::string_view("false"));
+    needs_comma_ = true;
+}
+
+auto JsonWriter::flush() -> bool {
+    if (fd_ >= 0 && !buffer_.empty()) {
+        failed_ = failed_ || !write_all(fd_, {buffer_.data(), buffer_.size()});
+        buffer_.clear();
+    }
+    return !failed_;
+}
+
+auto JsonWriter::take() -> std::string {
+    return std::move(buffer_);
+}
+
+auto JsonWriter::separate() -> void {
+    if (needs_comma_) {
+        put(',');
+    }
+}
+
+auto JsonWriter::put(char c) -> void {
+    if (fd_ >= 0 && buffer_.size() == BUFFER_SIZE) {
+        (void)flush();
+    }
+    buffer_.push_back(c);
+}
+
+auto JsonWriter::put(std::string_view bytes) -> void {
+    if (fd_ >= 0 && buffer_.size() + bytes.size() > BUFFER_SIZE) {
+        (void)flush();
+        if (bytes.size() >= BUFFER_SIZE) {
+            failed_ = failed_ || !write_all(fd_, {bytes.data(), bytes.size()});
+            return;
+        }
+    }
+    buffer_.append(bytes);
+}
+
+// Copies runs of plain bytes whole; only quotes, backslashes and control
+// characters are rewritten. Other bytes, including UTF-8 sequences and DEL,
+// pass through as dump() leaves them.
+auto JsonWriter::put_escaped(std::string_view value) -> void {
+    static constexpr char HEX[] = "0123456789abcdef";
+
+    put('"');
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        const auto c = static_cast<unsigned char>(value[i]);
+        if (!needs_escape(c)) {
+            continue;
+        }
+        put(value.substr(run, i - run));
+        run = i + 1;
+
+        switch (c) {
+            case '"': put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\b': put("\\b"); break;
+            case '\f': put("\\f"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default: {
+                const char escape[] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                put(std::string_view(escape, sizeof(escape)));
+                break;
+            }
+        }
+    }
+    put(value.substr(run));
+    put('"');
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace tdd_guard {
+
+// Writes compact JSON as it goes, either into a string or through a buffer
+// to a file descriptor, so a report is never held as a document tree.
+// Strings are escaped the way nlohmann::json::dump() escapes them; callers
+// emit keys in sorted order to match its object layout.
+class JsonWriter {
+public:
+    // Collects the output in memory, see take()
+    JsonWriter() = default;
+    // Writes to fd whenever the buffer fills and on flush()
+    explicit JsonWriter(int fd);
+
+    JsonWriter(const JsonWriter&) = delete;
+    auto operator=(const JsonWriter&) -> JsonWriter& = delete;
+
+    auto begin_object() -> void;
+    auto end_object() -> void;
+    auto begin_array() -> void;
+    auto end_array() -> void;
+    auto key(std::string_view name) -> void;
+    auto string(std::string_view value) -> void;
+    // Shortest form that reads back as the same double; must be finite
+    auto number(double value) -> void;
+    auto number(std::uint64_t value) -> void;
+    auto boolean(bool value) -> void;
+
+    // Writes out everything buffered. False once any write to fd failed.
+    [[nodiscard]] auto flush() -> bool;
+    [[nodiscard]] auto take() -> std::string;
+
+private:
+    static constexpr std::size_t BUFFER_SIZE = 64 * 1024;
+
+    int fd_ = -1;
+    std::string buffer_;
+    bool needs_comma_ = false;
+    bool failed_ = false;
+
+    auto separate() -> void;
+    auto put(char c) -> void;
+    auto put(std::string_view bytes) -> void;
+    auto put_escaped(std::string_view value) -> void;
+};
+
+} // namespace tdd_guard
@@ -0,0 +1,180 @@
+#include "line_scan.hpp"
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define TDD_GUARD_X86_SIMD 1
+#endif
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr char ESCAPE = '\x1b';
+
+// Whitespace as std::isspace sees it in the C locale
+auto is_blank(char c) -> bool {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+auto end_line(std::size_t offset, LineInfo& line, std::vector<std::size_t>& ends,
+              std::vector<LineInfo>& infos) -> void {
+    ends.push_back(offset);
+    infos.push_back(line);
+    line = LineInfo{};
+}
+
+auto scan_scalar(std::string_view bytes, std::size_t base, LineInfo& line,
+                 std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void {
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        const char c = bytes[i];
+        if (c == '\n') {
+            end_line(base + i, line, ends, infos);
+            continue;
+        }
+        line.has_escape = line.has_escape || c == ESCAPE;
+        if (!line.has_first && !is_blank(c)) {
+            line.first = c;
+            line.has_first = true;
+        }
+    }
+}
+
+#ifdef TDD_GUARD_X86_SIMD
+
+// Applies the masks of one block, where bit i describes block[i]
+inline auto apply_masks(const char* block, std::size_t offset, std::uint32_t newlines,
+                        std::uint32_t escapes, std::uint32_t non_blank, LineInfo& line,
+                        std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void {
+    const auto update = [&](std::uint32_t segment) {
+        line.has_escape = line.has_escape || (escapes & segment) != 0;
+        if (!line.has_first) {
+            if (const auto found = non_blank & segment; found != 0) {
+                line.first = block[__builtin_ctz(found)];
+                line.has_first = true;
+            }
+        }
+    };
+
+    // Bits of the block at or after the start of the open line
+    std::uint32_t open = ~0U;
+    while (newlines != 0) {
+        const auto bit = static_cast<unsigned>(__builtin_ctz(newlines));
+        update(open & ((1U << bit) - 1));
+        end_line(offset + bit, line, ends, infos);
+        open = ~((2U << bit) - 1);
+        newlines &= newlines - 1;
+    }
+    update(open);
+}
+
+__attribute__((target("sse2")))
+auto scan_sse2(std::string_view bytes, std::size_t base, LineInfo& line,
+               std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void {
+    const auto newline = _mm_set1_epi8('\n');
+    const auto escape = _mm_set1_epi8(ESCAPE);
+    const auto space = _mm_set1_epi8(' ');
+    const auto tab = _mm_set1_epi8('\t');
+    const auto control_span = _mm_set1_epi8('\r' - '\t');
+
+    std::size_t i = 0;
+    for (; i + 16 <= bytes.size(); i += 16) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data() + i));
+        const auto newlines = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+        const auto escapes = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, escape)));
+        // '\t'..'\r' as an unsigned range check: (v - '\t') <= 4
+        const auto offset = _mm_sub_epi8(v, tab);
+        const auto controls = _mm_cmpeq_epi8(_mm_min_epu8(offset, control_span), offset);
+        const auto blanks = _mm_or_si128(_mm_cmpeq_epi8(v, space), controls);
+        const auto non_blank = ~static_cast<std::uint32_t>(_mm_movemask_epi8(blanks)) & 0xFFFFU;
+
+        if (newlines == 0 && escapes == 0 && (line.has_first || non_blank == 0)) {
+            continue;
+        }
+        apply_masks(bytes.data() + i, base + i, newlines, escapes, non_blank, line, ends, infos);
+    }
+    scan_scalar(bytes.substr(i), base + i, line, ends, infos);
+}
+
+__attribute__((target("avx2")))
+auto scan_avx2(std::string_view bytes, std::size_t base, LineInfo& line,
+               std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void {
+    const auto newline = _mm256_set1_epi8('\n');
+    const auto escape = _mm256_set1_epi8(ESCAPE);
+    const auto space = _mm256_set1_epi8(' ');
+    const auto tab = _mm256_set1_epi8('\t');
+    const auto control_span = _mm256_set1_epi8('\r' - '\t');
+
+    std::size_t i = 0;
+    for (; i + 32 <= bytes.size(); i += 32) {
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes.data() + i));
+        const auto newlines = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)));
+        const auto escapes = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, escape)));
+        const auto offset = _mm256_sub_epi8(v, tab);
+        const auto controls = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, control_span), offset);
+        const auto blanks = _mm256_or_si256(_mm256_cmpeq_epi8(v, space), controls);
+        const auto non_blank = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(blanks));
+
+        if (newlines == 0 && escapes == 0 && (line.has_first || non_blank == 0)) {
+            continue;
+        }
+        apply_masks(bytes.data() + i, base + i, newlines, escapes, non_blank, line, ends, infos);
+    }
+    scan_sse2(bytes.substr(i), base + i, line, ends, infos);
+}
+
+#endif
+
+} // anonymous namespace
+
+auto is_supported(ScanMethod method) -> bool {
+    switch (method) {
+        case ScanMethod::Scalar:
+            return true;
+#ifdef TDD_GUARD_X86_SIMD
+        case ScanMethod::Sse2:
+            return true;
+        case ScanMethod::Avx2:
+            return __builtin_cpu_supports("avx2") != 0;
+#else
+        case ScanMethod::Sse2:
+        case ScanMethod::Avx2:
+            return false;
+#endif
+    }
+    return false;
+}
+
+auto best_scan_method() -> ScanMethod {
+    static const ScanMethod method = is_supported(ScanMethod::Avx2) ? ScanMethod::Avx2
+                                   : is_supported(ScanMethod::Sse2) ? ScanMethod::Sse2
+                                   : ScanMethod::Scalar;
+    return method;
+}
+
+auto scan_lines(std::string_view bytes, std::size_t base, LineInfo& line,
+                std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void {
+    scan_lines(best_scan_method(), bytes, base, line, ends, infos);
+}
+
+auto scan_lines(ScanMethod method, std::string_view bytes, std::size_t base, LineInfo& line,
+                std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void {
+    switch (method) {
+#ifdef TDD_GUARD_X86_SIMD
+        case ScanMethod::Avx2:
+            scan_avx2(bytes, base, line, ends, infos);
+            return;
+        case ScanMethod::Sse2:
+            scan_sse2(bytes, base, line, ends, infos);
+            return;
+#else
+        case ScanMethod::Avx2:
+        case ScanMethod::Sse2:
+#endif
+        case ScanMethod::Scalar:
+            scan_scalar(bytes, base, line, ends, infos);
+            return;
+    }
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace tdd_guard {
+
+// What the reporter needs to know about a line before looking at it
+struct LineInfo {
+    // First byte that is not whitespace, valid when has_first is set
+    char first = '\0';
+    bool has_first = false;
+    bool has_escape = false;
+};
+
+enum class ScanMethod { Scalar, Sse2, Avx2 };
+
+// The fastest method this CPU supports, detected once
+[[nodiscard]] auto best_scan_method() -> ScanMethod;
+[[nodiscard]] auto is_supported(ScanMethod method) -> bool;
+
+// Finds line breaks, ESC bytes and the first non-blank byte of every line in
+// one pass over bytes, 16 or 32 at a time where the CPU allows. `line` holds
+// the line left open by the previous call. Each '\n' appends its offset
+// (counted from base) to ends and the finished line to infos.
+auto scan_lines(std::string_view bytes, std::size_t base, LineInfo& line,
+                std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void;
+
+// Same, with a specific method; used to test every implementation
+auto scan_lines(ScanMethod method, std::string_view bytes, std::size_t base, LineInfo& line,
+                std::vector<std::size_t>& ends, std::vector<LineInfo>& infos) -> void;
+
+} // namespace tdd_guard
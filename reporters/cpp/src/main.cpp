@@ -1,20 +1,44 @@
-#include <cctype>
+#include <charconv>
+#include <csignal>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
-#include <ranges>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unistd.h>
 #include <vector>
 
-#include "error_parser.hpp"
-#include "parser.hpp"
-#include "transformer.hpp"
+#include "daemon.hpp"
+#include "impact.hpp"
+#include "reporter.hpp"
+#include "result_cache.hpp"
+#include "shards.hpp"
+#include "stats.hpp"
 
 namespace fs = std::filesystem;
 
 struct Args {
     std::string project_root;
     bool passthrough = false;
+    bool single_threaded = false;
+    bool stats = false;
+    bool daemon = false;
+    bool no_daemon = false;
+    std::string socket;
+    // run -- <command>: the test command the reporter starts itself
+    bool run = false;
+    std::vector<char*> command;
+    // Runs the command's tests in parallel batches; 0 uses every core
+    std::optional<unsigned> jobs;
+    // Runs only the test binaries after -- that changes reach, with the
+    // index read from this build directory
+    std::optional<std::string> impact;
+    std::vector<std::string> changed;
+    // Reuses the results of an identical passing run instead of running
+    bool cache = false;
+    tdd_guard::CacheOptions cache_options;
+    // The first malformed argument, reported before anything runs
+    std::string error;
 };
 
 auto parse_args(int argc, char* argv[]) -> Args {
@@ -26,136 +50,161 @@ auto parse_args(int argc, char* argv[]) -> Args {
             args.project_root = argv[++i];
         } else if (arg == "--passthrough") {
             args.passthrough = true;
+        } else if (arg == "--single-threaded") {
+            args.single_threaded = true;
+        } else if (arg == "--stats") {
+            args.stats = true;
+        } else if (arg == "--daemon") {
+            args.daemon = true;
+        } else if (arg == "--no-daemon") {
+            args.no_daemon = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            args.socket = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            const std::string_view count = argv[++i];
+            unsigned jobs = 0;
+            const auto [end, ec] = std::from_chars(count.data(), count.data() + count.size(), jobs);
+            if ((ec != std::errc() || end != count.data() + count.size()) && args.error.empty()) {
+                args.error = "Error: --jobs takes a number of processes, got '" + std::string(count) + "'";
+            }
+            args.jobs = jobs;
+        } else if (arg == "--impact" && i + 1 < argc) {
+            args.impact = argv[++i];
+        } else if (arg == "--changed" && i + 1 < argc) {
+            args.changed.emplace_back(argv[++i]);
+        } else if (arg == "--cache") {
+            args.cache = true;
+        } else if (arg == "--rerun") {
+            args.cache_options.rerun = true;
+        } else if (arg == "--cache-env" && i + 1 < argc) {
+            args.cache_options.env.emplace_back(argv[++i]);
+        } else if (arg == "run") {
+            args.run = true;
+        } else if (arg == "--") {
+            args.command.assign(argv + i + 1, argv + argc);
+            break;
         }
     }
 
     return args;
 }
 
-auto save_results(const fs::path& project_root, const tdd_guard::TddGuardOutput& output) -> bool {
-    auto output_dir = project_root / ".claude" / "tdd-guard" / "data";
-
-    std::error_code ec;
-    fs::create_directories(output_dir, ec);
-    if (ec) {
-        std::cerr << "Error creating directory: " << ec.message() << "\n";
-        return false;
+// Options that need another one, or ways of running that do not combine
+auto usage_error(const Args& args) -> std::optional<std::string> {
+    if (!args.error.empty()) {
+        return args.error;
     }
-
-    auto output_file = output_dir / "test.json";
-    auto temp_file = output_dir / "test.json.tmp";
-
-    std::ofstream ofs(temp_file);
-    if (!ofs) {
-        std::cerr << "Error opening temp file for writing\n";
-        return false;
+    std::vector<std::string_view> modes;
+    if (args.impact) {
+        modes.emplace_back("--impact");
     }
-
-    ofs << output.to_json();
-
-    // Check for write errors before closing and renaming
-    if (!ofs) {
-        std::cerr << "Error writing to temp file\n";
-        return false;
+    if (args.jobs) {
+        modes.emplace_back("--jobs");
     }
-
-    ofs.close();
-    if (!ofs) {
-        std::cerr << "Error closing temp file\n";
-        return false;
+    if (args.cache) {
+        modes.emplace_back("--cache");
     }
-
-    fs::remove(output_file, ec);
-    ec.clear();
-
-    fs::rename(temp_file, output_file, ec);
-    if (ec) {
-        std::cerr << "Error renaming temp file: " << ec.message() << "\n";
-        return false;
+    if (modes.size() > 1) {
+        return "Error: " + std::string(modes[0]) + " and " + std::string(modes[1]) + " cannot be combined";
     }
-
-    return true;
-}
-
-auto process_passthrough(const fs::path& project_root) -> int {
-    std::vector<std::string> all_lines;
-    std::string all_content;
-    std::string line;
-
-    while (std::getline(std::cin, line)) {
-        std::cout << line << "\n";
-        std::cout.flush();
-        all_lines.push_back(line);
-        all_content += line + "\n";
+    if (!modes.empty() && !args.run) {
+        return "Error: " + std::string(modes[0]) + " needs run -- <test command>";
     }
-
-    tdd_guard::Parser parser;
-    std::vector<tdd_guard::TestEvent> events;
-
-    const bool parsed = parser.parse(all_content);
-    if (parsed) {
-        events = parser.events();
+    if (!args.changed.empty() && !args.impact) {
+        return "Error: --changed needs --impact";
     }
-
-    auto is_json_syntax = [](std::string_view line) {
-        auto trimmed = line | std::views::drop_while([](unsigned char c) {
-            return std::isspace(c);
-        });
-        if (trimmed.empty()) return false;
-        char first = *trimmed.begin();
-        return first == '{' || first == '}' || first == '[' || first == ']' || first == '"';
-    };
-
-    std::vector<std::string> stderr_lines;
-    for (const auto& line : all_lines) {
-        if (!is_json_syntax(line)) {
-            stderr_lines.push_back(line);
-        }
+    if ((args.cache_options.rerun || !args.cache_options.env.empty()) && !args.cache) {
+        return std::string("Error: ") + (args.cache_options.rerun ? "--rerun" : "--cache-env") + " needs --cache";
     }
+    return std::nullopt;
+}
 
-    auto compilation_errors = tdd_guard::parse_error_buffer(stderr_lines);
-    if (!parsed && compilation_errors.empty() && !all_content.empty()) {
-        compilation_errors.push_back(tdd_guard::CompilationError{
-            .message = "Failed to parse test output",
-            .note = "No JSON test output detected"
-        });
-    }
+auto passthrough_options(const Args& args) -> tdd_guard::PassthroughOptions {
+    return {.single_threaded = args.single_threaded};
+}
 
-    auto output = tdd_guard::transform_events(events, compilation_errors);
+tdd_guard::Daemon* running_daemon = nullptr;
 
-    if (!save_results(project_root, output)) {
+extern "C" void stop_daemon(int /*signal*/) {
+    running_daemon->stop();
+}
+
+auto run_daemon(const fs::path& socket_path) -> int {
+    tdd_guard::Daemon daemon;
+    if (!daemon.listen(socket_path, std::cerr)) {
         return 1;
     }
-
+    running_daemon = &daemon;
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, stop_daemon);
+    std::signal(SIGTERM, stop_daemon);
+    std::cerr << "tdd-guard-cpp daemon listening on " << socket_path.string() << "\n";
+    daemon.serve();
     return 0;
 }
 
 int main(int argc, char* argv[]) {
     auto args = parse_args(argc, argv);
-
-    if (args.project_root.empty()) {
-        std::cerr << "Error: --project-root is required\n";
+    if (const auto error = usage_error(args)) {
+        std::cerr << *error << "\n";
         return 1;
     }
+    const auto socket_path = args.socket.empty() ? tdd_guard::default_socket_path() : fs::path(args.socket);
 
-    fs::path project_root(args.project_root);
+    if (args.daemon) {
+        return run_daemon(socket_path);
+    }
 
-    if (!project_root.is_absolute()) {
-        std::cerr << "Error: project-root must be an absolute path\n";
-        return 1;
+    if (args.stats) {
+#ifdef TDD_GUARD_STATS
+        tdd_guard::set_stats_enabled(true);
+#else
+        std::cerr << "Warning: --stats is not available in this build\n";
+#endif
     }
 
-    if (!fs::exists(project_root)) {
-        std::cerr << "Error: project-root does not exist: " << project_root.string() << "\n";
-        return 1;
+    // A running daemon validates the root itself and remembers it. Runs with
+    // --stats stay in-process so the numbers describe this run alone.
+    if (args.passthrough && !args.run && !args.no_daemon && !tdd_guard::stats_enabled()) {
+        if (const auto status = tdd_guard::run_with_daemon(socket_path, args.project_root, STDIN_FILENO,
+                                                           STDOUT_FILENO, passthrough_options(args), std::cerr)) {
+            return *status;
+        }
     }
 
-    auto validated_root = fs::canonical(project_root);
+    const auto validated_root = tdd_guard::validate_project_root(args.project_root, std::cerr);
+    if (!validated_root) {
+        return 1;
+    }
 
-    if (args.passthrough) {
-        return process_passthrough(validated_root);
+    if (args.run || args.passthrough) {
+        // Without a results directory the output is still passed through
+        const int results_fd = tdd_guard::open_results_dir(*validated_root, std::cerr);
+        int status = 0;
+        if (args.run && args.impact) {
+            tdd_guard::ImpactOptions options{.build_dir = *args.impact, .changed = {}};
+            options.changed.assign(args.changed.begin(), args.changed.end());
+            status = tdd_guard::run_impacted(results_fd, args.command, options, STDOUT_FILENO, STDERR_FILENO,
+                                             std::cerr);
+        } else if (args.run && args.jobs) {
+            status = tdd_guard::run_sharded(results_fd, args.command, STDOUT_FILENO, STDERR_FILENO,
+                                            {.jobs = *args.jobs}, std::cerr);
+        } else if (args.run && args.cache) {
+            status = tdd_guard::run_cached(results_fd, args.command, STDOUT_FILENO, STDERR_FILENO,
+                                           passthrough_options(args), args.cache_options, std::cerr);
+        } else if (args.run) {
+            status = tdd_guard::run_command(results_fd, args.command, STDOUT_FILENO, STDERR_FILENO,
+                                            passthrough_options(args), std::cerr);
+        } else {
+            status = tdd_guard::run_passthrough(results_fd, STDIN_FILENO, STDOUT_FILENO, passthrough_options(args),
+                                                std::cerr);
+        }
+        if (results_fd >= 0) {
+            ::close(results_fd);
+        }
+        return status;
     }
 
-    std::cerr << "Error: only --passthrough mode is currently supported\n";
+    std::cerr << "Error: use --passthrough or run -- <test command>\n";
     return 1;
 }
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace tdd_guard {
+
+// A file mapped read-only for as long as this lives, so large files are
+// read straight from the page cache instead of being copied into a string
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    auto operator=(MappedFile&& other) noexcept -> MappedFile&;
+
+    // Opens name relative to dir_fd, or to the working directory with
+    // AT_FDCWD. Empty when the file cannot be read or is empty.
+    [[nodiscard]] static auto open(int dir_fd, const char* name) -> MappedFile;
+
+    [[nodiscard]] auto content() const -> std::string_view;
+
+private:
+    MappedFile(void* data, std::size_t size);
+
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+} // namespace tdd_guard
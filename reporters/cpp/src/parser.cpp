@@ -1,38 +1,347 @@
 #include "parser.hpp"
-#include <nlohmann/json.hpp>
+#include "catch2_sax.hpp"
+#include "googletest_sax.hpp"
+#include "json_stream.hpp"
+#include <charconv>
+#include <cstdint>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
 
 namespace tdd_guard {
 
-using json = nlohmann::json;
+namespace {
+
+// Keeps the conversion to microseconds from overflowing
+constexpr std::int64_t MAX_DURATION_SECONDS = 1'000'000'000'000;
+
+// How many values a line may hold back before they are passed on. A longer
+// line, such as a report printed without line breaks, can then no longer
+// be skipped, but the memory it takes stays bounded.
+constexpr std::size_t MAX_HELD_VALUES = 256;
+
+// A value read from the current line, held back until the line is known
+// to belong to the report
+struct HeldValue {
+    enum class Kind {
+        Null, Boolean, Integer, Unsigned, Float, String, StartObject, Key, EndObject, StartArray, EndArray
+    };
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    std::int64_t integer = 0;
+    // Also the element count of objects and arrays
+    std::uint64_t unsigned_value = 0;
+    double number = 0;
+    std::string text;
+};
+
+auto state_rank(TestEvent::State state) -> int {
+    switch (state) {
+        case TestEvent::State::Failed: return 3;
+        case TestEvent::State::Passed: return 2;
+        case TestEvent::State::Skipped: return 1;
+        case TestEvent::State::Unknown: return 0;
+    }
+    return 0;
+}
 
-auto TestEvent::error_message() const -> std::optional<std::string> {
-    std::string msg;
+// Folds a repeated run of a test into its first run: one failing run fails
+// the test, failure messages are collected and durations add up
+auto merge_run(TestEvent& first, TestEvent& repeat) -> void {
+    if (state_rank(repeat.state) > state_rank(first.state)) {
+        first.state = repeat.state;
+    }
+    if (!first.stdout_output) {
+        first.stdout_output = std::move(repeat.stdout_output);
+    }
+    if (!first.stderr_output) {
+        first.stderr_output = std::move(repeat.stderr_output);
+    }
+    for (auto& message : repeat.failure_messages) {
+        first.failure_messages.push_back(std::move(message));
+    }
+    if (repeat.duration) {
+        first.duration = first.duration.value_or(std::chrono::microseconds(0)) + *repeat.duration;
+    }
+}
 
-    if (stdout_output.has_value()) {
-        msg = *stdout_output;
+// Reports repeated with --gtest_repeat list every test once per repetition.
+// Keeps each test once, in the order of its first run.
+auto merge_repeated_tests(std::vector<TestEvent>& events) -> void {
+    std::unordered_map<std::string_view, std::size_t> first_runs;
+    first_runs.reserve(events.size());
+    std::vector<bool> repeated(events.size(), false);
+    bool any_repeated = false;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const auto [first, inserted] = first_runs.try_emplace(events[i].full_name, i);
+        if (!inserted) {
+            merge_run(events[first->second], events[i]);
+            repeated[i] = true;
+            any_repeated = true;
+        }
+    }
+    if (!any_repeated) {
+        return;
     }
 
-    if (stderr_output.has_value()) {
-        if (!msg.empty()) {
-            msg += "\n";
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        if (!repeated[i]) {
+            if (kept != i) {
+                events[kept] = std::move(events[i]);
+            }
+            ++kept;
         }
-        msg += *stderr_output;
     }
+    events.erase(events.begin() + static_cast<std::ptrdiff_t>(kept), events.end());
+}
 
-    for (const auto& failure : failure_messages) {
-        if (!msg.empty()) {
-            msg += "\n";
+} // anonymous namespace
+
+// The report being read. Tokens go to both framework handlers until one of
+// them recognizes its result array, after which the other is dropped.
+// Values are held back until the end of their line, so a line that turns
+// out not to be part of the report can be skipped without a trace.
+struct Parser::Report final : JsonHandler {
+    GoogleTestSax googletest;
+    Catch2Sax catch2;
+    bool googletest_active = true;
+    bool catch2_active = true;
+    JsonStream stream{*this};
+    // Held values are reused from line to line, swapping strings in and out
+    std::vector<HeldValue> held;
+    std::size_t held_count = 0;
+    bool line_passed_on = false;
+
+    explicit Report(std::vector<TestEvent>& events) : googletest(events), catch2(events) {}
+
+    auto begin_line() -> void {
+        stream.checkpoint();
+        held_count = 0;
+        line_passed_on = false;
+    }
+
+    // Whether the line read since begin_line can still be taken back
+    [[nodiscard]] auto can_skip_line() const -> bool {
+        return !line_passed_on;
+    }
+
+    auto skip_line() -> void {
+        stream.rollback();
+        held_count = 0;
+    }
+
+    // Passes the held values on to the handlers. False once both gave up.
+    auto pass_on() -> bool {
+        bool active = googletest_active || catch2_active;
+        for (std::size_t i = 0; i < held_count && active; ++i) {
+            active = replay(held[i]);
+        }
+        held_count = 0;
+        return active;
+    }
+
+    auto hold(HeldValue::Kind kind) -> HeldValue& {
+        if (held_count == held.size()) {
+            held.emplace_back();
+        }
+        auto& value = held[held_count++];
+        value.kind = kind;
+        return value;
+    }
+
+    auto held_back() -> bool {
+        if (held_count < MAX_HELD_VALUES) {
+            return true;
+        }
+        line_passed_on = true;
+        return pass_on();
+    }
+
+    auto replay(HeldValue& value) -> bool {
+        using Kind = HeldValue::Kind;
+        switch (value.kind) {
+            case Kind::Null:
+                return forward([](JsonHandler& h) { return h.null(); });
+            case Kind::Boolean:
+                return forward([&](JsonHandler& h) { return h.boolean(value.boolean); });
+            case Kind::Integer:
+                return forward([&](JsonHandler& h) { return h.number_integer(value.integer); });
+            case Kind::Unsigned:
+                return forward([&](JsonHandler& h) { return h.number_unsigned(value.unsigned_value); });
+            case Kind::Float:
+                return forward([&](JsonHandler& h) { return h.number_float(value.number, value.text); });
+            case Kind::String:
+                return forward([&](JsonHandler& h) { return h.string(value.text); });
+            case Kind::StartObject:
+                return forward([&](JsonHandler& h) { return h.start_object(value.unsigned_value); });
+            case Kind::Key:
+                return forward([&](JsonHandler& h) { return h.key(value.text); });
+            case Kind::EndObject:
+                return forward([](JsonHandler& h) { return h.end_object(); });
+            case Kind::StartArray:
+                return forward([&](JsonHandler& h) { return h.start_array(value.unsigned_value); });
+            case Kind::EndArray:
+                return forward([](JsonHandler& h) { return h.end_array(); });
+        }
+        return false;
+    }
+
+    template<typename Event>
+    auto forward(Event event) -> bool {
+        if (googletest_active) {
+            googletest_active = event(static_cast<JsonHandler&>(googletest));
+        }
+        if (catch2_active) {
+            catch2_active = event(static_cast<JsonHandler&>(catch2));
+        }
+        if (googletest_active && googletest.claimed()) {
+            catch2_active = false;
+        } else if (catch2_active && catch2.claimed()) {
+            googletest_active = false;
         }
-        msg += failure;
+        return googletest_active || catch2_active;
     }
 
-    if (msg.empty()) {
+    auto null() -> bool override {
+        hold(HeldValue::Kind::Null);
+        return held_back();
+    }
+    auto boolean(bool value) -> bool override {
+        hold(HeldValue::Kind::Boolean).boolean = value;
+        return held_back();
+    }
+    auto number_integer(std::int64_t value) -> bool override {
+        hold(HeldValue::Kind::Integer).integer = value;
+        return held_back();
+    }
+    auto number_unsigned(std::uint64_t value) -> bool override {
+        hold(HeldValue::Kind::Unsigned).unsigned_value = value;
+        return held_back();
+    }
+    auto number_float(double value, const std::string& text) -> bool override {
+        auto& held_value = hold(HeldValue::Kind::Float);
+        held_value.number = value;
+        held_value.text.assign(text);
+        return held_back();
+    }
+    auto string(std::string& value) -> bool override {
+        hold(HeldValue::Kind::String).text.swap(value);
+        return held_back();
+    }
+    auto start_object(std::size_t elements) -> bool override {
+        hold(HeldValue::Kind::StartObject).unsigned_value = elements;
+        return held_back();
+    }
+    auto key(std::string& name) -> bool override {
+        hold(HeldValue::Kind::Key).text.swap(name);
+        return held_back();
+    }
+    auto end_object() -> bool override {
+        hold(HeldValue::Kind::EndObject);
+        return held_back();
+    }
+    auto start_array(std::size_t elements) -> bool override {
+        hold(HeldValue::Kind::StartArray).unsigned_value = elements;
+        return held_back();
+    }
+    auto end_array() -> bool override {
+        hold(HeldValue::Kind::EndArray);
+        return held_back();
+    }
+
+    [[nodiscard]] auto framework() const -> Framework {
+        if (googletest.claimed()) return Framework::GoogleTest;
+        if (catch2.claimed()) return Framework::Catch2;
+        return Framework::Unknown;
+    }
+
+    [[nodiscard]] auto succeeded() const -> bool {
+        if (!stream.complete()) return false;
+        switch (framework()) {
+            case Framework::GoogleTest: return googletest.succeeded();
+            case Framework::Catch2: return catch2.succeeded();
+            case Framework::Unknown: return false;
+        }
+        return false;
+    }
+
+    // Incomplete but well-formed so far: the input ended, or stopped being
+    // JSON, part way through a recognized report
+    [[nodiscard]] auto truncated() const -> bool {
+        return !stream.complete() && framework() != Framework::Unknown &&
+               (googletest_active || catch2_active);
+    }
+};
+
+Parser::Parser() = default;
+Parser::~Parser() = default;
+
+auto TestEvent::error_message() const -> std::optional<std::string> {
+    // Parts are joined by '\n' once the message is non-empty. The length is
+    // worked out first so the message is built with a single allocation.
+    const auto for_each_part = [this](auto&& visit) {
+        if (stdout_output.has_value()) {
+            visit(*stdout_output);
+        }
+        if (stderr_output.has_value()) {
+            visit(*stderr_output);
+        }
+        for (const auto& failure : failure_messages) {
+            visit(failure);
+        }
+    };
+
+    std::size_t size = 0;
+    for_each_part([&](const std::string& part) {
+        size += (size > 0 ? 1 : 0) + part.size();
+    });
+    if (size == 0) {
         return std::nullopt;
     }
 
+    std::string msg;
+    msg.reserve(size);
+    for_each_part([&](const std::string& part) {
+        if (!msg.empty()) {
+            msg += '\n';
+        }
+        msg += part;
+    });
     return msg;
 }
 
+auto parse_duration(std::string_view text) -> std::optional<std::chrono::microseconds> {
+    if (text.size() < 2 || text.back() != 's') {
+        return std::nullopt;
+    }
+    text.remove_suffix(1);
+
+    std::int64_t seconds = 0;
+    const auto* end = text.data() + text.size();
+    const auto [rest, error] = std::from_chars(text.data(), end, seconds);
+    if (error != std::errc{} || seconds < 0 || seconds > MAX_DURATION_SECONDS) {
+        return std::nullopt;
+    }
+
+    std::int64_t micros = 0;
+    if (rest != end) {
+        if (*rest != '.' || rest + 1 == end) {
+            return std::nullopt;
+        }
+        std::int64_t scale = 100000;
+        for (const auto* digit = rest + 1; digit != end; ++digit) {
+            if (*digit < '0' || *digit > '9') {
+                return std::nullopt;
+            }
+            micros += (*digit - '0') * scale;
+            scale /= 10;
+        }
+    }
+    return std::chrono::microseconds(seconds * 1000000 + micros);
+}
+
 auto Parser::detect_framework(std::string_view json) -> Framework {
     if (json.find("\"testsuites\"") != std::string_view::npos) {
         return Framework::GoogleTest;
@@ -44,250 +353,155 @@ auto Parser::detect_framework(std::string_view json) -> Framework {
     return Framework::Unknown;
 }
 
-auto Parser::extract_module(std::string_view test_name) -> std::string {
+auto Parser::extract_module(std::string_view test_name) -> std::string_view {
     if (auto dot_pos = test_name.find('.'); dot_pos != std::string_view::npos) {
-        return std::string(test_name.substr(0, dot_pos));
+        return test_name.substr(0, dot_pos);
     }
 
     if (auto slash_pos = test_name.find('/'); slash_pos != std::string_view::npos) {
-        return std::string(test_name.substr(0, slash_pos));
+        return test_name.substr(0, slash_pos);
     }
 
     return "tests";
 }
 
-auto Parser::extract_simple_name(std::string_view test_name) -> std::string {
+auto Parser::extract_simple_name(std::string_view test_name) -> std::string_view {
     if (auto dot_pos = test_name.rfind('.'); dot_pos != std::string_view::npos) {
-        return std::string(test_name.substr(dot_pos + 1));
+        return test_name.substr(dot_pos + 1);
     }
 
     if (auto slash_pos = test_name.rfind('/'); slash_pos != std::string_view::npos) {
-        return std::string(test_name.substr(slash_pos + 1));
+        return test_name.substr(slash_pos + 1);
     }
 
-    return std::string(test_name);
+    return test_name;
 }
 
-auto Parser::extract_json(std::string_view content) -> std::string_view {
-    auto json_start = content.find("\n{");
-    if (json_start == std::string_view::npos) {
-        json_start = content.find("{");
-    } else {
-        json_start += 1;
-    }
-
-    if (json_start == std::string_view::npos) {
-        return {};
-    }
-
-    auto json_end = content.rfind('}');
-    if (json_end == std::string_view::npos || json_end < json_start) {
-        return {};
-    }
-
-    return content.substr(json_start, json_end - json_start + 1);
-}
-
-auto Parser::parse(std::string_view content) -> bool {
-    auto json = extract_json(content);
-    if (json.empty()) {
-        return false;
-    }
-
+auto Parser::reset() -> void {
     events_.clear();
-    detected_framework_ = Framework::Unknown;
-    detected_framework_ = detect_framework(json);
+    report_.reset();
+    reports_ = 0;
+    found_ = false;
+    truncated_ = false;
+    failed_ = false;
+    fed_ = 0;
+    mid_line_brace_.reset();
+}
 
-    switch (detected_framework_) {
-        case Framework::GoogleTest:
-            return parse_googletest(json);
-        case Framework::Catch2:
-            return parse_catch2(json);
-        case Framework::Unknown:
-            return false;
+auto Parser::feed_lines(std::string_view content) -> void {
+    while (!content.empty()) {
+        const auto end = content.find('\n');
+        feed_line(content.substr(0, end));
+        if (end == std::string_view::npos) {
+            break;
+        }
+        content.remove_prefix(end + 1);
     }
-
-    return false;
 }
 
-auto Parser::events() const -> const std::vector<TestEvent>& {
-    return events_;
+auto Parser::parse(std::string_view content) -> bool {
+    reset();
+    feed_lines(content);
+    return finish(content);
 }
 
-auto Parser::parse_googletest(std::string_view json_str) -> bool {
-    try {
-        auto data = json::parse(json_str);
-
-        if (!data.contains("testsuites") || !data["testsuites"].is_array()) {
-            return false;
-        }
-
-        for (const auto& suite : data["testsuites"]) {
-            if (!suite.is_object()) {
-                continue;
-            }
-            if (!suite.contains("testsuite") || !suite["testsuite"].is_array()) {
-                continue;
-            }
-
-            std::string suite_name = suite.value("name", "");
-
-            for (const auto& test : suite["testsuite"]) {
-                if (!test.is_object()) {
-                    continue;
-                }
-                TestEvent event;
-                event.name = test.value("name", "");
-                event.full_name = suite_name.empty()
-                    ? event.name
-                    : suite_name + "." + event.name;
-
-                std::string status = test.value("status", "");
-                if (status == "NOTRUN") {
-                    event.state = TestEvent::State::Skipped;
-                } else if (test.contains("failures") && test["failures"].is_array() &&
-                           !test["failures"].empty()) {
-                    event.state = TestEvent::State::Failed;
-                    for (const auto& failure : test["failures"]) {
-                        if (!failure.is_object()) {
-                            continue;
-                        }
-                        if (failure.contains("message") && failure["message"].is_string()) {
-                            event.failure_messages.push_back(failure["message"].get<std::string>());
-                        }
+auto Parser::feed_line(std::string_view line) -> void {
+    const auto line_start = fed_;
+    fed_ += line.size() + 1;
+    while (true) {
+        const bool starting = !report_;
+        if (starting) {
+            if (line.empty() || line.front() != '{') {
+                // Only needed until a report is found, so a clean log is
+                // searched once
+                if (!found_ && !mid_line_brace_) {
+                    if (const auto brace = line.find('{'); brace != std::string_view::npos) {
+                        mid_line_brace_ = line_start + brace;
                     }
-                } else {
-                    event.state = TestEvent::State::Passed;
                 }
-
-                events_.push_back(std::move(event));
+                return;
             }
+            report_ = std::make_unique<Report>(events_);
+            found_ = true;
         }
 
-        return true;
-    } catch (const json::exception&) {
-        return false;
-    }
-}
-
-auto Parser::parse_catch2(std::string_view json_str) -> bool {
-    try {
-        auto data = json::parse(json_str);
-
-        if (!data.contains("test-run") || !data["test-run"].is_object()) {
-            return false;
+        auto& report = *report_;
+        auto& stream = report.stream;
+        report.begin_line();
+        const auto used = stream.feed(line);
+        stream.feed("\n");
+
+        // A line that cannot continue the report is output interleaved with
+        // it, unless it starts a report of its own
+        if (stream.failed() && !starting && report.can_skip_line()) {
+            report.skip_line();
+            if (line.front() != '{') {
+                return;
+            }
+            close_report();
+            continue;
         }
 
-        auto& test_run = data["test-run"];
-        if (!test_run.contains("test-cases") || !test_run["test-cases"].is_array()) {
-            return false;
+        const bool complete = stream.complete();
+        if (!report.pass_on() || complete || stream.failed()) {
+            close_report();
         }
 
-        for (const auto& test_case : test_run["test-cases"]) {
-            if (!test_case.is_object()) {
-                continue;
-            }
-            TestEvent event;
+        // Another report may follow on the same line
+        if (!complete) {
+            return;
+        }
+        line.remove_prefix(used);
+        const auto next = line.find_first_not_of(" \t\r");
+        if (next == std::string_view::npos) {
+            return;
+        }
+        line.remove_prefix(next);
+    }
+}
 
-            std::string test_case_name;
-            if (test_case.contains("test-info") && test_case["test-info"].is_object()) {
-                test_case_name = test_case["test-info"].value("name", "");
-            }
+auto Parser::close_report() -> void {
+    if (report_->framework() != Framework::Unknown) {
+        ++reports_;
+        if (!report_->succeeded()) {
+            (report_->truncated() ? truncated_ : failed_) = true;
+        }
+    }
+    report_.reset();
+}
 
-            std::vector<std::string> section_names;
-            if (test_case.contains("runs") && test_case["runs"].is_array() &&
-                !test_case["runs"].empty()) {
-                const auto& run = test_case["runs"][0];
-                if (!run.is_object()) {
-                    continue;
-                }
-                const json* current_path = run.contains("path") && run["path"].is_array()
-                    ? &run["path"]
-                    : nullptr;
-                while (current_path != nullptr && current_path->is_array()) {
-                    const json* next_path = nullptr;
-                    for (const auto& path_item : *current_path) {
-                        if (!path_item.is_object()) {
-                            continue;
-                        }
-                        if (path_item.value("kind", "") == "section") {
-                            section_names.push_back(path_item.value("name", ""));
-                            if (path_item.contains("path")) {
-                                next_path = &path_item["path"];
-                            }
-                        }
-                    }
-                    current_path = next_path;
-                }
-            }
+auto Parser::finish() -> bool {
+    if (report_) {
+        close_report();
+    }
+    if (reports_ > 1) {
+        merge_repeated_tests(events_);
+    }
+    return reports_ > 0 && !truncated_ && !failed_;
+}
 
-            if (section_names.empty()) {
-                event.name = test_case_name;
-                event.full_name = test_case_name;
-            } else {
-                event.name = section_names.back();
-                if (!test_case_name.empty() && section_names.front() != test_case_name) {
-                    event.full_name = test_case_name + "/" + section_names[0];
-                } else {
-                    event.full_name = section_names[0];
-                }
-                for (size_t i = 1; i < section_names.size(); ++i) {
-                    event.full_name += "/" + section_names[i];
-                }
-            }
+auto Parser::finish(std::string_view output) -> bool {
+    // Fall back to a report that starts part way through a line
+    if (!found_ && mid_line_brace_ && *mid_line_brace_ < output.size()) {
+        feed_lines(output.substr(*mid_line_brace_));
+    }
+    return finish();
+}
 
-            if (test_case.contains("totals") && test_case["totals"].is_object() &&
-                test_case["totals"].contains("assertions") &&
-                test_case["totals"]["assertions"].is_object()) {
-                auto& assertions = test_case["totals"]["assertions"];
-                int failed = assertions.value("failed", 0);
-                int skipped = assertions.value("skipped", 0);
-                int passed = assertions.value("passed", 0);
-
-                if (skipped > 0 && failed == 0 && passed == 0) {
-                    event.state = TestEvent::State::Skipped;
-                } else if (failed > 0) {
-                    event.state = TestEvent::State::Failed;
-                } else {
-                    event.state = TestEvent::State::Passed;
-                }
-            } else {
-                event.state = TestEvent::State::Unknown;
-            }
+auto Parser::found_report() const -> bool {
+    return found_;
+}
 
-            if (event.state == TestEvent::State::Failed && test_case.contains("runs") &&
-                test_case["runs"].is_array()) {
-                for (const auto& run : test_case["runs"]) {
-                    if (!run.is_object()) {
-                        continue;
-                    }
-                    if (run.contains("path") && run["path"].is_array()) {
-                        for (const auto& path_item : run["path"]) {
-                            if (!path_item.is_object()) {
-                                continue;
-                            }
-                            if (path_item.value("kind", "") == "assertion" &&
-                                !path_item.value("status", true) &&
-                                path_item.contains("expression") &&
-                                path_item["expression"].is_object()) {
-                                auto& expr = path_item["expression"];
-                                std::string expanded = expr.value("expanded", "");
-                                if (!expanded.empty()) {
-                                    event.failure_messages.push_back(expanded);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+auto Parser::truncated() const -> bool {
+    return truncated_ || (report_ && report_->truncated());
+}
 
-            events_.push_back(std::move(event));
-        }
+auto Parser::events() const -> const std::vector<TestEvent>& {
+    return events_;
+}
 
-        return true;
-    } catch (const json::exception&) {
-        return false;
-    }
+auto Parser::take_events() -> std::vector<TestEvent> {
+    return std::exchange(events_, {});
 }
 
 } // namespace tdd_guard
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -22,26 +25,73 @@ struct TestEvent {
     std::optional<std::string> stdout_output;
     std::optional<std::string> stderr_output;
     std::vector<std::string> failure_messages;
+    std::optional<std::chrono::microseconds> duration = std::nullopt;
 
     [[nodiscard]] auto error_message() const -> std::optional<std::string>;
 };
 
+// Reads a duration in GoogleTest's form, seconds with a trailing 's' such
+// as "0.013s". Digits past microseconds are dropped. Does not allocate.
+[[nodiscard]] auto parse_duration(std::string_view text) -> std::optional<std::chrono::microseconds>;
+
 class Parser {
 public:
+    Parser();
+    ~Parser();
+    Parser(const Parser&) = delete;
+    auto operator=(const Parser&) -> Parser& = delete;
+
     static auto detect_framework(std::string_view json) -> Framework;
-    static auto extract_module(std::string_view test_name) -> std::string;
-    static auto extract_simple_name(std::string_view test_name) -> std::string;
+    // Both return views into test_name
+    static auto extract_module(std::string_view test_name) -> std::string_view;
+    static auto extract_simple_name(std::string_view test_name) -> std::string_view;
+
+    // Finds the JSON report in complete output and parses it
+    auto parse(std::string_view content) -> bool;
 
-    auto parse(std::string_view json) -> bool;
+    // Incremental form of parse: every output line is fed as it arrives and
+    // tests are reported once the line completing their JSON has been read.
+    // A report starts at a line beginning with '{'. Several reports, as
+    // --gtest_repeat prints them, are read one after another and their
+    // tests merged. Lines that cannot continue the report being read, such
+    // as stderr interleaved by 2>&1, are skipped.
+    auto feed_line(std::string_view line) -> void;
+    // True when at least one report was read and every report was complete
+    auto finish() -> bool;
+    // finish() for callers holding everything fed so far as output. When no
+    // line started a report, the output is read again from the first '{'
+    // part way through a line, found while the lines were fed, so no byte
+    // before it is looked at twice.
+    auto finish(std::string_view output) -> bool;
+
+    [[nodiscard]] auto found_report() const -> bool;
+    // True when a report stopped before it was complete, e.g. because the
+    // test binary crashed; events() then holds the tests that finished
+    [[nodiscard]] auto truncated() const -> bool;
     [[nodiscard]] auto events() const -> const std::vector<TestEvent>&;
+    // Moves the events out instead of copying them; events() is empty after
+    [[nodiscard]] auto take_events() -> std::vector<TestEvent>;
 
 private:
+    struct Report;
+
     std::vector<TestEvent> events_;
-    Framework detected_framework_ = Framework::Unknown;
+    // The report being read
+    std::unique_ptr<Report> report_;
+    // Reports of a known framework read so far, and whether any of them
+    // ended early or was rejected
+    std::size_t reports_ = 0;
+    bool found_ = false;
+    bool truncated_ = false;
+    bool failed_ = false;
+    // Bytes fed so far, counting a '\n' after each line, and the offset of
+    // the first '{' they held part way through a line
+    std::size_t fed_ = 0;
+    std::optional<std::size_t> mid_line_brace_;
 
-    static auto extract_json(std::string_view content) -> std::string_view;
-    auto parse_googletest(std::string_view json) -> bool;
-    auto parse_catch2(std::string_view json) -> bool;
+    auto reset() -> void;
+    auto feed_lines(std::string_view content) -> void;
+    auto close_report() -> void;
 };
 
 } // namespace tdd_guard
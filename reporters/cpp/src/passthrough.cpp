@@ -0,0 +1,245 @@
+#include "passthrough.hpp"
+#include "file_io.hpp"
+#include "spsc_ring.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <deque>
+#include <fcntl.h>
+#include <memory>
+#include <span>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+// Where captured bytes go: read straight into the span from prepare, then
+// hand over with commit
+class Sink {
+public:
+    virtual ~Sink() = default;
+    [[nodiscard]] virtual auto prepare(std::size_t size) -> std::span<char> = 0;
+    virtual auto commit(std::size_t size) -> void = 0;
+};
+
+// Captures into the input buffer on the forwarding thread
+class BufferSink final : public Sink {
+public:
+    BufferSink(InputBuffer& input, const InputCallback& on_input)
+        : input_(input), on_input_(on_input) {}
+
+    auto prepare(std::size_t size) -> std::span<char> override {
+        return input_.prepare(size);
+    }
+
+    auto commit(std::size_t size) -> void override {
+        input_.commit(size);
+        if (on_input_) {
+            on_input_();
+        }
+    }
+
+private:
+    InputBuffer& input_;
+    const InputCallback& on_input_;
+};
+
+// A block read on the forwarding thread. An empty chunk marks end of input.
+struct Chunk {
+    std::unique_ptr<char[]> data;
+    std::size_t size = 0;
+};
+
+constexpr std::size_t RING_CAPACITY = 64;
+using ChunkRing = SpscRing<Chunk, RING_CAPACITY>;
+using BlockRing = SpscRing<std::unique_ptr<char[]>, RING_CAPACITY>;
+
+// Hands each block to the worker through a ring and reuses the blocks it
+// returns. When the ring is full, blocks wait in a local queue instead, so
+// forwarding never waits for the worker; small reads are packed into the
+// last waiting block meanwhile.
+class ChunkSink final : public Sink {
+public:
+    ChunkSink(ChunkRing& chunks, BlockRing& free_blocks)
+        : chunks_(chunks), free_blocks_(free_blocks) {}
+
+    auto prepare(std::size_t /*size*/) -> std::span<char> override {
+        if (!pending_.empty() && BLOCK_SIZE - pending_.back().size >= MIN_SPACE) {
+            appending_ = true;
+            auto& last = pending_.back();
+            return {last.data.get() + last.size, BLOCK_SIZE - last.size};
+        }
+
+        appending_ = false;
+        if (!block_) {
+            auto reused = free_blocks_.try_pop();
+            block_ = reused ? std::move(*reused) : std::make_unique_for_overwrite<char[]>(BLOCK_SIZE);
+        }
+        return {block_.get(), BLOCK_SIZE};
+    }
+
+    auto commit(std::size_t size) -> void override {
+        if (size == 0) {
+            return;
+        }
+        if (appending_) {
+            pending_.back().size += size;
+        } else {
+            pending_.push_back(Chunk{.data = std::move(block_), .size = size});
+        }
+        publish();
+    }
+
+    // Blocks until everything has been handed over, then signals the end
+    auto finish() -> void {
+        for (auto& chunk : pending_) {
+            chunks_.push(std::move(chunk));
+        }
+        pending_.clear();
+        chunks_.push(Chunk{});
+    }
+
+private:
+    static constexpr std::size_t MIN_SPACE = 4 * 1024;
+
+    ChunkRing& chunks_;
+    BlockRing& free_blocks_;
+    std::unique_ptr<char[]> block_;
+    std::deque<Chunk> pending_;
+    bool appending_ = false;
+
+    auto publish() -> void {
+        while (!pending_.empty() && chunks_.try_push(pending_.front())) {
+            pending_.pop_front();
+        }
+    }
+};
+
+// Reads up to size bytes into space. Returns the byte count, 0 at end of
+// input and -1 on error.
+auto read_some(int fd, std::span<char> space, std::size_t size) -> ssize_t {
+    size = std::min(size, space.size());
+    for (;;) {
+        const auto count = ::read(fd, space.data(), size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        return count;
+    }
+}
+
+// Every block is written as soon as read returns it: a fast producer is
+// forwarded in large batches while an idle one is never held back
+auto copy_blocks(int in_fd, int out_fd, Sink& sink, bool forwarding) -> bool {
+    for (;;) {
+        auto space = sink.prepare(BLOCK_SIZE);
+        const auto count = read_some(in_fd, space, BLOCK_SIZE);
+        if (count == 0) {
+            return true;
+        }
+        if (count < 0) {
+            return false;
+        }
+        if (forwarding) {
+            forwarding = write_all(out_fd, {space.data(), static_cast<std::size_t>(count)});
+        }
+        sink.commit(static_cast<std::size_t>(count));
+    }
+}
+
+#ifdef __linux__
+
+enum class TeeResult { Finished, ReadFailed, OutputClosed, Unsupported };
+
+auto is_pipe(int fd) -> bool {
+    struct stat st {};
+    return ::fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+// Duplicates pending pipe data to out_fd in the kernel, then consumes the
+// same bytes into the sink, so the forwarded copy never enters userspace
+auto tee_pipes(int in_fd, int out_fd, Sink& sink) -> TeeResult {
+    for (;;) {
+        const auto teed = ::tee(in_fd, out_fd, BLOCK_SIZE, 0);
+        if (teed == 0) {
+            return TeeResult::Finished;
+        }
+        if (teed < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EPIPE ? TeeResult::OutputClosed : TeeResult::Unsupported;
+        }
+
+        for (auto remaining = static_cast<std::size_t>(teed); remaining > 0;) {
+            const auto count = read_some(in_fd, sink.prepare(remaining), remaining);
+            if (count <= 0) {
+                return TeeResult::ReadFailed;
+            }
+            sink.commit(static_cast<std::size_t>(count));
+            remaining -= static_cast<std::size_t>(count);
+        }
+    }
+}
+
+#endif
+
+auto forward_into(int in_fd, int out_fd, Sink& sink) -> bool {
+#ifdef __linux__
+    if (is_pipe(in_fd) && is_pipe(out_fd)) {
+        // Any bytes duplicated so far have been consumed, so the block copy
+        // can take over from the current position
+        switch (tee_pipes(in_fd, out_fd, sink)) {
+            case TeeResult::Finished:
+                return true;
+            case TeeResult::ReadFailed:
+                return false;
+            case TeeResult::OutputClosed:
+                return copy_blocks(in_fd, out_fd, sink, false);
+            case TeeResult::Unsupported:
+                break;
+        }
+    }
+#endif
+    return copy_blocks(in_fd, out_fd, sink, true);
+}
+
+} // anonymous namespace
+
+auto forward_stream(int in_fd, int out_fd, InputBuffer& input, const InputCallback& on_input) -> bool {
+    BufferSink sink(input, on_input);
+    return forward_into(in_fd, out_fd, sink);
+}
+
+auto forward_stream_pipelined(int in_fd, int out_fd, InputBuffer& input,
+                              const InputCallback& on_input) -> bool {
+    ChunkRing chunks;
+    BlockRing free_blocks;
+
+    std::thread worker([&] {
+        for (auto chunk = chunks.pop(); chunk.size > 0; chunk = chunks.pop()) {
+            input.append({chunk.data.get(), chunk.size});
+            if (on_input) {
+                on_input();
+            }
+            // A full free list just means the block is released instead
+            (void)free_blocks.try_push(chunk.data);
+        }
+    });
+
+    ChunkSink sink(chunks, free_blocks);
+    const bool succeeded = forward_into(in_fd, out_fd, sink);
+    const int read_errno = errno;
+    sink.finish();
+    worker.join();
+
+    errno = read_errno;
+    return succeeded;
+}
+
+} // namespace tdd_guard
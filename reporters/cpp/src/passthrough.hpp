@@ -0,0 +1,26 @@
+#pragma once
+
+#include "input_buffer.hpp"
+#include <functional>
+
+namespace tdd_guard {
+
+// Called after each block of input has been forwarded and captured
+using InputCallback = std::function<void()>;
+
+// Forwards everything readable from in_fd to out_fd byte for byte while
+// capturing it into input. When both descriptors are pipes on Linux the
+// forwarded copy is made in the kernel with tee(2); otherwise data moves in
+// large blocks. If out_fd stops accepting data, input is still drained so
+// results can be saved. Returns false on a read error.
+[[nodiscard]] auto forward_stream(int in_fd, int out_fd, InputBuffer& input,
+                                  const InputCallback& on_input = {}) -> bool;
+
+// Same contract, but input is filled and on_input runs on a worker thread;
+// input must not be touched elsewhere until this returns. The calling thread
+// only forwards and hands blocks over through a lock-free ring, so slow
+// parsing never holds back the producer.
+[[nodiscard]] auto forward_stream_pipelined(int in_fd, int out_fd, InputBuffer& input,
+                                            const InputCallback& on_input = {}) -> bool;
+
+} // namespace tdd_guard
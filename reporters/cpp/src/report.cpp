@@ -0,0 +1,146 @@
+#include "report.hpp"
+#include "stats.hpp"
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tdd_guard {
+
+namespace {
+
+auto is_json_syntax(const LineInfo& info) -> bool {
+    if (!info.has_first) return false;
+    const char first = info.first;
+    return first == '{' || first == '}' || first == '[' || first == ']' || first == '"';
+}
+
+} // anonymous namespace
+
+ReportBuilder::ReportBuilder(const InputBuffer& input, unsigned threads)
+    : input_(input), errors_(input), threads_(threads) {}
+
+ReportBuilder::ReportBuilder(const InputBuffer& output, const InputBuffer& errors, unsigned threads)
+    : input_(output), errors_(errors), threads_(threads) {}
+
+auto ReportBuilder::update() -> void {
+    parse_lines(input_.complete_line_count());
+    if (separate_errors()) {
+        parse_error_lines(errors_.complete_line_count());
+    }
+}
+
+auto ReportBuilder::separate_errors() const -> bool {
+    return &errors_ != &input_;
+}
+
+// Merged output can hold the report among the diagnostics
+auto ReportBuilder::is_diagnostic_source(const LineInfo& info) const -> bool {
+    return separate_errors() || !is_json_syntax(info);
+}
+
+// The two parsers do not depend on each other, so each takes the whole
+// batch in turn and is timed once per batch rather than once per line
+auto ReportBuilder::parse_lines(std::size_t end) -> void {
+    {
+        TDD_GUARD_TIME_PHASE(ParseJson);
+        for (auto i = next_line_; i < end; ++i) {
+            parser_.feed_line(input_.line(i));
+        }
+    }
+    next_line_ = end;
+    if (!separate_errors()) {
+        parse_error_lines(end);
+    }
+}
+
+auto ReportBuilder::parse_error_lines(std::size_t end) -> void {
+    TDD_GUARD_TIME_PHASE(ParseErrors);
+    // Until an error is open, only lines with an error marker, or with
+    // color codes that may split one, need parsing. One search over the
+    // rest of the batch finds the next marker, so a clean run costs a
+    // single scan of its bytes.
+    const auto content = errors_.content();
+    const auto offset_of = [&](std::string_view line) {
+        return static_cast<std::size_t>(line.data() - content.data());
+    };
+    const auto batch_end = end > next_error_line_
+                               ? offset_of(errors_.line(end - 1)) + errors_.line(end - 1).size()
+                               : std::size_t{0};
+    std::optional<std::size_t> marker;
+    for (auto i = next_error_line_; i < end; ++i) {
+        const auto info = errors_.line_info(i);
+        if (!is_diagnostic_source(info)) {
+            continue;
+        }
+        const auto line = errors_.line(i);
+        if (!error_parser_.has_open_error() && !info.has_escape) {
+            const auto start = offset_of(line);
+            if (!marker || *marker < start) {
+                const auto found = find_error_marker(content.substr(start, batch_end - start));
+                marker = found == std::string_view::npos ? batch_end : start + found;
+            }
+            if (*marker >= start + line.size()) {
+                continue;
+            }
+        }
+        error_parser_.add_line(line, info.has_escape);
+    }
+    next_error_line_ = end;
+}
+
+auto ReportBuilder::finish() -> TddGuardOutput {
+    parse_lines(input_.line_count());
+    if (separate_errors()) {
+        parse_error_lines(errors_.line_count());
+    }
+
+    bool parsed = false;
+    {
+        TDD_GUARD_TIME_PHASE(ParseJson);
+        parsed = parser_.finish(input_.content());
+    }
+
+    std::vector<CompilationError> compilation_errors;
+    {
+        TDD_GUARD_TIME_PHASE(ParseErrors);
+        compilation_errors = error_parser_.finish();
+        if (error_parser_.needs_fallback()) {
+            std::vector<std::string_view> stderr_lines;
+            for (std::size_t i = 0; i < errors_.line_count(); ++i) {
+                if (is_diagnostic_source(errors_.line_info(i))) {
+                    stderr_lines.push_back(errors_.line(i));
+                }
+            }
+            compilation_errors.push_back(fallback_error(stderr_lines));
+        }
+    }
+
+    std::vector<TestEvent> events;
+    if (parsed || parser_.truncated()) {
+        events = parser_.take_events();
+    }
+
+    if (!parsed && parser_.truncated()) {
+        compilation_errors.push_back(CompilationError{
+            .message = "Incomplete test output",
+            .note = "The JSON report ended early, possibly because the test binary crashed; "
+                    "tests that finished are reported"
+        });
+    } else if (!parsed && compilation_errors.empty() && !(input_.empty() && errors_.empty())) {
+        compilation_errors.push_back(CompilationError{
+            .message = "Failed to parse test output",
+            .note = "No JSON test output detected"
+        });
+    }
+
+    TDD_GUARD_TIME_PHASE(Transform);
+    return transform_events(std::move(events), compilation_errors, threads_);
+}
+
+auto build_report(const InputBuffer& input) -> TddGuardOutput {
+    ReportBuilder builder(input);
+    return builder.finish();
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "error_parser.hpp"
+#include "input_buffer.hpp"
+#include "parser.hpp"
+#include "transformer.hpp"
+#include <cstddef>
+
+namespace tdd_guard {
+
+// Parses test results and compiler diagnostics out of the input while it is
+// still arriving, so only the final line and the transform remain once the
+// input ends. Everything works on views into the input buffer; nothing is
+// copied per line.
+class ReportBuilder {
+public:
+    // threads bounds the workers used to group very large result sets
+    explicit ReportBuilder(const InputBuffer& input, unsigned threads = 1);
+    // For stdout and stderr captured apart: the report is read from output
+    // alone and diagnostics from errors alone, so no line is classified
+    ReportBuilder(const InputBuffer& output, const InputBuffer& errors, unsigned threads = 1);
+
+    // Parses every line completed since the last call
+    auto update() -> void;
+
+    [[nodiscard]] auto finish() -> TddGuardOutput;
+
+private:
+    const InputBuffer& input_;
+    // Where diagnostics are read from; input_ itself unless captured apart
+    const InputBuffer& errors_;
+    unsigned threads_;
+    std::size_t next_line_ = 0;
+    std::size_t next_error_line_ = 0;
+    Parser parser_;
+    ErrorParser error_parser_;
+
+    [[nodiscard]] auto separate_errors() const -> bool;
+    [[nodiscard]] auto is_diagnostic_source(const LineInfo& info) const -> bool;
+    auto parse_lines(std::size_t end) -> void;
+    auto parse_error_lines(std::size_t end) -> void;
+};
+
+[[nodiscard]] auto build_report(const InputBuffer& input) -> TddGuardOutput;
+
+} // namespace tdd_guard
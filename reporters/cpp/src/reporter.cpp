@@ -0,0 +1,202 @@
+#include "reporter.hpp"
+#include "file_io.hpp"
+#include "input_buffer.hpp"
+#include "json_writer.hpp"
+#include "passthrough.hpp"
+#include "report.hpp"
+#include "runner.hpp"
+#include "stats.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <initializer_list>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace tdd_guard {
+
+namespace {
+
+// How a command that could not be started ends, as a shell reports it
+constexpr int NOT_STARTED_EXIT = 127;
+
+// Prints the phase timings and saves them beside the results as stats.json,
+// replacing it like test.json
+auto report_stats(int results_fd, std::initializer_list<const InputBuffer*> inputs,
+                  const TddGuardOutput& output, std::ostream& err) -> void {
+    auto stats = collect_stats();
+    for (const auto* input : inputs) {
+        stats.bytes += input->content().size();
+        stats.lines += input->line_count();
+    }
+    for (const auto& module : output.test_modules) {
+        stats.tests += module.tests.size();
+    }
+    print_stats(err, stats);
+
+    const bool saved = replace_file_with(results_fd, "stats.json", [&stats](int fd) {
+        JsonWriter writer(fd);
+        write_stats_json(writer, stats);
+        return writer.flush();
+    });
+    if (!saved) {
+        err << "Error saving stats.json: " << std::strerror(errno) << "\n";
+    }
+}
+
+} // anonymous namespace
+
+auto validate_project_root(std::string_view root, std::ostream& err) -> std::optional<fs::path> {
+    if (root.empty()) {
+        err << "Error: --project-root is required\n";
+        return std::nullopt;
+    }
+
+    fs::path project_root(root);
+
+    if (!project_root.is_absolute()) {
+        err << "Error: project-root must be an absolute path\n";
+        return std::nullopt;
+    }
+
+    std::error_code ec;
+    if (!fs::exists(project_root, ec)) {
+        err << "Error: project-root does not exist: " << project_root.string() << "\n";
+        return std::nullopt;
+    }
+
+    auto validated_root = fs::canonical(project_root, ec);
+    if (ec) {
+        err << "Error: cannot resolve project-root: " << ec.message() << "\n";
+        return std::nullopt;
+    }
+    return validated_root;
+}
+
+auto open_results_dir(const fs::path& project_root, std::ostream& err) -> int {
+    const auto output_dir = project_root / ".claude" / "tdd-guard" / "data";
+
+    std::error_code ec;
+    fs::create_directories(output_dir, ec);
+    if (ec) {
+        err << "Error creating directory: " << ec.message() << "\n";
+        return -1;
+    }
+
+    const int fd = ::open(output_dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        err << "Error opening directory: " << std::strerror(errno) << "\n";
+    }
+    return fd;
+}
+
+auto open_results_subdir(int results_fd, const char* name, std::ostream& err) -> int {
+    if (::mkdirat(results_fd, name, 0777) != 0 && errno != EEXIST) {
+        err << "Error creating " << name << " directory: " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    const int fd = ::openat(results_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        err << "Error opening " << name << " directory: " << std::strerror(errno) << "\n";
+    }
+    return fd;
+}
+
+auto save_output(int dir_fd, const std::string& name, const TddGuardOutput& output, std::ostream& err) -> bool {
+    TDD_GUARD_TIME_PHASE(Save);
+    const bool saved = replace_file_with(dir_fd, name, [&output](int fd) {
+        TDD_GUARD_TIME_PHASE(Serialize);
+        JsonWriter writer(fd);
+        output.write_json(writer);
+        return writer.flush();
+    });
+    if (!saved) {
+        err << "Error saving " << name << ": " << std::strerror(errno) << "\n";
+    }
+    return saved;
+}
+
+auto save_results(int results_fd, const TddGuardOutput& output, std::ostream& err) -> bool {
+    return save_output(results_fd, "test.json", output, err);
+}
+
+auto run_passthrough(int results_fd, int in_fd, int out_fd, const PassthroughOptions& options,
+                     std::ostream& err) -> int {
+    // A closed stdout must not kill the reporter before results are saved
+    std::signal(SIGPIPE, SIG_IGN);
+
+    InputBuffer input;
+    ReportBuilder report(input, options.single_threaded ? 1 : std::thread::hardware_concurrency());
+    const auto forward = options.single_threaded ? forward_stream : forward_stream_pipelined;
+    bool forwarded = false;
+    {
+        TDD_GUARD_TIME_PHASE(Forward);
+        forwarded = forward(in_fd, out_fd, input, [&] { report.update(); });
+    }
+    if (!forwarded) {
+        err << "Error reading test output: " << std::strerror(errno) << "\n";
+    }
+
+    auto output = report.finish();
+
+    if (results_fd < 0 || !save_results(results_fd, output, err)) {
+        return 1;
+    }
+
+    if (stats_enabled()) {
+        report_stats(results_fd, {&input}, output, err);
+    }
+
+    return 0;
+}
+
+auto run_command(int results_fd, std::span<char* const> argv, int out_fd, int err_fd,
+                 const PassthroughOptions& options, std::ostream& err) -> int {
+    std::signal(SIGPIPE, SIG_IGN);
+
+    InputBuffer output;
+    InputBuffer errors;
+    ReportBuilder report(output, errors, options.single_threaded ? 1 : std::thread::hardware_concurrency());
+    std::optional<ProcessExit> exit;
+    std::ostringstream child_errors;
+    {
+        TDD_GUARD_TIME_PHASE(Forward);
+        IgnoreInterrupts ignore_interrupts;
+        exit = run_child(argv, out_fd, err_fd, output, errors, [&] { report.update(); }, child_errors);
+    }
+    err << child_errors.str();
+    if (!exit) {
+        // Replaces the previous run's results, which would otherwise stand
+        // for this one
+        auto reason = child_errors.str();
+        while (!reason.empty() && reason.back() == '\n') {
+            reason.pop_back();
+        }
+        auto result = transform_events({}, {CompilationError{.message = "Test command not started", .note = reason}});
+        record_process_exit(result, ProcessExit{.exit_code = NOT_STARTED_EXIT});
+        if (results_fd >= 0) {
+            (void)save_results(results_fd, result, err);
+        }
+        return NOT_STARTED_EXIT;
+    }
+
+    auto result = report.finish();
+    record_process_exit(result, *exit);
+
+    if (results_fd < 0 || !save_results(results_fd, result, err)) {
+        return 1;
+    }
+
+    if (stats_enabled()) {
+        report_stats(results_fd, {&output, &errors}, result, err);
+    }
+
+    return exit_status(*exit);
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "transformer.hpp"
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace tdd_guard {
+
+struct PassthroughOptions {
+    bool single_threaded = false;
+};
+
+// The canonical form of a project root given on the command line, which
+// must be absolute and exist
+[[nodiscard]] auto validate_project_root(std::string_view root, std::ostream& err)
+    -> std::optional<std::filesystem::path>;
+
+// .claude/tdd-guard/data under the project root, created when missing and
+// opened as a directory descriptor. Returns -1 after reporting an error.
+[[nodiscard]] auto open_results_dir(const std::filesystem::path& project_root, std::ostream& err) -> int;
+
+// The directory name inside the results directory, created when missing.
+// Returns -1 after reporting an error.
+[[nodiscard]] auto open_results_subdir(int results_fd, const char* name, std::ostream& err) -> int;
+
+// Writes output as name in dir_fd atomically: through a temp file renamed
+// into place
+[[nodiscard]] auto save_output(int dir_fd, const std::string& name, const TddGuardOutput& output, std::ostream& err)
+    -> bool;
+
+// Saves output as test.json in the results directory
+[[nodiscard]] auto save_results(int results_fd, const TddGuardOutput& output, std::ostream& err) -> bool;
+
+// Forwards in_fd to out_fd, then saves the report built from what passed
+// through. Returns the reporter's exit status; errors go to err. With a
+// results_fd below 0 the input is forwarded and the run fails.
+[[nodiscard]] auto run_passthrough(int results_fd, int in_fd, int out_fd, const PassthroughOptions& options,
+                                   std::ostream& err) -> int;
+
+// Runs the test command in argv with its stdout and stderr forwarded to
+// out_fd and err_fd, then saves the report built from them along with how
+// the command ended. Returns the command's status as a shell reports it,
+// 127 if it could not be started or how it ended is unknown, or 1 if the
+// results were not saved. A command that never ran is still saved, as a
+// failed run with exit code 127, so earlier results do not stand for it.
+[[nodiscard]] auto run_command(int results_fd, std::span<char* const> argv, int out_fd, int err_fd,
+                               const PassthroughOptions& options, std::ostream& err) -> int;
+
+} // namespace tdd_guard
@@ -0,0 +1,350 @@
+#include "result_cache.hpp"
+#include "file_io.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "saved_output.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+
+extern char** environ;
+
+namespace fs = std::filesystem;
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr const char* CACHE_DIR = "cache";
+
+// What a binary's content hash was computed from
+struct BinaryStamp {
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;
+    std::uint64_t hash = 0;
+};
+
+auto stamp_of(const struct stat& st) -> BinaryStamp {
+    return {
+        .device = static_cast<std::uint64_t>(st.st_dev),
+        .inode = static_cast<std::uint64_t>(st.st_ino),
+        .size = static_cast<std::uint64_t>(st.st_size),
+        .mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec,
+        .hash = 0
+    };
+}
+
+auto hex(std::uint64_t value) -> std::string {
+    constexpr std::string_view DIGITS = "0123456789abcdef";
+    std::string text(16, '0');
+    for (auto it = text.rbegin(); it != text.rend(); ++it) {
+        *it = DIGITS[value & 0xF];
+        value >>= 4;
+    }
+    return text;
+}
+
+// The file execvp would run for command
+auto find_binary(const char* command) -> std::optional<std::string> {
+    if (std::strchr(command, '/') != nullptr) {
+        return fs::absolute(command).lexically_normal().string();
+    }
+    const char* path = std::getenv("PATH");
+    std::string_view dirs = path != nullptr ? path : "/usr/bin:/bin";
+    while (true) {
+        const auto end = dirs.find(':');
+        const auto dir = dirs.substr(0, end);
+        auto candidate = (fs::path(dir.empty() ? "." : dir) / command).string();
+        if (::access(candidate.c_str(), X_OK) == 0) {
+            return fs::absolute(candidate).lexically_normal().string();
+        }
+        if (end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        dirs.remove_prefix(end + 1);
+    }
+}
+
+// A lost stamp only costs hashing the binary again, so failures are quiet
+auto save_stamp(int cache_fd, const std::string& name, const BinaryStamp& stamp) -> void {
+    (void)replace_file(cache_fd, name, {reinterpret_cast<const char*>(&stamp), sizeof(stamp)});
+}
+
+auto load_stamp(int cache_fd, const std::string& name) -> std::optional<BinaryStamp> {
+    const auto file = MappedFile::open(cache_fd, name.c_str());
+    if (file.content().size() != sizeof(BinaryStamp)) {
+        return std::nullopt;
+    }
+    BinaryStamp stamp;
+    std::memcpy(&stamp, file.content().data(), sizeof(stamp));
+    return stamp;
+}
+
+auto binary_hash(int cache_fd, const std::string& path) -> std::optional<std::uint64_t> {
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return std::nullopt;
+    }
+    auto stamp = stamp_of(st);
+    const auto name = hex(hash64(path)) + ".stamp";
+    if (const auto saved = load_stamp(cache_fd, name);
+        saved && saved->device == stamp.device && saved->inode == stamp.inode && saved->size == stamp.size &&
+        saved->mtime == stamp.mtime) {
+        return saved->hash;
+    }
+
+    const auto file = MappedFile::open(AT_FDCWD, path.c_str());
+    if (file.content().size() != stamp.size) {
+        return std::nullopt;
+    }
+    stamp.hash = hash64(file.content());
+    save_stamp(cache_fd, name, stamp);
+    return stamp.hash;
+}
+
+// What an ELF binary asks the dynamic loader for
+struct DynamicSection {
+    std::vector<std::string> needed;
+    std::string rpath;
+    std::string runpath;
+};
+
+template<typename T>
+auto read_at(std::string_view file, std::uint64_t offset, T& value) -> bool {
+    if (offset > file.size() || file.size() - offset < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, file.data() + offset, sizeof(T));
+    return true;
+}
+
+// Reads the dynamic section of an ELF file of the host's byte order, with
+// the header, program header and dynamic entry types of its class
+template<typename Header, typename ProgramHeader, typename Dynamic>
+auto read_dynamic_section(std::string_view file) -> std::optional<DynamicSection> {
+    Header header;
+    if (!read_at(file, 0, header) || header.e_phentsize != sizeof(ProgramHeader)) {
+        return std::nullopt;
+    }
+    std::vector<ProgramHeader> loads;
+    std::optional<ProgramHeader> dynamic;
+    for (std::uint64_t i = 0; i < header.e_phnum; ++i) {
+        ProgramHeader segment;
+        if (!read_at(file, header.e_phoff + i * sizeof(ProgramHeader), segment)) {
+            return std::nullopt;
+        }
+        if (segment.p_type == PT_LOAD) {
+            loads.push_back(segment);
+        } else if (segment.p_type == PT_DYNAMIC) {
+            dynamic = segment;
+        }
+    }
+    if (!dynamic) {
+        return std::nullopt;
+    }
+
+    std::uint64_t strtab = 0;
+    std::vector<std::uint64_t> needed;
+    std::optional<std::uint64_t> rpath;
+    std::optional<std::uint64_t> runpath;
+    for (std::uint64_t offset = dynamic->p_offset; offset < dynamic->p_offset + dynamic->p_filesz;
+         offset += sizeof(Dynamic)) {
+        Dynamic entry;
+        if (!read_at(file, offset, entry) || entry.d_tag == DT_NULL) {
+            break;
+        }
+        switch (entry.d_tag) {
+            case DT_NEEDED: needed.push_back(entry.d_un.d_val); break;
+            case DT_STRTAB: strtab = entry.d_un.d_ptr; break;
+            case DT_RPATH: rpath = entry.d_un.d_val; break;
+            case DT_RUNPATH: runpath = entry.d_un.d_val; break;
+            default: break;
+        }
+    }
+
+    // The string table is named by its address once loaded
+    const auto load = std::find_if(loads.begin(), loads.end(), [&](const ProgramHeader& segment) {
+        return strtab >= segment.p_vaddr && strtab - segment.p_vaddr < segment.p_filesz;
+    });
+    if (load == loads.end()) {
+        return std::nullopt;
+    }
+    const auto strings = file.substr(std::min<std::uint64_t>(load->p_offset + (strtab - load->p_vaddr), file.size()));
+    const auto string_at = [&](std::uint64_t offset) {
+        const auto text = strings.substr(std::min<std::uint64_t>(offset, strings.size()));
+        return std::string(text.substr(0, text.find('\0')));
+    };
+
+    DynamicSection section;
+    for (const auto offset : needed) {
+        section.needed.push_back(string_at(offset));
+    }
+    section.rpath = rpath ? string_at(*rpath) : "";
+    section.runpath = runpath ? string_at(*runpath) : "";
+    return section;
+}
+
+auto read_dynamic_section(std::string_view file) -> std::optional<DynamicSection> {
+    constexpr unsigned char HOST_DATA = std::endian::native == std::endian::little ? ELFDATA2LSB : ELFDATA2MSB;
+    if (file.size() < EI_NIDENT || !file.starts_with(ELFMAG) ||
+        static_cast<unsigned char>(file[EI_DATA]) != HOST_DATA) {
+        return std::nullopt;
+    }
+    switch (file[EI_CLASS]) {
+        case ELFCLASS64: return read_dynamic_section<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(file);
+        case ELFCLASS32: return read_dynamic_section<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(file);
+        default: return std::nullopt;
+    }
+}
+
+// Appends the directories of a colon-separated search path, with $ORIGIN
+// standing for origin
+auto add_search_path(std::vector<std::string>& dirs, std::string_view path, const std::string& origin) -> void {
+    while (!path.empty()) {
+        const auto end = path.find(':');
+        std::string dir(path.substr(0, end));
+        path.remove_prefix(end == std::string_view::npos ? path.size() : end + 1);
+        for (const std::string_view variable : {"${ORIGIN}", "$ORIGIN"}) {
+            for (auto at = dir.find(variable); at != std::string::npos; at = dir.find(variable, at + origin.size())) {
+                dir.replace(at, variable.size(), origin);
+            }
+        }
+        if (!dir.empty()) {
+            dirs.push_back(std::move(dir));
+        }
+    }
+}
+
+// The shared libraries of the project the binary at path loads, and the
+// ones they load in turn: those the loader finds through an RPATH, RUNPATH
+// or LD_LIBRARY_PATH. Libraries found only in the system directories are
+// left out, like the system's other files.
+auto project_libraries(const std::string& path) -> std::vector<std::string> {
+    const char* library_path = std::getenv("LD_LIBRARY_PATH");
+    std::vector<std::string> libraries;
+    std::unordered_set<std::string> seen = {path};
+    std::vector<std::string> pending = {path};
+    while (!pending.empty()) {
+        const auto object = std::move(pending.back());
+        pending.pop_back();
+        const auto file = MappedFile::open(AT_FDCWD, object.c_str());
+        const auto section = read_dynamic_section(file.content());
+        if (!section) {
+            continue;
+        }
+
+        // The order the loader searches in; a RUNPATH turns the RPATH off
+        const auto origin = fs::path(object).parent_path().string();
+        std::vector<std::string> dirs;
+        if (section->runpath.empty()) {
+            add_search_path(dirs, section->rpath, origin);
+        }
+        add_search_path(dirs, library_path != nullptr ? library_path : "", origin);
+        add_search_path(dirs, section->runpath, origin);
+
+        for (const auto& name : section->needed) {
+            for (const auto& dir : dirs) {
+                auto candidate = fs::absolute(fs::path(dir) / name).lexically_normal().string();
+                struct stat st {};
+                if (::stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                    if (seen.insert(candidate).second) {
+                        libraries.push_back(candidate);
+                        pending.push_back(std::move(candidate));
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    return libraries;
+}
+
+} // anonymous namespace
+
+auto run_key(int cache_fd, std::span<char* const> argv, std::span<const std::string> env)
+    -> std::optional<std::uint64_t> {
+    if (argv.empty()) {
+        return std::nullopt;
+    }
+    const auto binary = find_binary(argv[0]);
+    if (!binary) {
+        return std::nullopt;
+    }
+    const auto content = binary_hash(cache_fd, *binary);
+    if (!content) {
+        return std::nullopt;
+    }
+
+    // Each part ends with a NUL so no two command lines read the same
+    std::string key(reinterpret_cast<const char*>(&*content), sizeof(*content));
+    for (const auto& library : project_libraries(*binary)) {
+        const auto library_content = binary_hash(cache_fd, library);
+        if (!library_content) {
+            return std::nullopt;
+        }
+        key += library;
+        key += '\0';
+        key.append(reinterpret_cast<const char*>(&*library_content), sizeof(*library_content));
+    }
+    key += '\0';
+    for (const auto* arg : argv.subspan(1)) {
+        key += arg;
+        key += '\0';
+    }
+    key += '\0';
+    std::vector<std::string_view> variables;
+    for (char** entry = environ; *entry != nullptr; ++entry) {
+        const std::string_view variable = *entry;
+        const auto name = variable.substr(0, variable.find('='));
+        if (name.starts_with("GTEST_") || std::find(env.begin(), env.end(), name) != env.end()) {
+            variables.push_back(variable);
+        }
+    }
+    std::sort(variables.begin(), variables.end());
+    for (const auto variable : variables) {
+        key += variable;
+        key += '\0';
+    }
+    return hash64(key);
+}
+
+auto run_cached(int results_fd, std::span<char* const> argv, int out_fd, int err_fd,
+                const PassthroughOptions& options, const CacheOptions& cache, std::ostream& err) -> int {
+    const int cache_fd = results_fd >= 0 ? open_results_subdir(results_fd, CACHE_DIR, err) : -1;
+    if (cache_fd < 0) {
+        return run_command(results_fd, argv, out_fd, err_fd, options, err);
+    }
+
+    const auto key = run_key(cache_fd, argv, cache.env);
+    const auto name = key ? hex(*key) + ".json" : std::string();
+    if (key && !cache.rerun) {
+        const auto file = MappedFile::open(cache_fd, name.c_str());
+        if (const auto cached = parse_saved_output(file.content())) {
+            ::close(cache_fd);
+            err << "tdd-guard-cpp: reused the results of an identical passing run; use --rerun to run the tests\n";
+            return save_results(results_fd, *cached, err) ? 0 : 1;
+        }
+    }
+
+    const int status = run_command(results_fd, argv, out_fd, err_fd, options, err);
+    if (key && status == 0) {
+        const auto saved = MappedFile::open(results_fd, "test.json");
+        if (const auto output = parse_saved_output(saved.content()); output && output->reason == "passed") {
+            (void)save_output(cache_fd, name, *output, err);
+        }
+    }
+    ::close(cache_fd);
+    return status;
+}
+
+} // namespace tdd_guard
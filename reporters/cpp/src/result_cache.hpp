@@ -0,0 +1,40 @@
+#pragma once
+
+#include "reporter.hpp"
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace tdd_guard {
+
+struct CacheOptions {
+    // Runs the command even when a cached report matches, and caches the
+    // new report in its place
+    bool rerun = false;
+    // Environment variables that change what the tests do, besides the
+    // GTEST_ ones that always count
+    std::vector<std::string> env;
+};
+
+// Identifies a run of argv by hashing the content of the binary in argv[0],
+// looked up in PATH as the shell would, and of the shared libraries it
+// loads from the project's build, the rest of argv, and the environment
+// variables named in env or starting with GTEST_. A library counts when the
+// binary's RPATH or RUNPATH, or LD_LIBRARY_PATH, leads to it. Each content
+// hash is remembered in cache_fd along with the file's size, mtime and
+// inode, and read back while those still match, so an unchanged file is
+// not hashed again. Empty when a file cannot be found or read.
+[[nodiscard]] auto run_key(int cache_fd, std::span<char* const> argv, std::span<const std::string> env)
+    -> std::optional<std::uint64_t>;
+
+// Runs argv as run_command does, unless a run with the same key passed
+// before: then the report of that run is saved again and nothing is
+// executed. Reports of runs that exited with 0 and passed are cached under
+// .claude/tdd-guard/data/cache.
+[[nodiscard]] auto run_cached(int results_fd, std::span<char* const> argv, int out_fd, int err_fd,
+                              const PassthroughOptions& options, const CacheOptions& cache, std::ostream& err) -> int;
+
+} // namespace tdd_guard
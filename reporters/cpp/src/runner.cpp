@@ -0,0 +1,220 @@
+#include "runner.hpp"
+#include "file_io.hpp"
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+struct Pipe {
+    int read_fd = -1;
+    int write_fd = -1;
+};
+
+// Neither end is inherited as it is; the child gets the write end through
+// a dup2 onto its stdout or stderr. On Linux the ends are close-on-exec
+// from the start, so children spawned by other threads never hold them.
+auto open_pipe() -> std::optional<Pipe> {
+    int fds[2];
+#ifdef __linux__
+    if (::pipe2(fds, O_CLOEXEC) != 0) {
+        return std::nullopt;
+    }
+#else
+    if (::pipe(fds) != 0) {
+        return std::nullopt;
+    }
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+    return Pipe{.read_fd = fds[0], .write_fd = fds[1]};
+}
+
+auto close_fd(int& fd) -> void {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// One output stream of the child, from its pipe to our descriptor
+struct Stream {
+    int in_fd;
+    int out_fd;
+    InputBuffer& buffer;
+    bool forwarding = true;
+};
+
+// Reads what is available into the buffer and forwards it. False at the
+// end of the stream; a read error ends it too.
+auto pump(Stream& stream) -> bool {
+    auto space = stream.buffer.prepare(BLOCK_SIZE);
+    ssize_t count = 0;
+    do {
+        count = ::read(stream.in_fd, space.data(), space.size());
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(count);
+    if (stream.forwarding) {
+        stream.forwarding = write_all(stream.out_fd, {space.data(), size});
+    }
+    stream.buffer.commit(size);
+    return true;
+}
+
+auto spawn(std::span<char* const> argv, const Pipe& out, const Pipe& errors, pid_t& pid) -> int {
+    std::vector<char*> args(argv.begin(), argv.end());
+    args.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out.write_fd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, errors.write_fd, STDERR_FILENO);
+
+    // SIGPIPE is ignored by the reporter itself
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t defaults;
+    ::sigemptyset(&defaults);
+    ::sigaddset(&defaults, SIGPIPE);
+    ::sigaddset(&defaults, SIGINT);
+    ::sigaddset(&defaults, SIGQUIT);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF);
+
+    const int error = ::posix_spawnp(&pid, args[0], &actions, &attributes, args.data(), environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    return error;
+}
+
+// Empty when the child's status cannot be collected
+auto wait_for(pid_t pid) -> std::optional<ProcessExit> {
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return std::nullopt;
+        }
+    }
+    if (WIFSIGNALED(status)) {
+        return ProcessExit{.signal = WTERMSIG(status)};
+    }
+    return ProcessExit{.exit_code = WEXITSTATUS(status)};
+}
+
+} // anonymous namespace
+
+auto run_child(std::span<char* const> argv, int out_fd, int err_fd, InputBuffer& output, InputBuffer& errors,
+               const InputCallback& on_input, std::ostream& err) -> std::optional<ProcessExit> {
+    if (argv.empty()) {
+        err << "Error: no test command given after --\n";
+        return std::nullopt;
+    }
+
+    auto out_pipe = open_pipe();
+    auto err_pipe = open_pipe();
+    if (!out_pipe || !err_pipe) {
+        err << "Error creating pipes: " << std::strerror(errno) << "\n";
+        for (auto* pipe : {&out_pipe, &err_pipe}) {
+            if (*pipe) {
+                close_fd((*pipe)->read_fd);
+                close_fd((*pipe)->write_fd);
+            }
+        }
+        return std::nullopt;
+    }
+
+    pid_t pid = 0;
+    const int spawn_error = spawn(argv, *out_pipe, *err_pipe, pid);
+    // Only the child may hold the write ends, so its exit ends the streams
+    close_fd(out_pipe->write_fd);
+    close_fd(err_pipe->write_fd);
+    if (spawn_error != 0) {
+        err << "Error starting " << argv[0] << ": " << std::strerror(spawn_error) << "\n";
+        close_fd(out_pipe->read_fd);
+        close_fd(err_pipe->read_fd);
+        return std::nullopt;
+    }
+
+    std::array streams = {
+        Stream{.in_fd = out_pipe->read_fd, .out_fd = out_fd, .buffer = output, .forwarding = out_fd >= 0},
+        Stream{.in_fd = err_pipe->read_fd, .out_fd = err_fd, .buffer = errors, .forwarding = err_fd >= 0}
+    };
+    std::array<pollfd, 2> polled{};
+    std::array<Stream*, 2> polled_streams{};
+    for (;;) {
+        nfds_t count = 0;
+        for (auto& stream : streams) {
+            if (stream.in_fd >= 0) {
+                polled[count] = pollfd{.fd = stream.in_fd, .events = POLLIN, .revents = 0};
+                polled_streams[count++] = &stream;
+            }
+        }
+        if (count == 0) {
+            break;
+        }
+        if (::poll(polled.data(), count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (nfds_t i = 0; i < count; ++i) {
+            if (polled[i].revents != 0 && !pump(*polled_streams[i])) {
+                close_fd(polled_streams[i]->in_fd);
+            }
+        }
+        if (on_input) {
+            on_input();
+        }
+    }
+
+    // After a poll failure the child sees the closed pipes as EPIPE
+    for (auto& stream : streams) {
+        close_fd(stream.in_fd);
+    }
+    const auto exit = wait_for(pid);
+    if (!exit) {
+        err << "Error waiting for " << argv[0] << ": " << std::strerror(errno) << "\n";
+    }
+    return exit;
+}
+
+IgnoreInterrupts::IgnoreInterrupts() {
+    struct sigaction ignore {};
+    ignore.sa_handler = SIG_IGN;
+    ::sigemptyset(&ignore.sa_mask);
+    ::sigaction(SIGINT, &ignore, &interrupt_);
+    ::sigaction(SIGQUIT, &ignore, &quit_);
+}
+
+IgnoreInterrupts::~IgnoreInterrupts() {
+    ::sigaction(SIGINT, &interrupt_, nullptr);
+    ::sigaction(SIGQUIT, &quit_, nullptr);
+}
+
+auto exit_status(const ProcessExit& exit) -> int {
+    if (exit.signal.has_value()) {
+        return 128 + *exit.signal;
+    }
+    return exit.exit_code.value_or(1);
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "input_buffer.hpp"
+#include "passthrough.hpp"
+#include "transformer.hpp"
+#include <csignal>
+#include <optional>
+#include <ostream>
+#include <span>
+
+namespace tdd_guard {
+
+// Starts argv[0], searched in PATH, with its stdout and stderr on separate
+// pipes and stdin inherited. Both are forwarded byte for byte to out_fd and
+// err_fd from one poll loop and captured into output and errors, with
+// on_input called after each read. A descriptor below 0, or one that stops
+// accepting data, is not forwarded to; its stream is still drained. Safe to
+// call from several threads at once. Returns how the child ended, or
+// nullopt after reporting to err that it could not be started or that how
+// it ended could not be collected.
+[[nodiscard]] auto run_child(std::span<char* const> argv, int out_fd, int err_fd, InputBuffer& output,
+                             InputBuffer& errors, const InputCallback& on_input, std::ostream& err)
+    -> std::optional<ProcessExit>;
+
+// Like system(), the reporter ignores the terminal's interrupt and quit
+// while its children run, so the results of a run stopped with Ctrl-C are
+// still saved. Children get the default dispositions back.
+class IgnoreInterrupts {
+public:
+    IgnoreInterrupts();
+    ~IgnoreInterrupts();
+    IgnoreInterrupts(const IgnoreInterrupts&) = delete;
+    auto operator=(const IgnoreInterrupts&) -> IgnoreInterrupts& = delete;
+
+private:
+    struct sigaction interrupt_ {};
+    struct sigaction quit_ {};
+};
+
+// The status a shell reports for a child that ended this way
+[[nodiscard]] auto exit_status(const ProcessExit& exit) -> int;
+
+} // namespace tdd_guard
@@ -0,0 +1,267 @@
+#include "saved_output.hpp"
+#include "json_stream.hpp"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace tdd_guard {
+
+namespace {
+
+// Accepts only the layout write_json produces; anything else stops the
+// stream, so a damaged file is never taken for results
+class OutputReader final : public JsonHandler {
+public:
+    explicit OutputReader(TddGuardOutput& output) : output_(output) {}
+
+    auto null() -> bool override {
+        return current() == Frame::Skip;
+    }
+    auto boolean(bool /*value*/) -> bool override {
+        return current() == Frame::Skip;
+    }
+    auto number_integer(std::int64_t value) -> bool override {
+        return number(static_cast<double>(value));
+    }
+    auto number_unsigned(std::uint64_t value) -> bool override {
+        return number(static_cast<double>(value));
+    }
+    auto number_float(double value, const std::string& /*text*/) -> bool override {
+        return number(value);
+    }
+
+    auto string(std::string& value) -> bool override {
+        switch (current()) {
+            case Frame::Document:
+                if (key_ == Key::Reason) {
+                    output_.reason = std::move(value);
+                    return true;
+                }
+                return false;
+            case Frame::Module:
+                if (key_ == Key::ModuleId) {
+                    output_.test_modules.back().module_id = std::move(value);
+                    return true;
+                }
+                return false;
+            case Frame::Test:
+                return test_string(value);
+            case Frame::Error:
+                return error_string(value);
+            case Frame::Skip:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    auto start_object(std::size_t /*elements*/) -> bool override {
+        if (!started_) {
+            started_ = true;
+            frames_.push_back(Frame::Document);
+            return true;
+        }
+        switch (current()) {
+            case Frame::Document:
+                if (key_ == Key::Process) {
+                    output_.process = ProcessExit{};
+                    frames_.push_back(Frame::Process);
+                } else if (key_ == Key::Timing) {
+                    frames_.push_back(Frame::Skip);
+                } else {
+                    return false;
+                }
+                return true;
+            case Frame::Modules:
+                output_.test_modules.emplace_back();
+                frames_.push_back(Frame::Module);
+                return true;
+            case Frame::Tests:
+                output_.test_modules.back().tests.emplace_back();
+                frames_.push_back(Frame::Test);
+                return true;
+            case Frame::Errors:
+                output_.test_modules.back().tests.back().errors.emplace_back();
+                frames_.push_back(Frame::Error);
+                return true;
+            case Frame::Skip:
+                frames_.push_back(Frame::Skip);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    auto key(std::string& name) -> bool override {
+        key_ = key_for(current(), name);
+        return key_ != Key::Unknown || current() == Frame::Skip;
+    }
+
+    auto end_object() -> bool override {
+        frames_.pop_back();
+        return true;
+    }
+
+    auto start_array(std::size_t /*elements*/) -> bool override {
+        if (current() == Frame::Document && key_ == Key::TestModules) {
+            frames_.push_back(Frame::Modules);
+        } else if (current() == Frame::Module && key_ == Key::Tests) {
+            frames_.push_back(Frame::Tests);
+        } else if (current() == Frame::Test && key_ == Key::Errors) {
+            frames_.push_back(Frame::Errors);
+        } else if (current() == Frame::Skip) {
+            frames_.push_back(Frame::Skip);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    auto end_array() -> bool override {
+        frames_.pop_back();
+        return true;
+    }
+
+private:
+    enum class Frame { Document, Process, Modules, Module, Tests, Test, Errors, Error, Skip };
+    enum class Key {
+        Unknown, Process, Reason, TestModules, Timing, ExitCode, Signal, ModuleId, Tests,
+        Duration, Errors, FullName, Name, State,
+        Actual, Code, Expected, Help, Location, Message, Note
+    };
+
+    TddGuardOutput& output_;
+    std::vector<Frame> frames_;
+    Key key_ = Key::Unknown;
+    bool started_ = false;
+
+    [[nodiscard]] auto current() const -> Frame {
+        return frames_.empty() ? Frame::Document : frames_.back();
+    }
+
+    static auto key_for(Frame frame, std::string_view name) -> Key {
+        switch (frame) {
+            case Frame::Document:
+                return name == "process"     ? Key::Process
+                     : name == "reason"      ? Key::Reason
+                     : name == "testModules" ? Key::TestModules
+                     : name == "timing"      ? Key::Timing
+                                             : Key::Unknown;
+            case Frame::Process:
+                return name == "exitCode" ? Key::ExitCode : name == "signal" ? Key::Signal : Key::Unknown;
+            case Frame::Module:
+                return name == "moduleId" ? Key::ModuleId : name == "tests" ? Key::Tests : Key::Unknown;
+            case Frame::Test:
+                return name == "duration" ? Key::Duration
+                     : name == "errors"   ? Key::Errors
+                     : name == "fullName" ? Key::FullName
+                     : name == "name"     ? Key::Name
+                     : name == "state"    ? Key::State
+                                          : Key::Unknown;
+            case Frame::Error:
+                return name == "actual"   ? Key::Actual
+                     : name == "code"     ? Key::Code
+                     : name == "expected" ? Key::Expected
+                     : name == "help"     ? Key::Help
+                     : name == "location" ? Key::Location
+                     : name == "message"  ? Key::Message
+                     : name == "note"     ? Key::Note
+                                          : Key::Unknown;
+            default:
+                return Key::Unknown;
+        }
+    }
+
+    auto test_string(std::string& value) -> bool {
+        auto& test = output_.test_modules.back().tests.back();
+        switch (key_) {
+            case Key::FullName:
+                test.full_name = std::move(value);
+                return true;
+            case Key::Name:
+                test.name = std::move(value);
+                return true;
+            case Key::State:
+                if (const auto state = parse_state(value)) {
+                    test.state = *state;
+                    return true;
+                }
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    auto error_string(std::string& value) -> bool {
+        auto& error = output_.test_modules.back().tests.back().errors.back();
+        switch (key_) {
+            case Key::Message:
+                error.message = std::move(value);
+                return true;
+            case Key::Actual:
+                error.actual = std::move(value);
+                return true;
+            case Key::Code:
+                error.code = std::move(value);
+                return true;
+            case Key::Expected:
+                error.expected = std::move(value);
+                return true;
+            case Key::Help:
+                error.help = std::move(value);
+                return true;
+            case Key::Location:
+                error.location = std::move(value);
+                return true;
+            case Key::Note:
+                error.note = std::move(value);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Durations are saved in milliseconds, exit codes and signals as
+    // unsigned integers
+    auto number(double value) -> bool {
+        if (current() == Frame::Skip) {
+            return true;
+        }
+        if (value < 0) {
+            return false;
+        }
+        if (current() == Frame::Test && key_ == Key::Duration) {
+            output_.test_modules.back().tests.back().duration =
+                std::chrono::microseconds(std::llround(value * 1000));
+            return true;
+        }
+        if (current() == Frame::Process && value <= std::numeric_limits<int>::max()) {
+            if (key_ == Key::ExitCode) {
+                output_.process->exit_code = static_cast<int>(value);
+                return true;
+            }
+            if (key_ == Key::Signal) {
+                output_.process->signal = static_cast<int>(value);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // anonymous namespace
+
+auto parse_saved_output(std::string_view json) -> std::optional<TddGuardOutput> {
+    TddGuardOutput output;
+    OutputReader reader(output);
+    JsonStream stream(reader);
+    stream.feed(json);
+    if (!stream.complete()) {
+        return std::nullopt;
+    }
+    output.timing = summarize_durations(output.test_modules, SLOWEST_TEST_COUNT);
+    return output;
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "transformer.hpp"
+#include <optional>
+#include <string_view>
+
+namespace tdd_guard {
+
+// Reads back a document TddGuardOutput::write_json wrote, with JsonStream
+// rather than a DOM. The timing summary is derived from the tests, so it is
+// summarized afresh instead of read. Empty when json is incomplete or not
+// such a document.
+[[nodiscard]] auto parse_saved_output(std::string_view json) -> std::optional<TddGuardOutput>;
+
+} // namespace tdd_guard
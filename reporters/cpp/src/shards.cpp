@@ -0,0 +1,627 @@
+#include "shards.hpp"
+#include "error_parser.hpp"
+#include "file_io.hpp"
+#include "input_buffer.hpp"
+#include "report.hpp"
+#include "reporter.hpp"
+#include "runner.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace tdd_guard {
+
+namespace {
+
+// Enough batches that a worker finishing early still finds work
+constexpr std::size_t BATCHES_PER_JOB = 3;
+// Keeps a batch's --gtest_filter well below the 128 KiB Linux allows for a
+// single argument
+constexpr std::size_t MAX_FILTER_BYTES = 64 * 1024;
+// How a batch that could not be started counts, as a shell reports a
+// command it cannot run
+constexpr int NOT_STARTED_EXIT = 127;
+// Expected time of each test when the history knows none of them
+constexpr auto DEFAULT_TEST_TIME = std::chrono::milliseconds(1);
+// Catch2 options whose value is the next argument
+constexpr std::array<std::string_view, 27> CATCH2_VALUE_OPTIONS = {
+    "-o", "--out", "-r", "--reporter", "-x", "--abort-x", "-w", "--warn", "-d", "--durations",
+    "-D", "--min-duration", "-f", "--input-file", "-c", "--section", "-v", "--verbosity", "--order",
+    "--rng-seed", "--colour-mode", "--benchmark-samples", "--benchmark-resamples",
+    "--benchmark-confidence-interval", "--benchmark-warmup-time", "--shard-count", "--shard-index",
+};
+
+struct Listing {
+    Framework framework = Framework::Unknown;
+    std::vector<std::string> tests;
+    // Whether batches can narrow the command line's own selection to the
+    // tests they name
+    bool splittable = true;
+};
+
+// A batch of tests and, once it has run, what it reported
+struct Batch {
+    std::vector<std::size_t> tests;
+    std::optional<ProcessExit> exit;
+    std::vector<TestEvent> events;
+    std::vector<CompilationError> errors;
+};
+
+auto trim(std::string_view text) -> std::string_view {
+    const auto start = text.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    const auto end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// Drops the "  # TypeParam = ..." comments of typed and parameterized tests
+auto without_comment(std::string_view line) -> std::string_view {
+    return trim(line.substr(0, line.find("  #")));
+}
+
+template<typename Visit>
+auto for_each_line(std::string_view text, Visit visit) -> void {
+    while (!text.empty()) {
+        const auto end = text.find('\n');
+        visit(text.substr(0, end));
+        if (end == std::string_view::npos) {
+            break;
+        }
+        text.remove_prefix(end + 1);
+    }
+}
+
+auto read_file(const fs::path& path) -> std::string {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// Runs argv without forwarding anything and returns its stdout when it
+// exits with 0
+auto capture(std::vector<std::string> args) -> std::optional<std::string> {
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    InputBuffer output;
+    InputBuffer errors;
+    std::ostringstream ignored;
+    const auto exit = run_child(argv, -1, -1, output, errors, {}, ignored);
+    if (!exit || exit->exit_code != 0) {
+        return std::nullopt;
+    }
+    return std::string(output.content());
+}
+
+auto takes_catch2_value(std::string_view option) -> bool {
+    return std::find(CATCH2_VALUE_OPTIONS.begin(), CATCH2_VALUE_OPTIONS.end(), option) != CATCH2_VALUE_OPTIONS.end();
+}
+
+// The command line's arguments for listing its tests, without the options
+// that would write the listing somewhere else or in another format
+auto listing_arguments(std::span<char* const> argv, Framework framework) -> std::vector<std::string> {
+    std::vector<std::string> args = {argv[0]};
+    const auto rest = argv.subspan(1);
+    for (std::size_t i = 0; i < rest.size(); ++i) {
+        const std::string_view arg = rest[i];
+        if (framework == Framework::GoogleTest) {
+            if (!arg.starts_with("--gtest_output")) {
+                args.emplace_back(arg);
+            }
+            continue;
+        }
+        const auto option = arg.substr(0, arg.find('='));
+        const bool output = option == "-r" || option == "--reporter" || option == "-o" || option == "--out";
+        if (output && option.size() == arg.size() && i + 1 < rest.size()) {
+            ++i;
+        }
+        if (!output) {
+            args.emplace_back(arg);
+        }
+    }
+    if (framework == Framework::GoogleTest) {
+        args.emplace_back("--gtest_list_tests");
+    } else {
+        args.insert(args.end(), {"--list-tests", "--verbosity", "quiet"});
+    }
+    return args;
+}
+
+// Lists the tests the command line selects. A Catch2 binary rejects
+// --gtest_list_tests, so GoogleTest goes first.
+auto list_tests(std::span<char* const> argv) -> Listing {
+    if (auto listing = capture(listing_arguments(argv, Framework::GoogleTest))) {
+        return {.framework = Framework::GoogleTest, .tests = parse_googletest_listing(*listing), .splittable = true};
+    }
+    if (auto listing = capture(listing_arguments(argv, Framework::Catch2))) {
+        return {.framework = Framework::Catch2,
+                .tests = parse_catch2_listing(*listing),
+                .splittable = !catch2_selects_tests(argv.subspan(1))};
+    }
+    return {};
+}
+
+// The batch's arguments after the command line's own. A batch without
+// tests runs every test. Empty after reporting to err that the Catch2 test
+// list could not be written, since Catch2 would run every test for a list
+// left empty or cut short.
+auto batch_arguments(const Listing& listing, const Batch& batch, const fs::path& dir, std::size_t index,
+                     std::ostream& err) -> std::optional<std::vector<std::string>> {
+    const auto report = dir / ("batch-" + std::to_string(index) + ".json");
+    if (batch.tests.empty()) {
+        if (listing.framework == Framework::GoogleTest) {
+            return std::vector<std::string>{"--gtest_output=json:" + report.string()};
+        }
+        return std::vector<std::string>{"--reporter", "json::out=" + report.string()};
+    }
+    if (listing.framework == Framework::GoogleTest) {
+        // GoogleTest keeps the last --gtest_filter given. The listing
+        // applied the command line's own, so naming listed tests narrows it.
+        std::string filter = "--gtest_filter=";
+        for (const auto test : batch.tests) {
+            if (filter.back() != '=') {
+                filter += ':';
+            }
+            filter += listing.tests[test];
+        }
+        return std::vector<std::string>{std::move(filter), "--gtest_output=json:" + report.string()};
+    }
+
+    const auto spec = dir / ("batch-" + std::to_string(index) + ".txt");
+    std::ofstream file(spec, std::ios::binary);
+    for (const auto test : batch.tests) {
+        file << catch2_spec_line(listing.tests[test]) << '\n';
+    }
+    file.close();
+    if (!file) {
+        err << "Error writing " << spec.string() << ": " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+    return std::vector<std::string>{"--input-file", spec.string(), "--reporter", "json::out=" + report.string()};
+}
+
+// Runs one batch, reads its report and diagnostics, and passes its output
+// on in one piece so batches do not interleave
+auto run_batch(const Listing& listing, std::span<char* const> argv, const fs::path& dir, std::size_t index,
+               Batch& batch, int out_fd, int err_fd, std::mutex& output_lock, std::ostream& err) -> void {
+    InputBuffer output;
+    InputBuffer errors;
+    std::ostringstream spawn_errors;
+    // A batch whose arguments cannot be prepared is not started
+    if (auto extra = batch_arguments(listing, batch, dir, index, spawn_errors)) {
+        std::vector<char*> args(argv.begin(), argv.end());
+        for (auto& arg : *extra) {
+            args.push_back(arg.data());
+        }
+        batch.exit = run_child(args, -1, -1, output, errors, {}, spawn_errors);
+    }
+
+    Parser parser;
+    const auto report = read_file(dir / ("batch-" + std::to_string(index) + ".json"));
+    const bool parsed = parser.parse(report);
+    if (parsed || parser.truncated()) {
+        batch.events = parser.take_events();
+    }
+
+    std::vector<std::string_view> lines;
+    lines.reserve(errors.line_count());
+    for (std::size_t i = 0; i < errors.line_count(); ++i) {
+        lines.push_back(errors.line(i));
+    }
+    batch.errors = parse_error_buffer(lines);
+
+    if (!batch.exit) {
+        // Its tests are reported as not run rather than left out
+        auto reason = spawn_errors.str();
+        while (!reason.empty() && reason.back() == '\n') {
+            reason.pop_back();
+        }
+        std::string names;
+        for (const auto test : batch.tests) {
+            names += names.empty() ? "; not run: " : ", ";
+            names += listing.tests[test];
+        }
+        batch.errors.push_back(CompilationError{.message = "Test batch not started", .note = reason + names});
+    } else if (!parsed) {
+        std::string ending = batch.exit->signal ? "signal " + std::to_string(*batch.exit->signal)
+                                                : "exit code " + std::to_string(batch.exit->exit_code.value_or(1));
+        const auto tests = batch.tests.empty() ? std::string("The tests")
+                                               : "A batch of " + std::to_string(batch.tests.size()) + " tests";
+        batch.errors.push_back(CompilationError{
+            .message = "Incomplete test output",
+            .note = tests + " ended with " + ending +
+                    (parser.truncated() ? "; tests that finished are reported" : " before reporting")
+        });
+    }
+
+    std::lock_guard lock(output_lock);
+    err << spawn_errors.str();
+    if (out_fd >= 0) {
+        (void)write_all(out_fd, output.content());
+    }
+    if (err_fd >= 0) {
+        (void)write_all(err_fd, errors.content());
+    }
+}
+
+// Position of the event's test in the listing. Catch2 sections report as
+// "name/section", so shorter prefixes are tried before giving up.
+auto listing_position(const std::unordered_map<std::string_view, std::size_t>& positions,
+                      std::string_view full_name) -> std::size_t {
+    for (;;) {
+        if (const auto it = positions.find(full_name); it != positions.end()) {
+            return it->second;
+        }
+        const auto slash = full_name.rfind('/');
+        if (slash == std::string_view::npos) {
+            return positions.size();
+        }
+        full_name = full_name.substr(0, slash);
+    }
+}
+
+auto make_batch_dir(std::ostream& err) -> std::optional<fs::path> {
+    std::error_code ec;
+    auto pattern = (fs::temp_directory_path(ec) / "tdd-guard-cpp-XXXXXX").string();
+    if (ec || ::mkdtemp(pattern.data()) == nullptr) {
+        err << "Error creating a directory for batch reports\n";
+        return std::nullopt;
+    }
+    return fs::path(pattern);
+}
+
+// Batches of the selected tests, given as indices into the listing: at
+// least batches_per_job for each job, and few enough tests in each that
+// its --gtest_filter fits in one argument
+auto plan_listed(const Listing& listing, std::span<const std::size_t> selected, const TestHistory& history,
+                 unsigned jobs, std::size_t batches_per_job) -> std::vector<Batch> {
+    std::vector<std::string> names;
+    names.reserve(selected.size());
+    for (const auto test : selected) {
+        names.push_back(listing.tests[test]);
+    }
+
+    std::vector<Batch> batches;
+    for (auto& tests : plan_batches(names, history, jobs * batches_per_job, MAX_FILTER_BYTES)) {
+        for (auto& test : tests) {
+            test = selected[test];
+        }
+        batches.push_back(Batch{.tests = std::move(tests), .exit = {}, .events = {}, .errors = {}});
+    }
+    return batches;
+}
+
+// Runs the batches, jobs at a time. Reports are named after first_index
+// plus each batch's place in batches.
+auto run_batches(const Listing& listing, std::span<char* const> argv, const fs::path& dir, std::span<Batch> batches,
+                 std::size_t first_index, unsigned jobs, int out_fd, int err_fd, std::ostream& err) -> void {
+    // Batches are taken in order, longest first, by whichever worker is free
+    std::atomic<std::size_t> next{0};
+    std::mutex output_lock;
+    std::vector<std::thread> workers;
+    for (unsigned worker = 0; worker < std::min<std::size_t>(jobs, batches.size()); ++worker) {
+        workers.emplace_back([&] {
+            for (auto index = next++; index < batches.size(); index = next++) {
+                run_batch(listing, argv, dir, first_index + index, batches[index], out_fd, err_fd, output_lock, err);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// What the batches reported, as a single run of their tests would report it.
+// A batch that could not be started fails the run.
+struct Merged {
+    TddGuardOutput output;
+    ProcessExit exit;
+};
+
+auto merge_batches(const Listing& listing, std::span<Batch> batches, unsigned jobs) -> Merged {
+    ProcessExit exit{.exit_code = 0};
+    std::vector<TestEvent> events;
+    std::vector<CompilationError> compilation_errors;
+    for (auto& batch : batches) {
+        if (batch.exit) {
+            exit = worst_exit(exit, *batch.exit);
+        } else {
+            exit = worst_exit(exit, ProcessExit{.exit_code = NOT_STARTED_EXIT});
+        }
+        std::move(batch.events.begin(), batch.events.end(), std::back_inserter(events));
+        std::move(batch.errors.begin(), batch.errors.end(), std::back_inserter(compilation_errors));
+    }
+    // Tests keep the order of the listing, as in a single run
+    std::unordered_map<std::string_view, std::size_t> positions;
+    positions.reserve(listing.tests.size());
+    for (std::size_t i = 0; i < listing.tests.size(); ++i) {
+        positions.emplace(listing.tests[i], i);
+    }
+    std::vector<std::pair<std::size_t, std::size_t>> order;
+    order.reserve(events.size());
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        order.emplace_back(listing_position(positions, events[i].full_name), i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<TestEvent> ordered;
+    ordered.reserve(events.size());
+    for (const auto& [position, event] : order) {
+        ordered.push_back(std::move(events[event]));
+    }
+
+    TDD_GUARD_TIME_PHASE(Transform);
+    return {.output = transform_events(std::move(ordered), compilation_errors, jobs), .exit = exit};
+}
+
+} // anonymous namespace
+
+auto parse_googletest_listing(std::string_view listing) -> std::vector<std::string> {
+    std::vector<std::string> tests;
+    std::string suite;
+    for_each_line(listing, [&](std::string_view line) {
+        if (trim(line).empty()) {
+            return;
+        }
+        const auto name = without_comment(line);
+        if (line.front() != ' ') {
+            // Other lines, such as "Running main() from gtest_main.cc", end
+            // the suite rather than naming one
+            suite = name.ends_with('.') ? std::string(name) : std::string();
+        } else if (!suite.empty()) {
+            tests.push_back(suite + std::string(name));
+        }
+    });
+    return tests;
+}
+
+auto catch2_selects_tests(std::span<char* const> args) -> bool {
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string_view arg = args[i];
+        if (!arg.starts_with('-')) {
+            return true;
+        }
+        const auto option = arg.substr(0, arg.find('='));
+        if (option == "-f" || option == "--input-file") {
+            return true;
+        }
+        if (option.size() == arg.size() && takes_catch2_value(option)) {
+            ++i;
+        }
+    }
+    return false;
+}
+
+auto parse_catch2_listing(std::string_view listing) -> std::vector<std::string> {
+    std::vector<std::string> tests;
+    for_each_line(listing, [&](std::string_view line) {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        // Names that would read as a comment in an --input-file are quoted
+        if (line.size() >= 3 && line.starts_with("\"#") && line.ends_with('"')) {
+            line = line.substr(1, line.size() - 2);
+        }
+        if (!trim(line).empty()) {
+            tests.emplace_back(line);
+        }
+    });
+    return tests;
+}
+
+auto catch2_spec_line(std::string_view name) -> std::string {
+    std::string line;
+    if (name.starts_with('#')) {
+        line += '\\';
+    }
+    for (const char c : name) {
+        if (c == '\\' || c == '"') {
+            line += '\\';
+        }
+        line += c;
+    }
+    return line;
+}
+
+auto plan_batches(std::span<const std::string> tests, const TestHistory& history, std::size_t count,
+                  std::size_t max_bytes) -> std::vector<std::vector<std::size_t>> {
+    using std::chrono::microseconds;
+    if (tests.empty()) {
+        return {};
+    }
+    count = std::clamp<std::size_t>(count, 1, tests.size());
+
+    std::vector<std::optional<microseconds>> known(tests.size());
+    microseconds known_total{0};
+    std::size_t known_count = 0;
+    for (std::size_t i = 0; i < tests.size(); ++i) {
+        known[i] = history.duration_of(tests[i]);
+        if (known[i]) {
+            known_total += *known[i];
+            ++known_count;
+        }
+    }
+    const auto fallback = known_count > 0 ? known_total / static_cast<microseconds::rep>(known_count)
+                                          : microseconds(DEFAULT_TEST_TIME);
+
+    // Longest tests first, each into the least loaded batch
+    std::vector<std::size_t> order(tests.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    const auto expected = [&](std::size_t test) { return known[test].value_or(fallback); };
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) { return expected(a) > expected(b); });
+
+    using Load = std::pair<microseconds, std::size_t>;
+    std::priority_queue<Load, std::vector<Load>, std::greater<>> loads;
+    for (std::size_t i = 0; i < count; ++i) {
+        loads.emplace(microseconds(0), i);
+    }
+    std::vector<std::vector<std::size_t>> batches(count);
+    std::vector<microseconds> totals(count, microseconds(0));
+    std::vector<std::size_t> bytes(count, 0);
+    for (const auto test : order) {
+        auto [load, batch] = loads.top();
+        loads.pop();
+        const auto size = tests[test].size() + 1;
+        if (!batches[batch].empty() && bytes[batch] + size > max_bytes) {
+            // The batch is full and takes no more tests; a new one takes its place
+            batch = batches.size();
+            load = microseconds(0);
+            batches.emplace_back();
+            totals.emplace_back(0);
+            bytes.push_back(0);
+        }
+        batches[batch].push_back(test);
+        bytes[batch] += size;
+        totals[batch] = load + expected(test);
+        loads.emplace(totals[batch], batch);
+    }
+
+    count = batches.size();
+    std::vector<std::size_t> by_load(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        by_load[i] = i;
+        std::sort(batches[i].begin(), batches[i].end());
+    }
+    std::stable_sort(by_load.begin(), by_load.end(),
+                     [&](std::size_t a, std::size_t b) { return totals[a] > totals[b]; });
+
+    std::vector<std::vector<std::size_t>> planned;
+    planned.reserve(count);
+    for (const auto batch : by_load) {
+        if (!batches[batch].empty()) {
+            planned.push_back(std::move(batches[batch]));
+        }
+    }
+    return planned;
+}
+
+auto run_binary(std::span<char* const> argv, int out_fd, int err_fd, std::ostream& err)
+    -> std::optional<TddGuardOutput> {
+    if (argv.empty()) {
+        err << "Error: no test command given after --\n";
+        return std::nullopt;
+    }
+
+    const auto listing = list_tests(argv);
+    if (listing.framework == Framework::Unknown) {
+        InputBuffer output;
+        InputBuffer errors;
+        ReportBuilder report(output, errors);
+        const auto exit = run_child(argv, out_fd, err_fd, output, errors, [&] { report.update(); }, err);
+        if (!exit) {
+            return std::nullopt;
+        }
+        auto result = report.finish();
+        record_process_exit(result, *exit);
+        return result;
+    }
+
+    const auto dir = make_batch_dir(err);
+    if (!dir) {
+        return std::nullopt;
+    }
+    Batch batch{.tests = {}, .exit = {}, .events = {}, .errors = {}};
+    std::mutex output_lock;
+    run_batch(listing, argv, *dir, 0, batch, out_fd, err_fd, output_lock, err);
+    std::error_code ec;
+    fs::remove_all(*dir, ec);
+    if (!batch.exit) {
+        return std::nullopt;
+    }
+
+    auto result = transform_events(std::move(batch.events), batch.errors);
+    record_process_exit(result, *batch.exit);
+    return result;
+}
+
+auto run_sharded(int results_fd, std::span<char* const> argv, int out_fd, int err_fd,
+                 const ShardOptions& options, std::ostream& err) -> int {
+    if (argv.empty()) {
+        err << "Error: no test command given after --\n";
+        return 127;
+    }
+
+    const auto listing = list_tests(argv);
+    if (!listing.splittable) {
+        err << "tdd-guard-cpp: the command line names Catch2 tests itself, so they run in one process\n";
+    }
+    if (listing.tests.empty() || !listing.splittable) {
+        return run_command(results_fd, argv, out_fd, err_fd, {}, err);
+    }
+
+    const unsigned jobs = options.jobs > 0 ? options.jobs : std::max(1U, std::thread::hardware_concurrency());
+    const auto history = results_fd >= 0 ? TestHistory::load(results_fd) : TestHistory{};
+    std::vector<std::size_t> failed;
+    std::vector<std::size_t> rest;
+    for (std::size_t i = 0; i < listing.tests.size(); ++i) {
+        (history.failed(listing.tests[i]) ? failed : rest).push_back(i);
+    }
+
+    // One batch per job for the tests that failed last time, so they finish
+    // as soon as they can
+    auto batches = plan_listed(listing, failed, history, jobs, 1);
+    const auto failed_batches = batches.size();
+    auto rest_batches = plan_listed(listing, rest, history, jobs, BATCHES_PER_JOB);
+    std::move(rest_batches.begin(), rest_batches.end(), std::back_inserter(batches));
+
+    const auto dir = make_batch_dir(err);
+    if (!dir) {
+        return 1;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    {
+        TDD_GUARD_TIME_PHASE(Forward);
+        IgnoreInterrupts ignore_interrupts;
+        const std::span<Batch> all(batches);
+        if (failed_batches > 0 && failed_batches < batches.size()) {
+            run_batches(listing, argv, *dir, all.first(failed_batches), 0, jobs, out_fd, err_fd, err);
+            // Their results are saved before the rest of the suite starts
+            std::vector<Batch> first(batches.begin(), batches.begin() + static_cast<std::ptrdiff_t>(failed_batches));
+            const auto merged = merge_batches(listing, first, jobs);
+            if (results_fd >= 0) {
+                (void)save_results(results_fd, merged.output, err);
+            }
+            run_batches(listing, argv, *dir, all.subspan(failed_batches), failed_batches, jobs, out_fd, err_fd, err);
+        } else {
+            run_batches(listing, argv, *dir, all, 0, jobs, out_fd, err_fd, err);
+        }
+    }
+    std::error_code ec;
+    fs::remove_all(*dir, ec);
+
+    auto merged = merge_batches(listing, batches, jobs);
+    record_process_exit(merged.output, merged.exit);
+
+    if (results_fd < 0 || !save_results(results_fd, merged.output, err)) {
+        return 1;
+    }
+    return exit_status(merged.exit);
+}
+
+} // namespace tdd_guard
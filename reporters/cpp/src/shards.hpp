@@ -0,0 +1,69 @@
+#pragma once
+
+#include "history.hpp"
+#include "transformer.hpp"
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tdd_guard {
+
+struct ShardOptions {
+    // Batches run at once; 0 runs one per core
+    unsigned jobs = 0;
+};
+
+// Full test names, Suite.Name, from the output of --gtest_list_tests
+[[nodiscard]] auto parse_googletest_listing(std::string_view listing) -> std::vector<std::string>;
+
+// Test case names from the output of Catch2's --list-tests --verbosity quiet,
+// without the quotes it puts around names starting with #
+[[nodiscard]] auto parse_catch2_listing(std::string_view listing) -> std::vector<std::string>;
+
+// The line of a Catch2 --input-file that selects the test case name. Catch2
+// quotes each line, so only the characters that would end the quote or
+// start an escape are escaped, and a leading # that would make the line a
+// comment.
+[[nodiscard]] auto catch2_spec_line(std::string_view name) -> std::string;
+
+// Whether Catch2 arguments, argv without the binary, name the tests to run
+// with a test spec or an --input-file
+[[nodiscard]] auto catch2_selects_tests(std::span<char* const> args) -> bool;
+
+// Splits tests into at most count batches of about equal expected time,
+// longest first. Each test is expected to take as long as it did in the
+// history, or else the mean of the tests the history knows. A batch lists
+// indices into tests in ascending order. Its names, each counted with one
+// separator byte, take at most max_bytes unless a single name does; a full
+// batch takes no more tests, and batches beyond count take the rest.
+[[nodiscard]] auto plan_batches(std::span<const std::string> tests, const TestHistory& history,
+                                std::size_t count,
+                                std::size_t max_bytes = std::numeric_limits<std::size_t>::max())
+    -> std::vector<std::vector<std::size_t>>;
+
+// Runs every test of the GoogleTest or Catch2 binary in argv[0], with the
+// rest of argv, and returns its report with how it ended, without saving
+// it. The report is written to a temporary file, so the output is passed
+// on unchanged, once the binary ends. A binary whose tests cannot be listed
+// is run as run_command runs it. Empty when the binary could not be run.
+[[nodiscard]] auto run_binary(std::span<char* const> argv, int out_fd, int err_fd, std::ostream& err)
+    -> std::optional<TddGuardOutput>;
+
+// Lists the tests the GoogleTest or Catch2 command in argv selects and runs
+// them in batches, several processes at once, each batch with all of argv.
+// A batch's own --gtest_filter comes last and names listed tests only, so
+// it narrows any filter in argv. Each batch's output is forwarded to out_fd
+// and err_fd once the batch ends. A batch that cannot be started is
+// reported as an error naming its tests, and fails the run with exit code
+// 127. The merged report is saved like run_command saves it, and the return
+// value is the same. Commands whose tests cannot be listed, and Catch2
+// commands naming their own tests, run once through run_command.
+[[nodiscard]] auto run_sharded(int results_fd, std::span<char* const> argv, int out_fd, int err_fd,
+                               const ShardOptions& options, std::ostream& err) -> int;
+
+} // namespace tdd_guard
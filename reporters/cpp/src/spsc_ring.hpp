@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace tdd_guard {
+
+// Fixed-size lock-free queue for exactly one producer thread and one
+// consumer thread. Each index is written by one side only, so a push or pop
+// is a relaxed load, an acquire load and a release store. The blocking
+// variants sleep on the opposite index instead of spinning.
+template<typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "capacity must be a power of two");
+
+public:
+    // Producer side. Moves from value only when it was queued.
+    [[nodiscard]] auto try_push(T& value) -> bool {
+        const auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots_[tail & MASK] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+        return true;
+    }
+
+    auto push(T value) -> void {
+        while (!try_push(value)) {
+            head_.wait(tail_.load(std::memory_order_relaxed) - Capacity, std::memory_order_acquire);
+        }
+    }
+
+    // Consumer side
+    [[nodiscard]] auto try_pop() -> std::optional<T> {
+        const auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T> value(std::move(slots_[head & MASK]));
+        head_.store(head + 1, std::memory_order_release);
+        head_.notify_one();
+        return value;
+    }
+
+    auto pop() -> T {
+        for (;;) {
+            if (auto value = try_pop()) {
+                return std::move(*value);
+            }
+            tail_.wait(head_.load(std::memory_order_relaxed), std::memory_order_acquire);
+        }
+    }
+
+private:
+    static constexpr std::size_t MASK = Capacity - 1;
+    // Keeps the two indices on separate cache lines so the threads do not
+    // invalidate each other's line on every operation
+    static constexpr std::size_t LINE = 64;
+
+    alignas(LINE) std::atomic<std::size_t> head_{0};
+    alignas(LINE) std::atomic<std::size_t> tail_{0};
+    alignas(LINE) std::array<T, Capacity> slots_{};
+};
+
+} // namespace tdd_guard
@@ -0,0 +1,157 @@
+#include "stats.hpp"
+#include <atomic>
+#include <ctime>
+#include <iomanip>
+#include <sys/resource.h>
+#include <utility>
+
+namespace tdd_guard {
+
+namespace {
+
+struct AtomicTotals {
+    std::atomic<std::int64_t> wall_ns{0};
+    std::atomic<std::int64_t> cpu_ns{0};
+    std::atomic<std::uint64_t> calls{0};
+};
+
+std::atomic<bool> enabled{false};
+std::array<AtomicTotals, PHASE_COUNT> totals;
+// The timer whose scope the thread is in
+thread_local PhaseTimer* innermost = nullptr;
+
+auto thread_cpu_time() -> std::chrono::nanoseconds {
+    timespec ts{};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+auto milliseconds(std::chrono::nanoseconds duration) -> double {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // anonymous namespace
+
+auto phase_name(Phase phase) -> std::string_view {
+    switch (phase) {
+        case Phase::Forward: return "forward";
+        case Phase::ScanLines: return "scan_lines";
+        case Phase::ParseJson: return "parse_json";
+        case Phase::ParseErrors: return "parse_errors";
+        case Phase::Transform: return "transform";
+        case Phase::Serialize: return "serialize";
+        case Phase::Save: return "save";
+    }
+    return "unknown";
+}
+
+auto set_stats_enabled(bool enable) -> void {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+auto stats_enabled() -> bool {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+auto reset_stats() -> void {
+    for (auto& phase : totals) {
+        phase.wall_ns = 0;
+        phase.cpu_ns = 0;
+        phase.calls = 0;
+    }
+}
+
+auto collect_stats() -> RunStats {
+    RunStats stats;
+    for (std::size_t i = 0; i < PHASE_COUNT; ++i) {
+        stats.phases[i] = PhaseTotals{
+            .wall = std::chrono::nanoseconds(totals[i].wall_ns.load()),
+            .cpu = std::chrono::nanoseconds(totals[i].cpu_ns.load()),
+            .calls = totals[i].calls.load()
+        };
+    }
+    stats.peak_rss_bytes = peak_rss_bytes();
+    return stats;
+}
+
+auto peak_rss_bytes() -> std::uint64_t {
+    rusage usage{};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports kilobytes
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+auto print_stats(std::ostream& out, const RunStats& stats) -> void {
+    const auto flags = out.flags();
+    out << "tdd-guard-cpp stats\n"
+        << std::left << std::setw(14) << "  phase" << std::right << std::setw(12) << "wall ms"
+        << std::setw(12) << "cpu ms" << std::setw(10) << "calls" << "\n"
+        << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < PHASE_COUNT; ++i) {
+        const auto& phase = stats.phases[i];
+        out << "  " << std::left << std::setw(12) << phase_name(static_cast<Phase>(i)) << std::right
+            << std::setw(12) << milliseconds(phase.wall) << std::setw(12) << milliseconds(phase.cpu)
+            << std::setw(10) << phase.calls << "\n";
+    }
+    out << "  bytes " << stats.bytes << ", lines " << stats.lines << ", tests " << stats.tests
+        << ", peak RSS " << stats.peak_rss_bytes / 1024 << " KiB\n";
+    out.flags(flags);
+}
+
+auto write_stats_json(JsonWriter& writer, const RunStats& stats) -> void {
+    writer.begin_object();
+    writer.key("bytes");
+    writer.number(stats.bytes);
+    writer.key("lines");
+    writer.number(stats.lines);
+    writer.key("peakRssBytes");
+    writer.number(stats.peak_rss_bytes);
+    writer.key("phases");
+    writer.begin_object();
+    for (std::size_t i = 0; i < PHASE_COUNT; ++i) {
+        const auto& phase = stats.phases[i];
+        writer.key(phase_name(static_cast<Phase>(i)));
+        writer.begin_object();
+        writer.key("calls");
+        writer.number(phase.calls);
+        writer.key("cpuMs");
+        writer.number(milliseconds(phase.cpu));
+        writer.key("wallMs");
+        writer.number(milliseconds(phase.wall));
+        writer.end_object();
+    }
+    writer.end_object();
+    writer.key("tests");
+    writer.number(stats.tests);
+    writer.end_object();
+}
+
+PhaseTimer::PhaseTimer(Phase phase) : phase_(phase), active_(stats_enabled()) {
+    if (active_) {
+        enclosing_ = std::exchange(innermost, this);
+        wall_start_ = std::chrono::steady_clock::now();
+        cpu_start_ = thread_cpu_time();
+    }
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (!active_) {
+        return;
+    }
+    const auto cpu = thread_cpu_time() - cpu_start_;
+    const auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                           wall_start_);
+    innermost = enclosing_;
+    if (enclosing_ != nullptr) {
+        enclosing_->nested_wall_ += wall;
+        enclosing_->nested_cpu_ += cpu;
+    }
+    auto& phase = totals[static_cast<std::size_t>(phase_)];
+    phase.wall_ns.fetch_add((wall - nested_wall_).count(), std::memory_order_relaxed);
+    phase.cpu_ns.fetch_add((cpu - nested_cpu_).count(), std::memory_order_relaxed);
+    phase.calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "json_writer.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+namespace tdd_guard {
+
+// Where the reporter spends its time. A phase counts only the time not
+// spent in phases nested inside it on the same thread, so Forward leaves
+// out the parsing done on the forwarding thread and Save leaves out
+// Serialize. Phases on different threads overlap in wall time.
+enum class Phase {
+    Forward,
+    ScanLines,
+    ParseJson,
+    ParseErrors,
+    Transform,
+    Serialize,
+    Save,
+};
+
+constexpr std::size_t PHASE_COUNT = 7;
+
+struct PhaseTotals {
+    std::chrono::nanoseconds wall{};
+    std::chrono::nanoseconds cpu{};
+    std::uint64_t calls = 0;
+};
+
+struct RunStats {
+    std::array<PhaseTotals, PHASE_COUNT> phases{};
+    std::uint64_t bytes = 0;
+    std::uint64_t lines = 0;
+    std::uint64_t tests = 0;
+    std::uint64_t peak_rss_bytes = 0;
+};
+
+[[nodiscard]] auto phase_name(Phase phase) -> std::string_view;
+
+// Timers record nothing while stats are disabled, the default. Set before
+// any timed thread starts.
+auto set_stats_enabled(bool enable) -> void;
+[[nodiscard]] auto stats_enabled() -> bool;
+auto reset_stats() -> void;
+
+// Totals so far, with the counters left for the caller to fill in
+[[nodiscard]] auto collect_stats() -> RunStats;
+[[nodiscard]] auto peak_rss_bytes() -> std::uint64_t;
+
+auto print_stats(std::ostream& out, const RunStats& stats) -> void;
+auto write_stats_json(JsonWriter& writer, const RunStats& stats) -> void;
+
+// Adds the wall time and the calling thread's CPU time of its scope, less
+// that of the timers nested in it, to a phase. Use TDD_GUARD_TIME_PHASE so
+// builds without stats drop it entirely.
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    auto operator=(const PhaseTimer&) -> PhaseTimer& = delete;
+
+private:
+    Phase phase_;
+    bool active_;
+    PhaseTimer* enclosing_ = nullptr;
+    std::chrono::steady_clock::time_point wall_start_;
+    std::chrono::nanoseconds cpu_start_{};
+    std::chrono::nanoseconds nested_wall_{};
+    std::chrono::nanoseconds nested_cpu_{};
+};
+
+} // namespace tdd_guard
+
+#define TDD_GUARD_CONCAT_IMPL(a, b) a##b
+#define TDD_GUARD_CONCAT(a, b) TDD_GUARD_CONCAT_IMPL(a, b)
+
+#ifdef TDD_GUARD_STATS
+#define TDD_GUARD_TIME_PHASE(phase) \
+    const ::tdd_guard::PhaseTimer TDD_GUARD_CONCAT(phase_timer_, __LINE__)(::tdd_guard::Phase::phase)
+#else
+#define TDD_GUARD_TIME_PHASE(phase) static_cast<void>(0)
+#endif
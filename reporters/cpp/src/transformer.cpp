@@ -1,21 +1,32 @@
 #include "transformer.hpp"
+#include "utf8.hpp"
 #include <algorithm>
-#include <map>
-#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+#include <thread>
 
 namespace tdd_guard {
 
-using json = nlohmann::json;
-
 namespace {
 
-template<typename T>
-void set_if_present(json& obj, const char* key, const std::optional<T>& value) {
+auto write_if_present(JsonWriter& writer, std::string_view key,
+                      const std::optional<std::string>& value) -> void {
     if (value.has_value()) {
-        obj[key] = *value;
+        writer.key(key);
+        writer.string(*value);
     }
 }
 
+// Durations are written in milliseconds
+auto write_duration(JsonWriter& writer, std::chrono::microseconds duration) -> void {
+    writer.key("duration");
+    writer.number(std::chrono::duration<double, std::milli>(duration).count());
+}
+
 auto format_compilation_error(const CompilationError& error) -> TestError {
     std::string location;
     if (error.file.has_value()) {
@@ -39,7 +50,160 @@ auto format_compilation_error(const CompilationError& error) -> TestError {
     };
 }
 
-auto state_to_string(TestEvent::State state) -> std::string {
+auto repair_if_present(std::optional<std::string>& value) -> void {
+    if (value.has_value()) {
+        repair_utf8(*value);
+    }
+}
+
+auto repair_module_tests(TestModule& module) -> void {
+    for (auto& test : module.tests) {
+        repair_utf8(test.name);
+        repair_utf8(test.full_name);
+        for (auto& error : test.errors) {
+            repair_utf8(error.message);
+            repair_if_present(error.location);
+            repair_if_present(error.code);
+            repair_if_present(error.help);
+            repair_if_present(error.note);
+            repair_if_present(error.expected);
+            repair_if_present(error.actual);
+        }
+    }
+}
+
+// Below this many events per thread, starting threads costs more than
+// grouping saves
+constexpr std::size_t MIN_EVENTS_PER_THREAD = 16 * 1024;
+
+// Groups test results by module with an open-addressing table: linear
+// probing over a power-of-two array of slots that keep each name's hash
+// beside it, so a probe rarely compares the name itself. The table already
+// finds each name once, so a new name is copied straight into an arena,
+// where slots can point at it while the module list grows.
+class ModuleGroups {
+public:
+    // Names are repaired before they are looked up, so names that differ
+    // only in their invalid bytes share one module
+    auto module_for(std::string_view name) -> TestModule& {
+        std::string repaired;
+        if (!is_valid_utf8(name)) {
+            repaired = name;
+            repair_utf8(repaired);
+            name = repaired;
+        }
+        const auto hash = std::hash<std::string_view>{}(name);
+        if ((modules_.size() + 1) * 2 > slots_.size()) {
+            grow();
+        }
+        auto pos = hash & (slots_.size() - 1);
+        for (; slots_[pos].module != EMPTY; pos = (pos + 1) & (slots_.size() - 1)) {
+            if (slots_[pos].hash == hash && slots_[pos].name == name) {
+                return modules_[slots_[pos].module];
+            }
+        }
+
+        slots_[pos] = Slot{.hash = hash, .name = copy_name(name), .module = modules_.size()};
+        auto& module = modules_.emplace_back();
+        module.module_id = name;
+        return module;
+    }
+
+    // Appends other's tests after this group's own, module by module
+    auto merge(ModuleGroups&& other) -> void {
+        for (auto& module : other.modules_) {
+            auto& target = module_for(module.module_id);
+            if (target.tests.empty()) {
+                target.tests = std::move(module.tests);
+            } else {
+                target.tests.insert(target.tests.end(), std::make_move_iterator(module.tests.begin()),
+                                    std::make_move_iterator(module.tests.end()));
+            }
+        }
+    }
+
+    // Test output and compiler diagnostics may carry raw bytes, such as
+    // binary buffers or Latin-1 paths, which must not reach the JSON output
+    auto repair_tests() -> void {
+        for (auto& module : modules_) {
+            repair_module_tests(module);
+        }
+    }
+
+    // Only the modules are sorted; their tests keep the order they came in
+    [[nodiscard]] auto take_sorted() -> std::vector<TestModule> {
+        std::sort(modules_.begin(), modules_.end(), [](const auto& a, const auto& b) {
+            return a.module_id < b.module_id;
+        });
+        slots_.clear();
+        return std::move(modules_);
+    }
+
+private:
+    static constexpr std::size_t EMPTY = static_cast<std::size_t>(-1);
+
+    struct Slot {
+        std::size_t hash = 0;
+        std::string_view name;
+        std::size_t module = EMPTY;
+    };
+
+    std::pmr::monotonic_buffer_resource names_;
+    std::vector<Slot> slots_;
+    std::vector<TestModule> modules_;
+
+    auto copy_name(std::string_view name) -> std::string_view {
+        auto* data = static_cast<char*>(names_.allocate(std::max<std::size_t>(name.size(), 1), 1));
+        std::memcpy(data, name.data(), name.size());
+        return {data, name.size()};
+    }
+
+    auto grow() -> void {
+        std::vector<Slot> slots(std::max<std::size_t>(16, slots_.size() * 2));
+        for (const auto& slot : slots_) {
+            if (slot.module == EMPTY) {
+                continue;
+            }
+            auto pos = slot.hash & (slots.size() - 1);
+            while (slots[pos].module != EMPTY) {
+                pos = (pos + 1) & (slots.size() - 1);
+            }
+            slots[pos] = slot;
+        }
+        slots_ = std::move(slots);
+    }
+};
+
+// Moves each event into its module's results. Returns whether any failed.
+auto group_events(std::span<TestEvent> events, ModuleGroups& groups) -> bool {
+    bool has_failure = false;
+    for (auto& event : events) {
+        auto& module = groups.module_for(Parser::extract_module(event.full_name));
+
+        std::vector<TestError> errors;
+        if (event.state == TestEvent::State::Failed) {
+            has_failure = true;
+            auto error_msg = event.error_message();
+            if (error_msg.has_value()) {
+                errors.push_back(TestError{.message = std::move(*error_msg)});
+            }
+        }
+
+        std::string name(Parser::extract_simple_name(event.full_name));
+        module.tests.push_back(TestResult{
+            .name = std::move(name),
+            .full_name = std::move(event.full_name),
+            .state = event.state,
+            .errors = std::move(errors),
+            .duration = event.duration
+        });
+    }
+    return has_failure;
+}
+
+} // anonymous namespace
+
+auto state_name(TestEvent::State state) -> std::string_view {
     switch (state) {
         case TestEvent::State::Passed: return "passed";
         case TestEvent::State::Failed: return "failed";
@@ -49,116 +213,255 @@ auto state_to_string(TestEvent::State state) -> std::string {
     return "unknown";
 }
 
-} // anonymous namespace
+auto parse_state(std::string_view name) -> std::optional<TestEvent::State> {
+    if (name == "passed") return TestEvent::State::Passed;
+    if (name == "failed") return TestEvent::State::Failed;
+    if (name == "skipped") return TestEvent::State::Skipped;
+    if (name == "unknown") return TestEvent::State::Unknown;
+    return std::nullopt;
+}
 
 auto TddGuardOutput::to_json() const -> std::string {
-    json output;
+    JsonWriter writer;
+    write_json(writer);
+    return writer.take();
+}
+
+// Keys are written in sorted order, the layout dump() gives a json object
+auto TddGuardOutput::write_json(JsonWriter& writer) const -> void {
+    writer.begin_object();
+    if (process.has_value()) {
+        writer.key("process");
+        writer.begin_object();
+        if (process->exit_code.has_value()) {
+            writer.key("exitCode");
+            writer.number(static_cast<std::uint64_t>(*process->exit_code));
+        }
+        if (process->signal.has_value()) {
+            writer.key("signal");
+            writer.number(static_cast<std::uint64_t>(*process->signal));
+        }
+        writer.end_object();
+    }
+    if (reason.has_value()) {
+        writer.key("reason");
+        writer.string(*reason);
+    }
 
-    json modules_array = json::array();
+    writer.key("testModules");
+    writer.begin_array();
     for (const auto& module : test_modules) {
-        json module_obj;
-        module_obj["moduleId"] = module.module_id;
+        writer.begin_object();
+        writer.key("moduleId");
+        writer.string(module.module_id);
 
-        json tests_array = json::array();
+        writer.key("tests");
+        writer.begin_array();
         for (const auto& test : module.tests) {
-            json test_obj;
-            test_obj["name"] = test.name;
-            test_obj["fullName"] = test.full_name;
-            test_obj["state"] = test.state;
-
+            writer.begin_object();
+            if (test.duration.has_value()) {
+                write_duration(writer, *test.duration);
+            }
             if (!test.errors.empty()) {
-                json errors_array = json::array();
+                writer.key("errors");
+                writer.begin_array();
                 for (const auto& error : test.errors) {
-                    json error_obj;
-                    error_obj["message"] = error.message;
-                    set_if_present(error_obj, "location", error.location);
-                    set_if_present(error_obj, "code", error.code);
-                    set_if_present(error_obj, "help", error.help);
-                    set_if_present(error_obj, "note", error.note);
-                    set_if_present(error_obj, "expected", error.expected);
-                    set_if_present(error_obj, "actual", error.actual);
-                    errors_array.push_back(error_obj);
+                    writer.begin_object();
+                    write_if_present(writer, "actual", error.actual);
+                    write_if_present(writer, "code", error.code);
+                    write_if_present(writer, "expected", error.expected);
+                    write_if_present(writer, "help", error.help);
+                    write_if_present(writer, "location", error.location);
+                    writer.key("message");
+                    writer.string(error.message);
+                    write_if_present(writer, "note", error.note);
+                    writer.end_object();
                 }
-                test_obj["errors"] = errors_array;
+                writer.end_array();
             }
+            writer.key("fullName");
+            writer.string(test.full_name);
+            writer.key("name");
+            writer.string(test.name);
+            writer.key("state");
+            writer.string(state_name(test.state));
+            writer.end_object();
+        }
+        writer.end_array();
+        writer.end_object();
+    }
+    writer.end_array();
 
-            tests_array.push_back(test_obj);
+    if (timing.has_value()) {
+        writer.key("timing");
+        writer.begin_object();
+        writer.key("modules");
+        writer.begin_array();
+        for (const auto& module : timing->modules) {
+            writer.begin_object();
+            write_duration(writer, module.duration);
+            writer.key("moduleId");
+            writer.string(module.module_id);
+            writer.end_object();
         }
-        module_obj["tests"] = tests_array;
-        modules_array.push_back(module_obj);
+        writer.end_array();
+        writer.key("slowest");
+        writer.begin_array();
+        for (const auto& test : timing->slowest) {
+            writer.begin_object();
+            write_duration(writer, test.duration);
+            writer.key("fullName");
+            writer.string(test.full_name);
+            writer.end_object();
+        }
+        writer.end_array();
+        writer.end_object();
     }
+    writer.end_object();
+}
 
-    output["testModules"] = modules_array;
-    if (reason.has_value()) {
-        output["reason"] = *reason;
+auto record_process_exit(TddGuardOutput& output, const ProcessExit& exit) -> void {
+    output.process = exit;
+    if (exit.exit_code != 0) {
+        output.reason = "failed";
+    }
+}
+
+auto worst_exit(const ProcessExit& a, const ProcessExit& b) -> ProcessExit {
+    if (a.signal) return a;
+    if (b.signal) return b;
+    if (b.exit_code.value_or(1) > a.exit_code.value_or(1)) return b;
+    return a;
+}
+
+auto merge_outputs(std::vector<TddGuardOutput> parts) -> TddGuardOutput {
+    TddGuardOutput merged;
+    std::optional<ProcessExit> exit;
+    for (auto& part : parts) {
+        std::move(part.test_modules.begin(), part.test_modules.end(), std::back_inserter(merged.test_modules));
+        if (part.reason == "failed" || !merged.reason) {
+            merged.reason = std::move(part.reason);
+        }
+        if (part.process) {
+            exit = exit ? worst_exit(*exit, *part.process) : *part.process;
+        }
     }
 
-    return output.dump();
+    // Same order transform_events gives, with each part's tests kept in order
+    auto& modules = merged.test_modules;
+    std::stable_sort(modules.begin(), modules.end(),
+                     [](const auto& a, const auto& b) { return a.module_id < b.module_id; });
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < modules.size(); ++i) {
+        if (kept > 0 && modules[kept - 1].module_id == modules[i].module_id) {
+            auto& tests = modules[kept - 1].tests;
+            std::move(modules[i].tests.begin(), modules[i].tests.end(), std::back_inserter(tests));
+        } else if (kept++ != i) {
+            modules[kept - 1] = std::move(modules[i]);
+        }
+    }
+    modules.resize(kept);
+
+    merged.timing = summarize_durations(modules, SLOWEST_TEST_COUNT);
+    if (exit) {
+        record_process_exit(merged, *exit);
+    }
+    return merged;
+}
+
+auto summarize_durations(const std::vector<TestModule>& modules, std::size_t slowest_count)
+    -> std::optional<TimingSummary> {
+    TimingSummary summary;
+    std::vector<const TestResult*> timed;
+    for (const auto& module : modules) {
+        std::optional<std::chrono::microseconds> total;
+        for (const auto& test : module.tests) {
+            if (test.duration.has_value()) {
+                total = total.value_or(std::chrono::microseconds{}) + *test.duration;
+                timed.push_back(&test);
+            }
+        }
+        if (total.has_value()) {
+            summary.modules.push_back(ModuleDuration{.module_id = module.module_id, .duration = *total});
+        }
+    }
+    if (timed.empty()) {
+        return std::nullopt;
+    }
+
+    const auto count = std::min(slowest_count, timed.size());
+    std::partial_sort(timed.begin(), timed.begin() + static_cast<std::ptrdiff_t>(count), timed.end(),
+                      [](const TestResult* a, const TestResult* b) {
+                          return a->duration != b->duration ? a->duration > b->duration
+                                                            : a->full_name < b->full_name;
+                      });
+    summary.slowest.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        summary.slowest.push_back(TimedTest{.full_name = timed[i]->full_name, .duration = *timed[i]->duration});
+    }
+    return summary;
 }
 
 auto transform_events(
-    const std::vector<TestEvent>& events,
-    const std::vector<CompilationError>& compilation_errors
+    std::vector<TestEvent> events,
+    const std::vector<CompilationError>& compilation_errors,
+    unsigned threads
 ) -> TddGuardOutput {
-    std::map<std::string, TestModule> modules;
+    ModuleGroups groups;
     bool has_failure = false;
 
     if (!compilation_errors.empty()) {
-        auto& module = modules["compilation"];
-        module.module_id = "compilation";
-
         std::vector<TestError> errors;
+        errors.reserve(compilation_errors.size());
         for (const auto& error : compilation_errors) {
             errors.push_back(format_compilation_error(error));
         }
 
-        module.tests.push_back(TestResult{
+        groups.module_for("compilation").tests.push_back(TestResult{
             .name = "build",
             .full_name = "compilation::build",
-            .state = "failed",
+            .state = TestEvent::State::Failed,
             .errors = std::move(errors)
         });
         has_failure = true;
     }
 
-    for (const auto& event : events) {
-        std::string module_name = Parser::extract_module(event.full_name);
-        auto& module = modules[module_name];
-        module.module_id = module_name;
-
-        std::string state = state_to_string(event.state);
-        if (state == "failed") has_failure = true;
-
-        std::vector<TestError> errors;
-        if (event.state == TestEvent::State::Failed) {
-            auto error_msg = event.error_message();
-            if (error_msg.has_value()) {
-                errors.push_back(TestError{.message = *error_msg});
-            }
+    const auto chunks = std::min<std::size_t>(threads, events.size() / MIN_EVENTS_PER_THREAD);
+    if (chunks > 1) {
+        // Each thread groups a contiguous slice. Merging the slices in order
+        // keeps every module's tests in event order, as one thread would.
+        std::vector<ModuleGroups> partial(chunks);
+        std::vector<char> failed(chunks, 0);
+        std::vector<std::thread> workers;
+        workers.reserve(chunks);
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            workers.emplace_back([&, chunk] {
+                const auto begin = events.size() * chunk / chunks;
+                const auto end = events.size() * (chunk + 1) / chunks;
+                failed[chunk] = group_events(std::span(events).subspan(begin, end - begin), partial[chunk]);
+                partial[chunk].repair_tests();
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
         }
 
-        module.tests.push_back(TestResult{
-            .name = Parser::extract_simple_name(event.full_name),
-            .full_name = event.full_name,
-            .state = state,
-            .errors = std::move(errors)
-        });
-    }
-
-    std::vector<TestModule> sorted_modules;
-    for (auto& [_, module] : modules) {
-        sorted_modules.push_back(std::move(module));
+        groups.repair_tests();
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            groups.merge(std::move(partial[chunk]));
+            has_failure = has_failure || failed[chunk] != 0;
+        }
+    } else {
+        has_failure = group_events(events, groups) || has_failure;
+        groups.repair_tests();
     }
-    std::sort(sorted_modules.begin(), sorted_modules.end(),
-              [](const auto& a, const auto& b) {
-                  return a.module_id < b.module_id;
-              });
-
-    std::string reason_str = has_failure ? "failed" : "passed";
 
+    auto modules = groups.take_sorted();
+    auto timing = summarize_durations(modules, SLOWEST_TEST_COUNT);
     return TddGuardOutput{
-        .test_modules = std::move(sorted_modules),
-        .reason = reason_str
+        .test_modules = std::move(modules),
+        .reason = has_failure ? "failed" : "passed",
+        .timing = std::move(timing)
     };
 }
 
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "error_parser.hpp"
+#include "json_writer.hpp"
 #include "parser.hpp"
+#include <chrono>
+#include <cstddef>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace tdd_guard {
@@ -21,8 +25,9 @@ struct TestError {
 struct TestResult {
     std::string name;
     std::string full_name;
-    std::string state;
+    TestEvent::State state = TestEvent::State::Unknown;
     std::vector<TestError> errors;
+    std::optional<std::chrono::microseconds> duration = std::nullopt;
 };
 
 struct TestModule {
@@ -30,16 +35,75 @@ struct TestModule {
     std::vector<TestResult> tests;
 };
 
+struct TimedTest {
+    std::string full_name;
+    std::chrono::microseconds duration{};
+};
+
+struct ModuleDuration {
+    std::string module_id;
+    std::chrono::microseconds duration{};
+};
+
+// Where the time of a run went, from the tests that reported a duration
+struct TimingSummary {
+    // Slowest first; ties in name order
+    std::vector<TimedTest> slowest;
+    // Sum over each module's timed tests, in module order
+    std::vector<ModuleDuration> modules;
+};
+
+// How a test binary started by the reporter ended: with an exit code, or
+// killed by a signal
+struct ProcessExit {
+    std::optional<int> exit_code = std::nullopt;
+    std::optional<int> signal = std::nullopt;
+};
+
 struct TddGuardOutput {
     std::vector<TestModule> test_modules;
     std::optional<std::string> reason;
+    std::optional<TimingSummary> timing = std::nullopt;
+    std::optional<ProcessExit> process = std::nullopt;
 
     [[nodiscard]] auto to_json() const -> std::string;
+    // Streams the same document to_json() returns
+    auto write_json(JsonWriter& writer) const -> void;
 };
 
+// Number of tests listed in TimingSummary::slowest by transform_events
+constexpr std::size_t SLOWEST_TEST_COUNT = 10;
+
+// Empty when no test reported a duration
+[[nodiscard]] auto summarize_durations(const std::vector<TestModule>& modules, std::size_t slowest_count)
+    -> std::optional<TimingSummary>;
+
+// The name a state is serialized as
+[[nodiscard]] auto state_name(TestEvent::State state) -> std::string_view;
+// The state state_name serialized as name; empty for any other name
+[[nodiscard]] auto parse_state(std::string_view name) -> std::optional<TestEvent::State>;
+
+// Records how the test binary ended. A run that did not exit with 0 failed,
+// whatever its tests reported.
+auto record_process_exit(TddGuardOutput& output, const ProcessExit& exit) -> void;
+
+// The worse of two endings: a signal outranks any exit code, and a higher
+// exit code a lower one
+[[nodiscard]] auto worst_exit(const ProcessExit& a, const ProcessExit& b) -> ProcessExit;
+
+// Joins the reports of separate runs, such as one per test binary, into the
+// report of a single run: modules of the same name are merged in order, the
+// timing is summarized afresh, and the run failed if any part did or ended
+// badly. The parts' endings are combined with worst_exit.
+[[nodiscard]] auto merge_outputs(std::vector<TddGuardOutput> parts) -> TddGuardOutput;
+
+// Takes the events by value so callers that are done with them can move
+// them in and have their strings reused. With threads > 1, large result
+// sets are grouped in parallel; the output is the same either way.
 [[nodiscard]] auto transform_events(
-    const std::vector<TestEvent>& events,
-    const std::vector<CompilationError>& compilation_errors
+    std::vector<TestEvent> events,
+    const std::vector<CompilationError>& compilation_errors,
+    unsigned threads = 1
 ) -> TddGuardOutput;
 
 } // namespace tdd_guard
@@ -0,0 +1,280 @@
+#include "utf8.hpp"
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define TDD_GUARD_X86_SIMD 1
+#endif
+
+namespace tdd_guard {
+
+namespace {
+
+constexpr std::string_view REPLACEMENT = "\xEF\xBF\xBD";
+
+// Offset of the first byte at or after start with the high bit set
+auto skip_ascii(std::string_view text, std::size_t start) -> std::size_t {
+    std::size_t i = start;
+#ifdef TDD_GUARD_X86_SIMD
+    for (; i + 16 <= text.size(); i += 16) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+        if (const auto high = static_cast<unsigned>(_mm_movemask_epi8(v)); high != 0) {
+            return i + static_cast<std::size_t>(__builtin_ctz(high));
+        }
+    }
+#else
+    for (; i + 8 <= text.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, text.data() + i, sizeof(word));
+        if ((word & 0x8080808080808080ULL) != 0) {
+            break;
+        }
+    }
+#endif
+    while (i < text.size() && static_cast<unsigned char>(text[i]) < 0x80) {
+        ++i;
+    }
+    return i;
+}
+
+// Checks the sequence starting at text[start] against Table 3-7 of the
+// Unicode standard. Sets length to the sequence length when it is well
+// formed, otherwise to the length of its maximal ill-formed prefix.
+auto check_sequence(std::string_view text, std::size_t start, std::size_t& length) -> bool {
+    const auto lead = static_cast<unsigned char>(text[start]);
+    unsigned low = 0x80;
+    unsigned high = 0xBF;
+    std::size_t trailing = 0;
+
+    length = 1;
+    if (lead < 0x80) {
+        return true;
+    } else if (lead >= 0xC2 && lead <= 0xDF) {
+        trailing = 1;
+    } else if (lead == 0xE0) {
+        trailing = 2;
+        low = 0xA0;
+    } else if (lead == 0xED) {
+        trailing = 2;
+        high = 0x9F;
+    } else if (lead >= 0xE1 && lead <= 0xEF) {
+        trailing = 2;
+    } else if (lead == 0xF0) {
+        trailing = 3;
+        low = 0x90;
+    } else if (lead == 0xF4) {
+        trailing = 3;
+        high = 0x8F;
+    } else if (lead >= 0xF1 && lead <= 0xF3) {
+        trailing = 3;
+    } else {
+        return false;
+    }
+
+    for (; trailing > 0; --trailing) {
+        if (start + length >= text.size()) {
+            return false;
+        }
+        const auto next = static_cast<unsigned char>(text[start + length]);
+        if (next < low || next > high) {
+            return false;
+        }
+        ++length;
+        low = 0x80;
+        high = 0xBF;
+    }
+    return true;
+}
+
+// Offset of the first ill-formed sequence, or text.size()
+auto find_invalid(std::string_view text, std::size_t start) -> std::size_t {
+    std::size_t i = skip_ascii(text, start);
+    while (i < text.size()) {
+        std::size_t length = 0;
+        if (!check_sequence(text, i, length)) {
+            return i;
+        }
+        i = skip_ascii(text, i + length);
+    }
+    return i;
+}
+
+#ifdef TDD_GUARD_X86_SIMD
+
+// The lookup validator of Keiser and Lemire, "Validating UTF-8 in less
+// than one instruction per byte". Each byte pair is classified by three
+// table lookups whose AND is non-zero exactly when the pair cannot occur;
+// the remaining length errors come from the bytes two and three back.
+namespace avx2 {
+
+constexpr std::uint8_t TOO_SHORT = 1 << 0;
+constexpr std::uint8_t TOO_LONG = 1 << 1;
+constexpr std::uint8_t OVERLONG_3 = 1 << 2;
+constexpr std::uint8_t TOO_LARGE = 1 << 3;
+constexpr std::uint8_t SURROGATE = 1 << 4;
+constexpr std::uint8_t OVERLONG_2 = 1 << 5;
+constexpr std::uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr std::uint8_t OVERLONG_4 = 1 << 6;
+constexpr std::uint8_t TWO_CONTS = 1 << 7;
+constexpr std::uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+__attribute__((target("avx2")))
+inline auto table(std::uint8_t b0, std::uint8_t b1, std::uint8_t b2, std::uint8_t b3,
+                  std::uint8_t b4, std::uint8_t b5, std::uint8_t b6, std::uint8_t b7,
+                  std::uint8_t b8, std::uint8_t b9, std::uint8_t b10, std::uint8_t b11,
+                  std::uint8_t b12, std::uint8_t b13, std::uint8_t b14, std::uint8_t b15) -> __m256i {
+    return _mm256_setr_epi8(
+        static_cast<char>(b0), static_cast<char>(b1), static_cast<char>(b2), static_cast<char>(b3),
+        static_cast<char>(b4), static_cast<char>(b5), static_cast<char>(b6), static_cast<char>(b7),
+        static_cast<char>(b8), static_cast<char>(b9), static_cast<char>(b10), static_cast<char>(b11),
+        static_cast<char>(b12), static_cast<char>(b13), static_cast<char>(b14), static_cast<char>(b15),
+        static_cast<char>(b0), static_cast<char>(b1), static_cast<char>(b2), static_cast<char>(b3),
+        static_cast<char>(b4), static_cast<char>(b5), static_cast<char>(b6), static_cast<char>(b7),
+        static_cast<char>(b8), static_cast<char>(b9), static_cast<char>(b10), static_cast<char>(b11),
+        static_cast<char>(b12), static_cast<char>(b13), static_cast<char>(b14), static_cast<char>(b15));
+}
+
+__attribute__((target("avx2")))
+inline auto high_nibbles(__m256i v) -> __m256i {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+// The input shifted right by N bytes, continuing from the previous block
+template<int N>
+__attribute__((target("avx2")))
+inline auto previous(__m256i input, __m256i prev_input) -> __m256i {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2")))
+inline auto check_block(__m256i input, __m256i prev_input) -> __m256i {
+    const auto prev1 = previous<1>(input, prev_input);
+    const auto byte_1_high = _mm256_shuffle_epi8(table(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4), high_nibbles(prev1));
+    const auto byte_1_low = _mm256_shuffle_epi8(table(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000), _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)));
+    const auto byte_2_high = _mm256_shuffle_epi8(table(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT), high_nibbles(input));
+    const auto special_cases = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    // Bytes two or three after a three or four byte lead must continue it
+    const auto third = _mm256_subs_epu8(previous<2>(input, prev_input), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+    const auto fourth = _mm256_subs_epu8(previous<3>(input, prev_input), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+    const auto must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must_continue, special_cases);
+}
+
+// Non-zero when the block ends inside a multi-byte sequence
+__attribute__((target("avx2")))
+inline auto incomplete(__m256i input) -> __m256i {
+    const auto max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+struct State {
+    __m256i error;
+    __m256i prev_input;
+    __m256i prev_incomplete;
+};
+
+__attribute__((target("avx2")))
+inline auto check(State& state, __m256i input) -> void {
+    if (_mm256_movemask_epi8(input) == 0) {
+        // ASCII cannot continue a sequence left open by the last block
+        state.error = _mm256_or_si256(state.error, state.prev_incomplete);
+    } else {
+        state.error = _mm256_or_si256(state.error, check_block(input, state.prev_input));
+        state.prev_incomplete = incomplete(input);
+    }
+    state.prev_input = input;
+}
+
+__attribute__((target("avx2")))
+auto validate(std::string_view text) -> bool {
+    State state{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+
+    std::size_t i = 0;
+    for (; i + 32 <= text.size(); i += 32) {
+        check(state, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + i)));
+    }
+    // Zero padding is ASCII, so it also reports a sequence cut off at the end
+    alignas(32) char tail[32] = {};
+    if (i < text.size()) {
+        std::memcpy(tail, text.data() + i, text.size() - i);
+    }
+    check(state, _mm256_load_si256(reinterpret_cast<const __m256i*>(tail)));
+    check(state, _mm256_setzero_si256());
+
+    return _mm256_testz_si256(state.error, state.error) != 0;
+}
+
+} // namespace avx2
+
+#endif
+
+} // anonymous namespace
+
+auto is_valid_utf8(std::string_view text) -> bool {
+#ifdef TDD_GUARD_X86_SIMD
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") != 0;
+    if (has_avx2) {
+        return avx2::validate(text);
+    }
+#endif
+    return find_invalid(text, 0) == text.size();
+}
+
+auto repair_utf8(std::string& text) -> bool {
+    if (is_valid_utf8(text)) {
+        return false;
+    }
+    std::size_t invalid = find_invalid(text, 0);
+
+    std::string repaired;
+    repaired.reserve(text.size() + REPLACEMENT.size());
+    std::size_t copied = 0;
+    while (invalid < text.size()) {
+        std::size_t length = 0;
+        (void)check_sequence(text, invalid, length);
+        repaired.append(text, copied, invalid - copied);
+        repaired.append(REPLACEMENT);
+        copied = invalid + length;
+        invalid = find_invalid(text, copied);
+    }
+    repaired.append(text, copied, std::string::npos);
+
+    text = std::move(repaired);
+    return true;
+}
+
+} // namespace tdd_guard
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace tdd_guard {
+
+// True when text is well-formed UTF-8: no overlong forms, surrogates or
+// code points past U+10FFFF. ASCII is skipped 16 bytes at a time.
+[[nodiscard]] auto is_valid_utf8(std::string_view text) -> bool;
+
+// Replaces each maximal ill-formed subsequence of text with U+FFFD, as the
+// Unicode standard recommends, so binary output and Latin-1 paths still
+// serialize. Leaves valid text untouched and returns whether it changed.
+auto repair_utf8(std::string& text) -> bool;
+
+} // namespace tdd_guard
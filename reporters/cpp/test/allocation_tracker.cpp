@@ -0,0 +1,101 @@
+#include "allocation_tracker.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::size_t> current_bytes{0};
+std::atomic<std::size_t> peak_bytes{0};
+std::atomic<std::size_t> allocation_count{0};
+
+// Each block is prefixed with its size so frees can be accounted for
+constexpr std::size_t HEADER_SIZE = alignof(std::max_align_t);
+
+auto tracked_alloc(std::size_t size) -> void* {
+    void* raw = std::malloc(size + HEADER_SIZE);
+    if (raw == nullptr) {
+        return nullptr;
+    }
+    *static_cast<std::size_t*>(raw) = size;
+
+    const auto current = current_bytes.fetch_add(size) + size;
+    auto peak = peak_bytes.load();
+    while (current > peak && !peak_bytes.compare_exchange_weak(peak, current)) {
+    }
+    allocation_count.fetch_add(1);
+
+    return static_cast<char*>(raw) + HEADER_SIZE;
+}
+
+auto tracked_free(void* ptr) -> void {
+    if (ptr == nullptr) {
+        return;
+    }
+    void* raw = static_cast<char*>(ptr) - HEADER_SIZE;
+    current_bytes.fetch_sub(*static_cast<std::size_t*>(raw));
+    std::free(raw);
+}
+
+} // anonymous namespace
+
+void* operator new(std::size_t size) {
+    if (void* ptr = tracked_alloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return tracked_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return tracked_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    tracked_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    tracked_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    tracked_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    tracked_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    tracked_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    tracked_free(ptr);
+}
+
+namespace tdd_guard::testing {
+
+AllocationScope::AllocationScope()
+    : baseline_bytes_(current_bytes.load()),
+      baseline_count_(allocation_count.load()) {
+    peak_bytes.store(baseline_bytes_);
+}
+
+auto AllocationScope::stats() const -> AllocationStats {
+    const auto peak = peak_bytes.load();
+    return AllocationStats{
+        .count = allocation_count.load() - baseline_count_,
+        .peak_bytes = peak > baseline_bytes_ ? peak - baseline_bytes_ : 0
+    };
+}
+
+} // namespace tdd_guard::testing
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+namespace tdd_guard::testing {
+
+struct AllocationStats {
+    std::size_t count = 0;
+    std::size_t peak_bytes = 0;
+};
+
+// Measures heap usage through the replaced global operator new from the
+// point of construction. Scopes must not be nested.
+class AllocationScope {
+public:
+    AllocationScope();
+
+    [[nodiscard]] auto stats() const -> AllocationStats;
+
+private:
+    std::size_t baseline_bytes_;
+    std::size_t baseline_count_;
+};
+
+} // namespace tdd_guard::testing
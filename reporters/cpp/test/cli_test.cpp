@@ -0,0 +1,67 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include "input_buffer.hpp"
+#include "runner.hpp"
+#include "test_support.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Catch::Matchers::ContainsSubstring;
+
+namespace {
+
+struct Reporter {
+    int status = -1;
+    std::string errors;
+};
+
+// Runs the reporter built with the tests, with args after --project-root
+auto run_reporter(const std::string& root, std::vector<std::string> args) -> Reporter {
+    args.insert(args.begin(), {TDD_GUARD_CPP_BINARY, "--project-root", root});
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    tdd_guard::InputBuffer output;
+    tdd_guard::InputBuffer errors;
+    std::ostringstream err;
+    const auto exit = tdd_guard::run_child(argv, -1, -1, output, errors, {}, err);
+    REQUIRE(exit.has_value());
+    return {.status = tdd_guard::exit_status(*exit), .errors = std::string(errors.content())};
+}
+
+} // anonymous namespace
+
+TEST_CASE("a malformed --jobs count is reported", "[cli]") {
+    tdd_guard::testing::TempDir dir;
+
+    for (const auto* count : {"abc", "-3", "4x", ""}) {
+        const auto run = run_reporter(dir.path.string(), {"run", "--jobs", count, "--", "/bin/true"});
+        CHECK(run.status == 1);
+        CHECK_THAT(run.errors, ContainsSubstring("--jobs takes a number"));
+    }
+}
+
+TEST_CASE("ways of running that do not combine are rejected", "[cli]") {
+    tdd_guard::testing::TempDir dir;
+    const auto root = dir.path.string();
+
+    const auto both = run_reporter(root, {"run", "--jobs", "2", "--cache", "--", "/bin/true"});
+    CHECK(both.status == 1);
+    CHECK_THAT(both.errors, ContainsSubstring("--jobs and --cache cannot be combined"));
+
+    const auto impact = run_reporter(root, {"run", "--impact", "build", "--jobs", "2", "--", "/bin/true"});
+    CHECK(impact.status == 1);
+    CHECK_THAT(impact.errors, ContainsSubstring("--impact and --jobs cannot be combined"));
+
+    const auto without_run = run_reporter(root, {"--passthrough", "--cache"});
+    CHECK(without_run.status == 1);
+    CHECK_THAT(without_run.errors, ContainsSubstring("--cache needs run"));
+
+    const auto rerun = run_reporter(root, {"run", "--rerun", "--", "/bin/true"});
+    CHECK(rerun.status == 1);
+    CHECK_THAT(rerun.errors, ContainsSubstring("--rerun needs --cache"));
+
+    CHECK(run_reporter(root, {"run", "--jobs", "2", "--", "/bin/true"}).status == 0);
+}
@@ -0,0 +1,170 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include "daemon.hpp"
+#include "test_support.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using tdd_guard::testing::Pipe;
+using tdd_guard::testing::TempDir;
+using tdd_guard::testing::read_file;
+
+// A daemon serving on its own thread for the length of a test
+struct ServingDaemon {
+    tdd_guard::Daemon daemon;
+    std::thread thread;
+
+    explicit ServingDaemon(const fs::path& socket, std::uint64_t build = tdd_guard::build_identity())
+        : daemon(build) {
+        std::ostringstream err;
+        REQUIRE(daemon.listen(socket, err));
+        thread = std::thread([this] { daemon.serve(); });
+    }
+
+    ~ServingDaemon() {
+        daemon.stop();
+        thread.join();
+    }
+};
+
+struct Run {
+    std::optional<int> status;
+    std::string forwarded;
+    std::string errors;
+};
+
+// Small enough inputs to fit in the pipes, so nothing needs draining while
+// the run is in progress
+auto run_through(const fs::path& socket, const std::string& root, const std::string& input) -> Run {
+    Pipe in;
+    Pipe out;
+    REQUIRE(::write(in.write_fd, input.data(), input.size()) == static_cast<ssize_t>(input.size()));
+    in.close_write();
+
+    Run run;
+    std::ostringstream err;
+    run.status = tdd_guard::run_with_daemon(socket, root, in.read_fd, out.write_fd, {}, err);
+    run.errors = err.str();
+
+    run.forwarded = out.drain();
+    return run;
+}
+
+const std::string GOOGLETEST_OUTPUT =
+    R"({"testsuites": [{"name": "Math", "testsuite": [{"name": "Adds", "status": "RUN", "result": "COMPLETED"}]}]})"
+    "\n";
+
+} // anonymous namespace
+
+TEST_CASE("daemon forwards and saves runs for its clients", "[daemon]") {
+    TempDir dir;
+    const auto socket = dir.path / "daemon.sock";
+    ServingDaemon serving(socket);
+
+    // The second run reuses the results directory cached by the first
+    for (int i = 0; i < 2; ++i) {
+        const auto run = run_through(socket, dir.path.string(), GOOGLETEST_OUTPUT);
+
+        REQUIRE(run.status == 0);
+        CHECK(run.forwarded == GOOGLETEST_OUTPUT);
+        CHECK(run.errors.empty());
+        const auto saved = read_file(dir.path / ".claude" / "tdd-guard" / "data" / "test.json");
+        CHECK_THAT(saved, Catch::Matchers::ContainsSubstring(R"("fullName":"Math.Adds")"));
+        fs::remove(dir.path / ".claude" / "tdd-guard" / "data" / "test.json");
+    }
+}
+
+TEST_CASE("daemon recreates a results directory removed between runs", "[daemon]") {
+    TempDir dir;
+    const auto socket = dir.path / "daemon.sock";
+    ServingDaemon serving(socket);
+
+    REQUIRE(run_through(socket, dir.path.string(), GOOGLETEST_OUTPUT).status == 0);
+    fs::remove_all(dir.path / ".claude");
+
+    REQUIRE(run_through(socket, dir.path.string(), GOOGLETEST_OUTPUT).status == 0);
+    CHECK(fs::exists(dir.path / ".claude" / "tdd-guard" / "data" / "test.json"));
+}
+
+TEST_CASE("daemon reports invalid project roots like an in-process run", "[daemon]") {
+    TempDir dir;
+    const auto socket = dir.path / "daemon.sock";
+    ServingDaemon serving(socket);
+
+    const auto run = run_through(socket, "relative/root", GOOGLETEST_OUTPUT);
+
+    CHECK(run.status == 1);
+    CHECK_THAT(run.errors, Catch::Matchers::ContainsSubstring("must be an absolute path"));
+}
+
+TEST_CASE("clients fall back when no daemon is listening", "[daemon]") {
+    TempDir dir;
+    Pipe in;
+    Pipe out;
+    std::ostringstream err;
+
+    const auto status = tdd_guard::run_with_daemon(dir.path / "missing.sock", dir.path.string(), in.read_fd,
+                                                   out.write_fd, {}, err);
+
+    CHECK_FALSE(status.has_value());
+    CHECK(err.str().empty());
+}
+
+TEST_CASE("clients fall back when the daemon runs another build", "[daemon]") {
+    TempDir dir;
+    const auto socket = dir.path / "daemon.sock";
+    ServingDaemon serving(socket, tdd_guard::build_identity() + 1);
+
+    const auto run = run_through(socket, dir.path.string(), GOOGLETEST_OUTPUT);
+
+    // Nothing was read, so the client can run in-process
+    CHECK_FALSE(run.status.has_value());
+    CHECK(run.errors.empty());
+    CHECK(run.forwarded.empty());
+    CHECK_FALSE(fs::exists(dir.path / ".claude"));
+}
+
+TEST_CASE("daemon stops while a client has sent nothing", "[daemon]") {
+    TempDir dir;
+    const auto socket = dir.path / "daemon.sock";
+    auto serving = std::make_unique<ServingDaemon>(socket);
+    const int client = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    REQUIRE(client >= 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket.c_str(), sizeof(address.sun_path) - 1);
+    REQUIRE(::connect(client, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+    // Let the daemon start waiting for the request
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const auto start = std::chrono::steady_clock::now();
+    serving.reset();
+    const auto stopping = std::chrono::steady_clock::now() - start;
+    ::close(client);
+
+    CHECK(stopping < std::chrono::seconds(2));
+}
+
+TEST_CASE("only one daemon listens on a socket", "[daemon]") {
+    TempDir dir;
+    const auto socket = dir.path / "daemon.sock";
+    ServingDaemon serving(socket);
+
+    tdd_guard::Daemon second;
+    std::ostringstream err;
+    CHECK_FALSE(second.listen(socket, err));
+    CHECK_THAT(err.str(), Catch::Matchers::ContainsSubstring("already listening"));
+}
@@ -138,6 +138,27 @@ TEST_CASE("fallback creates generic error when no structured parse", "[error_par
     CHECK(errors[0].note.has_value());
 }
 
+TEST_CASE("find error marker", "[error_parser]") {
+    CHECK(tdd_guard::find_error_marker("main.cpp:3:1: error: boom") == 14);
+    CHECK(tdd_guard::find_error_marker("file(7): error C2065: x") == 9);
+    CHECK(tdd_guard::find_error_marker("Errors: 0, warnings: 0") == std::string_view::npos);
+    CHECK(tdd_guard::find_error_marker("") == std::string_view::npos);
+}
+
+TEST_CASE("notes without an error marker still attach to the open error", "[error_parser]") {
+    std::vector<std::string> lines = {
+        "note: nothing to attach to",
+        "src/main.cpp:10:5: error: no matching function for call to 'f'",
+        "In file included from src/main.cpp:1: note: not a note",
+        "  note: candidate: 'void f(int)'"
+    };
+
+    auto errors = tdd_guard::parse_error_buffer(lines);
+
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].note == "candidate: 'void f(int)'");
+}
+
 TEST_CASE("empty input returns empty errors", "[error_parser]") {
     std::vector<std::string> lines = {};
 
@@ -171,3 +192,118 @@ TEST_CASE("parse GCC fatal error format", "[error_parser]") {
     CHECK(errors[0].column == 10);
     CHECK(errors[0].message == "nonexistent_header.hpp: No such file or directory");
 }
+
+TEST_CASE("file name is the shortest prefix that matches", "[error_parser]") {
+    std::vector<std::string> lines = {
+        "C:\\src\\main.cpp:7:3: error: expected ';'"
+    };
+
+    auto errors = tdd_guard::parse_error_buffer(lines);
+
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].file == "C:\\src\\main.cpp");
+    CHECK(errors[0].line == 7);
+    CHECK(errors[0].column == 3);
+}
+
+TEST_CASE("full location wins over an earlier location without column", "[error_parser]") {
+    std::vector<std::string> lines = {
+        "a.cpp:1: x b.cpp:2:3: error: late"
+    };
+
+    auto errors = tdd_guard::parse_error_buffer(lines);
+
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].file == "a.cpp:1: x b.cpp");
+    CHECK(errors[0].column == 3);
+}
+
+TEST_CASE("message stops at a carriage return", "[error_parser]") {
+    std::vector<std::string> lines = {
+        "main.cpp:3:1: error: unterminated\r"
+    };
+
+    auto errors = tdd_guard::parse_error_buffer(lines);
+
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].message == "unterminated");
+}
+
+TEST_CASE("oversized line numbers clamp instead of failing", "[error_parser]") {
+    std::vector<std::string> lines = {
+        "main.cpp:99999999999999999999999:1: error: huge"
+    };
+
+    auto errors = tdd_guard::parse_error_buffer(lines);
+
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].line == UINT32_MAX);
+}
+
+TEST_CASE("pathological lines are parsed in linear time", "[error_parser][pathological]") {
+    constexpr std::size_t SIZE = 1024 * 1024;
+
+    SECTION("multi-megabyte template signature") {
+        std::string signature;
+        while (signature.size() < SIZE) signature += "std::vector<std::pair<int, ";
+        std::vector<std::string> lines = {"main.cpp:1:2: error: " + signature};
+
+        auto errors = tdd_guard::parse_error_buffer(lines);
+
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].message.size() == signature.size());
+    }
+
+    SECTION("colons and digits that never reach an error") {
+        std::string line;
+        while (line.size() < SIZE) line += "1:22:";
+        std::vector<std::string> lines = {line};
+
+        CHECK(tdd_guard::parse_error_buffer(lines).empty());
+    }
+
+    SECTION("long whitespace runs between location and keyword") {
+        std::vector<std::string> lines = {
+            "a:1:" + std::string(SIZE, ' ') + "x",
+            "a(1):" + std::string(SIZE, '\t') + "error" + std::string(SIZE, ' ') + "D1: x",
+        };
+
+        CHECK(tdd_guard::parse_error_buffer(lines).empty());
+    }
+
+    SECTION("keyword followed only by whitespace") {
+        std::vector<std::string> lines = {"error:" + std::string(SIZE, ' ')};
+
+        auto errors = tdd_guard::parse_error_buffer(lines);
+
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].message == " ");
+    }
+
+    SECTION("many parentheses and notes") {
+        std::string parens;
+        while (parens.size() < SIZE) parens += "f(1)(";
+        std::vector<std::string> lines = {
+            "main.cpp:4: error: first",
+            parens,
+            std::string(SIZE, ' ') + "note:" + std::string(SIZE, ' ') + "spaced",
+        };
+
+        auto errors = tdd_guard::parse_error_buffer(lines);
+
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].note == "spaced");
+    }
+}
+
+TEST_CASE("strip only color sequences", "[error_parser]") {
+    std::vector<std::string> lines = {
+        "\x1b[01mmain.cpp:3:1:\x1b[m \x1b[01;31merror: \x1b[mbad\x1b[K\x1b[1;2"
+    };
+
+    auto errors = tdd_guard::parse_error_buffer(lines);
+
+    REQUIRE(errors.size() == 1);
+    CHECK(errors[0].file == "main.cpp");
+    CHECK(errors[0].message == "bad\x1b[K\x1b[1;2");
+}
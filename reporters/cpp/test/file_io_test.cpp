@@ -0,0 +1,103 @@
+#include <catch2/catch_test_macros.hpp>
+#include "file_io.hpp"
+#include "test_support.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using tdd_guard::testing::TempDir;
+using tdd_guard::testing::read_file;
+
+namespace {
+
+auto entries(const fs::path& dir) -> std::size_t {
+    return static_cast<std::size_t>(std::distance(fs::directory_iterator(dir), fs::directory_iterator()));
+}
+
+} // anonymous namespace
+
+TEST_CASE("replaced files hold the new content and nothing is left beside them", "[file_io]") {
+    TempDir dir;
+    std::ofstream(dir.path / "data.json") << "old";
+    const int dir_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(dir_fd >= 0);
+
+    CHECK(tdd_guard::replace_file(dir_fd, "data.json", "new"));
+    ::close(dir_fd);
+
+    CHECK(read_file(dir.path / "data.json") == "new");
+    CHECK(entries(dir.path) == 1);
+}
+
+TEST_CASE("a failed write keeps the old file and removes the temp file", "[file_io]") {
+    TempDir dir;
+    std::ofstream(dir.path / "data.json") << "old";
+    const int dir_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(dir_fd >= 0);
+
+    const bool replaced = tdd_guard::replace_file_with(dir_fd, "data.json", [](int fd) {
+        (void)tdd_guard::write_all(fd, "partial");
+        errno = ENOSPC;
+        return false;
+    });
+    const int error = errno;
+    ::close(dir_fd);
+
+    CHECK_FALSE(replaced);
+    CHECK(error == ENOSPC);
+    CHECK(read_file(dir.path / "data.json") == "old");
+    CHECK(entries(dir.path) == 1);
+}
+
+TEST_CASE("a failed rename removes the temp file", "[file_io]") {
+    TempDir dir;
+    fs::create_directories(dir.path / "data.json" / "busy");
+    const int dir_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(dir_fd >= 0);
+
+    CHECK_FALSE(tdd_guard::replace_file(dir_fd, "data.json", "new"));
+    ::close(dir_fd);
+
+    CHECK(fs::is_directory(dir.path / "data.json"));
+    CHECK(entries(dir.path) == 1);
+}
+
+TEST_CASE("concurrent replacements of one file never mix their content", "[file_io]") {
+    TempDir dir;
+    const int dir_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(dir_fd >= 0);
+    constexpr int writers = 4;
+    constexpr int rounds = 50;
+
+    std::vector<std::thread> threads;
+    std::atomic<int> failures{0};
+    for (int writer = 0; writer < writers; ++writer) {
+        threads.emplace_back([&, writer] {
+            const std::string content(256 * 1024, static_cast<char>('a' + writer));
+            for (int round = 0; round < rounds; ++round) {
+                if (!tdd_guard::replace_file(dir_fd, "data.json", content)) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ::close(dir_fd);
+
+    CHECK(failures == 0);
+    const auto content = read_file(dir.path / "data.json");
+    REQUIRE(content.size() == 256 * 1024);
+    CHECK(std::all_of(content.begin(), content.end(), [&](char c) { return c == content.front(); }));
+    CHECK(entries(dir.path) == 1);
+}
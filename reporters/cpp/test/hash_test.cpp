@@ -0,0 +1,22 @@
+#include <catch2/catch_test_macros.hpp>
+#include "hash.hpp"
+#include <string>
+
+TEST_CASE("hash64 matches the XXH64 reference", "[hash]") {
+    CHECK(tdd_guard::hash64("") == 0xef46db3751d8e999);
+    CHECK(tdd_guard::hash64("a") == 0xd24ec4f1a98c6e5b);
+    CHECK(tdd_guard::hash64("abc") == 0x44bc2cf5ad770999);
+    // Long enough for the four-lane loop
+    CHECK(tdd_guard::hash64("Nobody inspects the spammish repetition") == 0xfbcea83c8a378bf1);
+}
+
+TEST_CASE("hash64 sees every byte and the seed", "[hash]") {
+    std::string data(1000, 'x');
+    const auto hash = tdd_guard::hash64(data);
+    data[999] = 'y';
+    CHECK(tdd_guard::hash64(data) != hash);
+    data[999] = 'x';
+    data[0] = 'y';
+    CHECK(tdd_guard::hash64(data) != hash);
+    CHECK(tdd_guard::hash64("abc", 1) != tdd_guard::hash64("abc"));
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch_test_macros.hpp>
+#include "history.hpp"
+#include "transformer.hpp"
+
+using std::chrono::microseconds;
+
+TEST_CASE("history reads the tests a run saved", "[history]") {
+    std::vector<tdd_guard::TestEvent> events = {
+        {.name = "Adds", .full_name = "Math.Adds", .state = tdd_guard::TestEvent::State::Passed,
+         .duration = microseconds(2500)},
+        {.name = "Divides", .full_name = "Math.Divides", .state = tdd_guard::TestEvent::State::Failed,
+         .failure_messages = {"expected 2"}},
+        {.name = "first", .full_name = "case/first", .state = tdd_guard::TestEvent::State::Passed,
+         .duration = microseconds(1000)},
+        {.name = "second", .full_name = "case/second", .state = tdd_guard::TestEvent::State::Skipped,
+         .duration = microseconds(3000)}
+    };
+    const auto json = tdd_guard::transform_events(events, {}).to_json();
+
+    const auto history = tdd_guard::TestHistory::parse(json);
+
+    REQUIRE(history.records().size() == 4);
+    const auto* adds = history.find("Math.Adds");
+    REQUIRE(adds != nullptr);
+    CHECK(adds->state == tdd_guard::TestEvent::State::Passed);
+    CHECK(adds->duration == microseconds(2500));
+    const auto* divides = history.find("Math.Divides");
+    REQUIRE(divides != nullptr);
+    CHECK(divides->state == tdd_guard::TestEvent::State::Failed);
+    CHECK_FALSE(divides->duration.has_value());
+    CHECK(history.find("Math") == nullptr);
+
+    CHECK(history.duration_of("Math.Adds") == microseconds(2500));
+    CHECK(history.duration_of("case") == microseconds(4000));
+    CHECK_FALSE(history.duration_of("Math.Divides").has_value());
+    CHECK_FALSE(history.duration_of("missing").has_value());
+}
+
+TEST_CASE("history knows which tests failed, sections included", "[history]") {
+    std::vector<tdd_guard::TestEvent> events = {
+        {.name = "Adds", .full_name = "Math.Adds", .state = tdd_guard::TestEvent::State::Passed},
+        {.name = "Divides", .full_name = "Math.Divides", .state = tdd_guard::TestEvent::State::Failed},
+        {.name = "first", .full_name = "case/first", .state = tdd_guard::TestEvent::State::Passed},
+        {.name = "second", .full_name = "case/second", .state = tdd_guard::TestEvent::State::Failed},
+        {.name = "case-b", .full_name = "case-b", .state = tdd_guard::TestEvent::State::Failed}
+    };
+    const auto history = tdd_guard::TestHistory::parse(tdd_guard::transform_events(events, {}).to_json());
+
+    CHECK(history.failed("Math.Divides"));
+    CHECK(history.failed("case"));
+    CHECK(history.failed("case-b"));
+    CHECK_FALSE(history.failed("Math.Adds"));
+    CHECK_FALSE(history.failed("Math"));
+    CHECK_FALSE(history.failed("missing"));
+}
+
+TEST_CASE("history keeps what it read before the JSON broke off", "[history]") {
+    const auto history = tdd_guard::TestHistory::parse(
+        R"({"testModules": [{"moduleId": "M", "tests": [{"fullName": "M.A", "name": "A", "state": "passed"},)"
+        R"({"fullName": "M.B", "na)");
+
+    REQUIRE(history.records().size() == 1);
+    CHECK(history.records()[0].full_name == "M.A");
+}
+
+TEST_CASE("history ignores documents of another shape", "[history]") {
+    CHECK(tdd_guard::TestHistory::parse(R"([{"fullName": "M.A"}])").records().empty());
+    CHECK(tdd_guard::TestHistory::parse(R"({"tests": [{"fullName": "M.A"}]})").records().empty());
+    CHECK(tdd_guard::TestHistory::parse("").records().empty());
+}
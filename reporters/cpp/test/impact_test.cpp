@@ -0,0 +1,287 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include "impact.hpp"
+#include "reporter.hpp"
+#include "test_support.hpp"
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Catch::Matchers::ContainsSubstring;
+
+namespace {
+
+using tdd_guard::testing::TempDir;
+using tdd_guard::testing::fake_runs;
+using tdd_guard::testing::saved_results;
+
+// A CMake build of target unit_tests from a.cpp, which includes a.h
+auto write_build(const fs::path& build) -> void {
+    fs::create_directories(build / "CMakeFiles" / "unit_tests.dir");
+    std::ofstream(build / "compile_commands.json")
+        << R"([{"directory": ")" << build.string() << R"(", "file": "../a.cpp",)"
+        << R"( "command": "c++ -MD -MT CMakeFiles/unit_tests.dir/a.cpp.o -MF CMakeFiles/unit_tests.dir/a.cpp.o.d)"
+        << R"( -o CMakeFiles/unit_tests.dir/a.cpp.o -c ../a.cpp"}])";
+    std::ofstream(build / "CMakeFiles" / "unit_tests.dir" / "a.cpp.o.d")
+        << "CMakeFiles/unit_tests.dir/a.cpp.o: ../a.cpp \\\n ../a.h\n";
+}
+
+// write_build plus a library target core from c.cpp, which includes c.h,
+// that nothing says unit_tests links
+auto write_library_build(const fs::path& build) -> void {
+    write_build(build);
+    fs::create_directories(build / "CMakeFiles" / "core.dir");
+    std::ofstream(build / "compile_commands.json")
+        << R"([{"directory": ")" << build.string() << R"(", "file": "../a.cpp",)"
+        << R"( "output": "CMakeFiles/unit_tests.dir/a.cpp.o", "command": "c++ -MD -c ../a.cpp"},)"
+        << R"( {"directory": ")" << build.string() << R"(", "file": "../c.cpp",)"
+        << R"( "output": "CMakeFiles/core.dir/c.cpp.o", "command": "c++ -MD -c ../c.cpp"}])";
+    std::ofstream(build / "CMakeFiles" / "core.dir" / "c.cpp.o.d")
+        << "CMakeFiles/core.dir/c.cpp.o: ../c.cpp \\\n ../c.h\n";
+}
+
+// What CMake's Ninja generator writes for unit_tests linking libcore.a
+constexpr std::string_view CMAKE_NINJA = R"(build CMakeFiles/core.dir/c.cpp.o: CXX_COMPILER__core ../c.cpp
+  FLAGS = -O2
+build libcore.a: CXX_STATIC_LIBRARY_LINKER__core CMakeFiles/core.dir/c.cpp.o
+build CMakeFiles/unit_tests.dir/a.cpp.o: CXX_COMPILER__unit_tests ../a.cpp $
+    || cmake_object_order_depends_target_unit_tests
+build unit_tests: CXX_EXECUTABLE_LINKER__unit_tests CMakeFiles/unit_tests.dir/a.cpp.o $
+    | libcore.a || libcore.a
+build core: phony libcore.a
+)";
+
+} // anonymous namespace
+
+TEST_CASE("depfiles list the prerequisites of every rule", "[impact]") {
+    CHECK(tdd_guard::parse_depfile("a.o: a.cpp \\\n  include/a.h /usr/include/c++/v1/vector\n") ==
+          std::vector<std::string>{"a.cpp", "include/a.h", "/usr/include/c++/v1/vector"});
+    CHECK(tdd_guard::parse_depfile("a.o: my\\ dir/a.cpp cost$$.h\r\n") ==
+          std::vector<std::string>{"my dir/a.cpp", "cost$.h"});
+    // -MP adds a rule without prerequisites for every header
+    CHECK(tdd_guard::parse_depfile("a.o: a.cpp a.h\n\na.h:\n") == std::vector<std::string>{"a.cpp", "a.h"});
+    CHECK(tdd_guard::parse_depfile("").empty());
+}
+
+TEST_CASE("objects belong to the target CMake or Meson builds them for", "[impact]") {
+    CHECK(tdd_guard::object_target("CMakeFiles/unit_tests.dir/src/a.cpp.o") == "unit_tests");
+    CHECK(tdd_guard::object_target("/build/sub/CMakeFiles/unit.dir/a.cpp.o") == "unit");
+    CHECK(tdd_guard::object_target("unit_tests.p/src_a.cpp.o") == "unit_tests");
+    CHECK(tdd_guard::object_target("sub/unit.p/a.cpp.o") == "unit");
+    CHECK(tdd_guard::object_target("a.o").empty());
+}
+
+TEST_CASE("Ninja manifests tell which targets link which", "[impact]") {
+    CHECK(tdd_guard::parse_ninja_links(CMAKE_NINJA) ==
+          std::vector<tdd_guard::TargetLink>{{.target = "unit_tests", .library = "core"}});
+    // Meson's, with a library in a directory whose name needs escaping
+    const auto meson = tdd_guard::parse_ninja_links(
+        "build my$ lib/libcore.so: cpp_LINKER my$ lib/core.p/c.cpp.o\n"
+        "build app.p/a.cpp.o: cpp_COMPILER ../a.cpp\n"
+        "build app: cpp_LINKER app.p/a.cpp.o my$ lib/libcore.so\n"
+        "build tests: cpp_LINKER tests.p/t.cpp.o app.p/a.cpp.o || my$ lib/libcore.so\n");
+    CHECK(meson == std::vector<tdd_guard::TargetLink>{{.target = "app", .library = "core"}});
+    CHECK(tdd_guard::parse_ninja_links("").empty());
+}
+
+TEST_CASE("the impact index maps headers to the targets that include them", "[impact]") {
+    TempDir dir;
+    const auto build = dir.path / "build";
+    write_build(build);
+    std::ostringstream err;
+
+    tdd_guard::ImpactIndex index;
+    REQUIRE(index.update(build, err));
+
+    const auto header = (dir.path / "a.h").string();
+    const auto source = (dir.path / "a.cpp").string();
+    CHECK(index.knows("unit_tests"));
+    CHECK_FALSE(index.knows("other"));
+    CHECK(index.targets_using(std::vector{header}) == std::vector<std::string>{"unit_tests"});
+    CHECK(index.targets_using(std::vector{source}) == std::vector<std::string>{"unit_tests"});
+    CHECK(index.targets_using(std::vector{(dir.path / "b.h").string()}).empty());
+    // Neither file exists, so both count as changed
+    CHECK(index.modified_since(0).size() == 2);
+
+    const int dir_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(dir_fd >= 0);
+    index.set_last_run(42);
+    REQUIRE(index.save(dir_fd, err));
+    auto loaded = tdd_guard::ImpactIndex::load(dir_fd);
+    ::close(dir_fd);
+    CHECK(loaded.last_run() == 42);
+    CHECK(loaded.targets_using(std::vector{header}) == std::vector<std::string>{"unit_tests"});
+    CHECK(err.str().empty());
+}
+
+TEST_CASE("the impact index rereads only depfiles that changed", "[impact]") {
+    TempDir dir;
+    const auto build = dir.path / "build";
+    write_build(build);
+    const auto depfile = build / "CMakeFiles" / "unit_tests.dir" / "a.cpp.o.d";
+    std::ostringstream err;
+    tdd_guard::ImpactIndex index;
+    REQUIRE(index.update(build, err));
+    struct stat before {};
+    REQUIRE(::stat(depfile.c_str(), &before) == 0);
+
+    // Same size and mtime: the index keeps what it read
+    std::ofstream(depfile) << "CMakeFiles/unit_tests.dir/a.cpp.o: ../a.cpp \\\n ../b.h\n";
+    const struct timespec times[2] = {before.st_atim, before.st_mtim};
+    REQUIRE(::utimensat(AT_FDCWD, depfile.c_str(), times, 0) == 0);
+    REQUIRE(index.update(build, err));
+    CHECK(index.targets_using(std::vector{(dir.path / "a.h").string()}).size() == 1);
+
+    std::ofstream(depfile) << "CMakeFiles/unit_tests.dir/a.cpp.o: ../a.cpp ../b.h\n";
+    REQUIRE(index.update(build, err));
+    CHECK(index.targets_using(std::vector{(dir.path / "a.h").string()}).empty());
+    CHECK(index.targets_using(std::vector{(dir.path / "b.h").string()}).size() == 1);
+}
+
+TEST_CASE("a missing compilation database is reported", "[impact]") {
+    TempDir dir;
+    std::ostringstream err;
+    tdd_guard::ImpactIndex index;
+
+    CHECK_FALSE(index.update(dir.path, err));
+    CHECK_THAT(err.str(), ContainsSubstring("compile_commands.json"));
+}
+
+TEST_CASE("impacted runs skip binaries no change reaches and keep their results", "[impact]") {
+    TempDir dir;
+    const auto build = dir.path / "build";
+    write_build(build);
+    auto path = tdd_guard::testing::write_fake_googletest(build, "unit_tests");
+    std::vector<char*> binaries = {path.data()};
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    const auto run = [&](std::vector<fs::path> changed) {
+        return tdd_guard::run_impacted(results_fd, binaries, {.build_dir = build, .changed = std::move(changed)}, -1,
+                                       -1, err);
+    };
+    const auto runs = [&] { return fake_runs(build); };
+    const auto saved = [&] { return saved_results(dir.path); };
+
+    CHECK(run({dir.path / "b.h"}) == 0);
+    CHECK(runs() == 1);
+
+    CHECK(run({dir.path / "b.h"}) == 0);
+    CHECK(runs() == 1);
+    CHECK_THAT(saved(), ContainsSubstring(R"("fullName":"Math.Adds")"));
+    CHECK_THAT(saved(), ContainsSubstring(R"("process":{"exitCode":0})"));
+
+    CHECK(run({dir.path / "a.h"}) == 0);
+    CHECK(runs() == 2);
+    ::close(results_fd);
+    CHECK(err.str().empty());
+}
+
+TEST_CASE("impacted runs forget the results of a binary killed by a signal", "[impact]") {
+    TempDir dir;
+    const auto build = dir.path / "build";
+    write_build(build);
+    auto path = tdd_guard::testing::write_fake_googletest(build, "unit_tests");
+    std::vector<char*> binaries = {path.data()};
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    const auto run = [&](std::vector<fs::path> changed) {
+        return tdd_guard::run_impacted(results_fd, binaries, {.build_dir = build, .changed = std::move(changed)}, -1,
+                                       -1, err);
+    };
+
+    CHECK(run({dir.path / "a.h"}) == 0);
+    CHECK(fake_runs(build) == 1);
+
+    std::ofstream(path, std::ios::trunc) << "#!/bin/sh\nkill -KILL $$\n";
+    CHECK(run({dir.path / "a.h"}) != 0);
+    CHECK_THAT(saved_results(dir.path), ContainsSubstring(R"("signal")"));
+
+    // Nothing changed since, yet the report from before the crash is not reused
+    (void)tdd_guard::testing::write_fake_googletest(build, "unit_tests");
+    CHECK(run({dir.path / "b.h"}) == 0);
+    CHECK(fake_runs(build) == 2);
+    CHECK_THAT(saved_results(dir.path), ContainsSubstring(R"("process":{"exitCode":0})"));
+    ::close(results_fd);
+}
+
+TEST_CASE("the impact index follows a library to the targets linking it", "[impact]") {
+    TempDir dir;
+    const auto build = dir.path / "build";
+    write_library_build(build);
+    const auto library_header = (dir.path / "c.h").string();
+    std::ostringstream err;
+    tdd_guard::ImpactIndex index;
+
+    REQUIRE(index.update(build, err));
+    CHECK_FALSE(index.knows_links());
+    CHECK(index.targets_using(std::vector{library_header}) == std::vector<std::string>{"core"});
+
+    // CMake's Makefile generator
+    std::ofstream(build / "CMakeFiles" / "core.dir" / "link.txt")
+        << "/usr/bin/ar qc libcore.a CMakeFiles/core.dir/c.cpp.o\n/usr/bin/ranlib libcore.a\n";
+    std::ofstream(build / "CMakeFiles" / "unit_tests.dir" / "link.txt")
+        << "/usr/bin/c++ -O2 CMakeFiles/unit_tests.dir/a.cpp.o -o unit_tests libcore.a\n";
+    REQUIRE(index.update(build, err));
+    CHECK(index.knows_links());
+    CHECK(index.targets_using(std::vector{library_header}) == std::vector<std::string>{"core", "unit_tests"});
+
+    // Ninja's manifest comes first
+    std::ofstream(build / "build.ninja") << "build unit_tests: LINK CMakeFiles/unit_tests.dir/a.cpp.o\n";
+    REQUIRE(index.update(build, err));
+    CHECK(index.targets_using(std::vector{library_header}) == std::vector<std::string>{"core"});
+    std::ofstream(build / "build.ninja") << CMAKE_NINJA;
+    REQUIRE(index.update(build, err));
+    CHECK(index.targets_using(std::vector{library_header}) == std::vector<std::string>{"core", "unit_tests"});
+
+    const int dir_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(dir_fd >= 0);
+    REQUIRE(index.save(dir_fd, err));
+    const auto loaded = tdd_guard::ImpactIndex::load(dir_fd);
+    ::close(dir_fd);
+    CHECK(loaded.knows_links());
+    CHECK(loaded.targets_using(std::vector{library_header}) == std::vector<std::string>{"core", "unit_tests"});
+    CHECK(err.str().empty());
+}
+
+TEST_CASE("impacted runs follow a changed library to the tests linking it", "[impact]") {
+    TempDir dir;
+    const auto build = dir.path / "build";
+    write_library_build(build);
+    std::ofstream(build / "build.ninja") << CMAKE_NINJA;
+    auto path = tdd_guard::testing::write_fake_googletest(build, "unit_tests");
+    std::vector<char*> binaries = {path.data()};
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    const auto run = [&](std::vector<fs::path> changed) {
+        return tdd_guard::run_impacted(results_fd, binaries, {.build_dir = build, .changed = std::move(changed)}, -1,
+                                       -1, err);
+    };
+
+    CHECK(run({dir.path / "a.h"}) == 0);
+    CHECK(fake_runs(build) == 1);
+    CHECK(run({dir.path / "b.h"}) == 0);
+    CHECK(fake_runs(build) == 1);
+    CHECK(run({dir.path / "c.h"}) == 0);
+    CHECK(fake_runs(build) == 2);
+
+    // Without the manifest nothing tells whether unit_tests links core
+    fs::remove(build / "build.ninja");
+    CHECK(run({dir.path / "c.h"}) == 0);
+    CHECK(fake_runs(build) == 3);
+    ::close(results_fd);
+    CHECK(err.str().empty());
+}
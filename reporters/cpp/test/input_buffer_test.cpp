@@ -0,0 +1,39 @@
+#include <catch2/catch_test_macros.hpp>
+#include "input_buffer.hpp"
+
+TEST_CASE("empty buffer has no lines", "[input_buffer]") {
+    tdd_guard::InputBuffer input;
+
+    CHECK(input.empty());
+    CHECK(input.line_count() == 0);
+}
+
+TEST_CASE("index lines terminated by newline", "[input_buffer]") {
+    tdd_guard::InputBuffer input;
+    input.append("first\nsecond\n");
+
+    REQUIRE(input.line_count() == 2);
+    CHECK(input.line(0) == "first");
+    CHECK(input.line(1) == "second");
+}
+
+TEST_CASE("index unterminated final line", "[input_buffer]") {
+    tdd_guard::InputBuffer input;
+    input.append("first\nlast");
+
+    REQUIRE(input.line_count() == 2);
+    CHECK(input.line(1) == "last");
+    CHECK(input.content() == "first\nlast");
+}
+
+TEST_CASE("index lines split across appends", "[input_buffer]") {
+    tdd_guard::InputBuffer input;
+    input.append("par");
+    input.append("tial\n\nnext");
+    input.append("\n");
+
+    REQUIRE(input.line_count() == 3);
+    CHECK(input.line(0) == "partial");
+    CHECK(input.line(1).empty());
+    CHECK(input.line(2) == "next");
+}
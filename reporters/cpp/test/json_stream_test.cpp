@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include "json_stream.hpp"
+#include <string>
+
+namespace {
+
+// Records every token as text so whole documents can be compared
+class Recorder final : public tdd_guard::JsonHandler {
+public:
+    std::string trace;
+    std::size_t stop_after = static_cast<std::size_t>(-1);
+
+    auto null() -> bool override { return add("null"); }
+    auto boolean(bool value) -> bool override { return add(value ? "true" : "false"); }
+    auto number_integer(std::int64_t value) -> bool override { return add("i" + std::to_string(value)); }
+    auto number_unsigned(std::uint64_t value) -> bool override { return add("u" + std::to_string(value)); }
+    auto number_float(double /*value*/, const std::string& text) -> bool override { return add("f" + text); }
+    auto string(std::string& value) -> bool override { return add("s:" + value); }
+    auto start_object(std::size_t /*elements*/) -> bool override { return add("{"); }
+    auto key(std::string& name) -> bool override { return add("k:" + name); }
+    auto end_object() -> bool override { return add("}"); }
+    auto start_array(std::size_t /*elements*/) -> bool override { return add("["); }
+    auto end_array() -> bool override { return add("]"); }
+
+private:
+    std::size_t count_ = 0;
+
+    auto add(const std::string& token) -> bool {
+        trace += token + " ";
+        return ++count_ < stop_after;
+    }
+};
+
+const std::string DOCUMENT =
+    R"({"name": "Suite", "tests": [1, -2, 3.5, 1e3, true, false, null, {}, []],)"
+    "\n"
+    R"( "text": "tab\there \"quoted\" \u00e9 \ud83d\ude00 caf\u00c3"})";
+
+const std::string TRACE =
+    "{ k:name s:Suite k:tests [ u1 i-2 f3.5 f1e3 true false null { } [ ] ] "
+    "k:text s:tab\there \"quoted\" \xC3\xA9 \xF0\x9F\x98\x80 caf\xC3\x83 } ";
+
+} // anonymous namespace
+
+TEST_CASE("json stream reports tokens in document order", "[json_stream]") {
+    Recorder recorder;
+    tdd_guard::JsonStream stream(recorder);
+
+    CHECK(stream.feed(DOCUMENT) == DOCUMENT.size());
+    CHECK(stream.complete());
+    CHECK(recorder.trace == TRACE);
+}
+
+TEST_CASE("json stream accepts input split at any byte", "[json_stream]") {
+    Recorder recorder;
+    tdd_guard::JsonStream stream(recorder);
+
+    for (const char c : DOCUMENT) {
+        REQUIRE_FALSE(stream.complete());
+        stream.feed(std::string_view(&c, 1));
+    }
+
+    CHECK(stream.complete());
+    CHECK(recorder.trace == TRACE);
+}
+
+TEST_CASE("json stream reads integers beyond 64 bits as floating point", "[json_stream]") {
+    Recorder recorder;
+    tdd_guard::JsonStream stream(recorder);
+
+    stream.feed(R"([18446744073709551615, -9223372036854775808, 18446744073709551616])");
+
+    CHECK(stream.complete());
+    CHECK(recorder.trace == "[ u18446744073709551615 i-9223372036854775808 f18446744073709551616 ] ");
+}
+
+TEST_CASE("json stream stops at the end of the document", "[json_stream]") {
+    Recorder recorder;
+    tdd_guard::JsonStream stream(recorder);
+
+    CHECK(stream.feed("{\"a\": 1}  trailing") == 8);
+    CHECK(stream.complete());
+    CHECK(stream.feed("more") == 0);
+}
+
+TEST_CASE("json stream rejects malformed documents", "[json_stream]") {
+    const char* documents[] = {
+        "{\"a\" 1}",
+        "{\"a\": 01}",
+        "{\"a\": 1.}",
+        "{\"a\": tru }",
+        "{\"a\": [1,]}",
+        "{\"a\": [1}",
+        "{\"a\": \"\\x\"}",
+        "{\"a\": \"\\ud83d\"}",
+        "{\"a\": \"\\ude00\"}",
+        "{\"a\": \"raw\ttab\"}",
+        "{\"a\": \"\xC3\x28\"}",
+        "{\"a\": \"\xED\xA0\x80\"}",
+        "{1: 2}",
+    };
+
+    for (const auto* document : documents) {
+        Recorder recorder;
+        tdd_guard::JsonStream stream(recorder);
+        stream.feed(document);
+        INFO(document);
+        CHECK(stream.failed());
+    }
+}
+
+TEST_CASE("json stream stops when the handler rejects a token", "[json_stream]") {
+    Recorder recorder;
+    recorder.stop_after = 2;
+    tdd_guard::JsonStream stream(recorder);
+
+    stream.feed(R"({"a": 1, "b": 2})");
+
+    CHECK(stream.failed());
+    CHECK(recorder.trace == "{ k:a ");
+}
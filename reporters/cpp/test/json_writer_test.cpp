@@ -0,0 +1,89 @@
+#include <catch2/catch_test_macros.hpp>
+#include "json_writer.hpp"
+#include <cstdio>
+#include <fcntl.h>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+auto read_file(std::FILE* file) -> std::string {
+    std::string content;
+    ::lseek(::fileno(file), 0, SEEK_SET);
+    char buffer[4096];
+    for (ssize_t count; (count = ::read(::fileno(file), buffer, sizeof(buffer))) > 0;) {
+        content.append(buffer, static_cast<std::size_t>(count));
+    }
+    return content;
+}
+
+} // anonymous namespace
+
+TEST_CASE("strings are escaped like nlohmann dump", "[json_writer]") {
+    std::string every_byte;
+    for (int c = 1; c < 0x80; ++c) {
+        every_byte.push_back(static_cast<char>(c));
+    }
+    every_byte.push_back('\0');
+
+    for (const std::string value : {std::string(), std::string("plain"), std::string("a\"b\\c/d"),
+                                    std::string("caf\xc3\xa9 \xe2\x9c\x93 \xf0\x9f\x98\x80"),
+                                    std::string("\x1b[31mred\x1b[0m\x7f"), every_byte}) {
+        tdd_guard::JsonWriter writer;
+        writer.string(value);
+        CHECK(writer.take() == nlohmann::json(value).dump());
+    }
+}
+
+TEST_CASE("containers are written compactly", "[json_writer]") {
+    tdd_guard::JsonWriter writer;
+    writer.begin_object();
+    writer.key("a");
+    writer.begin_array();
+    writer.begin_object();
+    writer.end_object();
+    writer.string("x");
+    writer.begin_array();
+    writer.end_array();
+    writer.end_array();
+    writer.key("b");
+    writer.string("y");
+    writer.key("c");
+    writer.boolean(false);
+    writer.end_object();
+
+    CHECK(writer.take() == R"({"a":[{},"x",[]],"b":"y","c":false})");
+}
+
+TEST_CASE("file output spans several buffer flushes", "[json_writer]") {
+    std::FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    nlohmann::json expected = nlohmann::json::array();
+    tdd_guard::JsonWriter writer(::fileno(file));
+    writer.begin_array();
+    for (int i = 0; i < 5000; ++i) {
+        auto value = "test " + std::to_string(i) + std::string(static_cast<std::size_t>(i % 50), '\n');
+        writer.string(value);
+        expected.push_back(value);
+    }
+    auto large = std::string(200 * 1024, 'z');
+    writer.string(large);
+    expected.push_back(large);
+    writer.end_array();
+
+    REQUIRE(writer.flush());
+    CHECK(read_file(file) == expected.dump());
+    std::fclose(file);
+}
+
+TEST_CASE("flush reports a failed write", "[json_writer]") {
+    const int read_only = ::open("/dev/null", O_RDONLY);
+    REQUIRE(read_only >= 0);
+
+    tdd_guard::JsonWriter writer(read_only);
+    writer.string("lost");
+    CHECK_FALSE(writer.flush());
+    ::close(read_only);
+}
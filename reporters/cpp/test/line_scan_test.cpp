@@ -0,0 +1,80 @@
+#include <catch2/catch_test_macros.hpp>
+#include "line_scan.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct ScanResult {
+    std::vector<std::size_t> ends;
+    std::vector<tdd_guard::LineInfo> infos;
+    tdd_guard::LineInfo open;
+};
+
+// Scans data in pieces of the given size to exercise state between calls
+auto scan(tdd_guard::ScanMethod method, const std::string& data, std::size_t piece) -> ScanResult {
+    ScanResult result;
+    for (std::size_t offset = 0; offset < data.size(); offset += piece) {
+        const auto bytes = std::string_view(data).substr(offset, piece);
+        tdd_guard::scan_lines(method, bytes, offset, result.open, result.ends, result.infos);
+    }
+    return result;
+}
+
+auto same_info(const tdd_guard::LineInfo& a, const tdd_guard::LineInfo& b) -> bool {
+    return a.has_first == b.has_first && a.has_escape == b.has_escape &&
+           (!a.has_first || a.first == b.first);
+}
+
+auto same(const ScanResult& a, const ScanResult& b) -> bool {
+    if (a.ends != b.ends || a.infos.size() != b.infos.size() || !same_info(a.open, b.open)) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.infos.size(); ++i) {
+        if (!same_info(a.infos[i], b.infos[i])) return false;
+    }
+    return true;
+}
+
+constexpr tdd_guard::ScanMethod METHODS[] = {
+    tdd_guard::ScanMethod::Scalar, tdd_guard::ScanMethod::Sse2, tdd_guard::ScanMethod::Avx2
+};
+
+} // anonymous namespace
+
+TEST_CASE("scan records line ends and first non-blank bytes", "[line_scan]") {
+    for (const auto method : METHODS) {
+        if (!tdd_guard::is_supported(method)) continue;
+
+        const auto result = scan(method, "  {\n\t\v\x1b[0m x\n\n   tail", 64);
+
+        REQUIRE(result.ends == std::vector<std::size_t>{3, 12, 13});
+        CHECK(result.infos[0].first == '{');
+        CHECK_FALSE(result.infos[0].has_escape);
+        CHECK(result.infos[1].first == '\x1b');
+        CHECK(result.infos[1].has_escape);
+        CHECK_FALSE(result.infos[2].has_first);
+        CHECK(result.open.first == 't');
+    }
+}
+
+TEST_CASE("every scan method agrees with the scalar scan", "[line_scan]") {
+    std::mt19937 rng(12345);
+    const char alphabet[] = {' ', '\t', '\r', '\n', '\x1b', '{', '"', 'a', '\x0b', '\x0c', '\x80', '\xff'};
+
+    for (int round = 0; round < 200; ++round) {
+        std::string data(rng() % 300, ' ');
+        for (auto& c : data) {
+            c = alphabet[rng() % sizeof(alphabet)];
+        }
+        const auto piece = 1 + rng() % 70;
+        const auto expected = scan(tdd_guard::ScanMethod::Scalar, data, data.size() + 1);
+
+        for (const auto method : METHODS) {
+            if (!tdd_guard::is_supported(method)) continue;
+            INFO("round " << round << " method " << static_cast<int>(method));
+            CHECK(same(scan(method, data, piece), expected));
+        }
+    }
+}
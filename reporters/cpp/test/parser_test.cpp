@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
+#include "allocation_tracker.hpp"
 #include "parser.hpp"
 
 using Catch::Matchers::ContainsSubstring;
@@ -64,6 +65,7 @@ TEST_CASE("parse GoogleTest passing test", "[parser][googletest]") {
     CHECK(events[0].name == "Addition");
     CHECK(events[0].full_name == "MathTest.Addition");
     CHECK(events[0].state == tdd_guard::TestEvent::State::Passed);
+    CHECK(events[0].duration == std::chrono::milliseconds(1));
 }
 
 TEST_CASE("parse GoogleTest failing test", "[parser][googletest]") {
@@ -340,3 +342,309 @@ TEST_CASE("parse GoogleTest ignores non-string failure messages", "[parser][goog
     CHECK(events[0].state == tdd_guard::TestEvent::State::Failed);
     CHECK_FALSE(events[0].error_message().has_value());
 }
+
+TEST_CASE("parse GoogleTest suite name after its tests", "[parser][googletest]") {
+    std::string json = R"({
+        "testsuites": [{
+            "testsuite": [{"name": "Addition", "status": "RUN"}],
+            "name": "MathTest"
+        }]
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].full_name == "MathTest.Addition");
+}
+
+TEST_CASE("parse GoogleTest NOTRUN status wins over failures", "[parser][googletest]") {
+    std::string json = R"({
+        "testsuites": [{
+            "name": "MathTest",
+            "testsuite": [{
+                "name": "Disabled",
+                "failures": [{"message": "not reported"}],
+                "status": "NOTRUN"
+            }]
+        }]
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].state == tdd_guard::TestEvent::State::Skipped);
+    CHECK(events[0].failure_messages.empty());
+}
+
+TEST_CASE("parse GoogleTest skips unused keys and nested values", "[parser][googletest]") {
+    std::string json = R"({
+        "tests": 1,
+        "timestamp": "2025-01-01T00:00:00Z",
+        "testsuites": [{
+            "name": "MathTest",
+            "properties": {"testsuite": [{"name": "Ignored"}]},
+            "testsuite": [{
+                "name": "Addition",
+                "file": "math_test.cpp",
+                "line": 12,
+                "result": "COMPLETED",
+                "timestamp": "2025-01-01T00:00:00Z",
+                "failures": [{"message": "boom", "type": ""}, "unexpected"]
+            }]
+        }]
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].full_name == "MathTest.Addition");
+    CHECK(events[0].state == tdd_guard::TestEvent::State::Failed);
+    REQUIRE(events[0].failure_messages.size() == 1);
+    CHECK(events[0].failure_messages[0] == "boom");
+}
+
+TEST_CASE("parse GoogleTest rejects non-string test name", "[parser][googletest]") {
+    std::string json = R"({
+        "testsuites": [{
+            "name": "MathTest",
+            "testsuite": [{"name": 7, "status": "RUN"}]
+        }]
+    })";
+
+    tdd_guard::Parser parser;
+    CHECK_FALSE(parser.parse(json));
+}
+
+TEST_CASE("parse GoogleTest rejects non-array testsuites", "[parser][googletest]") {
+    tdd_guard::Parser parser;
+    CHECK_FALSE(parser.parse(R"({"testsuites": {"name": "MathTest"}})"));
+}
+
+TEST_CASE("parse Catch2 collects failures from every run", "[parser][catch2]") {
+    std::string json = R"({
+        "test-run": {
+            "test-cases": [{
+                "test-info": {"name": "generated values"},
+                "runs": [
+                    {"path": [{"kind": "assertion", "status": false, "expression": {"expanded": "1 == 0"}}]},
+                    {"path": [{"kind": "assertion", "status": true, "expression": {"expanded": "2 == 2"}}]},
+                    {"path": [{"kind": "assertion", "status": false, "expression": {"expanded": "3 == 0"}}]}
+                ],
+                "totals": {"assertions": {"passed": 1, "failed": 2}}
+            }]
+        }
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].state == tdd_guard::TestEvent::State::Failed);
+    REQUIRE(events[0].failure_messages.size() == 2);
+    CHECK(events[0].failure_messages[0] == "1 == 0");
+    CHECK(events[0].failure_messages[1] == "3 == 0");
+}
+
+TEST_CASE("parse Catch2 follows the last section of the first run", "[parser][catch2]") {
+    std::string json = R"({
+        "test-run": {
+            "test-cases": [{
+                "test-info": {"name": "Stack"},
+                "runs": [{
+                    "path": [{
+                        "path": [
+                            {"path": [{"kind": "section", "name": "ignored"}], "kind": "section", "name": "push"},
+                            {"path": [{"kind": "section", "name": "empty"}], "kind": "section", "name": "pop"}
+                        ],
+                        "kind": "section",
+                        "name": "Stack"
+                    }]
+                }, {
+                    "path": [{"kind": "section", "name": "second run"}]
+                }],
+                "totals": {"assertions": {"passed": 2, "failed": 0}}
+            }]
+        }
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].name == "empty");
+    CHECK(events[0].full_name == "Stack/push/pop/empty");
+}
+
+TEST_CASE("parse Catch2 totals after runs decide failure messages", "[parser][catch2]") {
+    std::string json = R"({
+        "test-run": {
+            "test-cases": [{
+                "runs": [{"path": [{"kind": "assertion", "status": false, "expression": {"expanded": "0 == 1"}}]}],
+                "totals": {"assertions": {"passed": 1, "failed": 0}},
+                "test-info": {"name": "recovered"}
+            }]
+        }
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].name == "recovered");
+    CHECK(events[0].state == tdd_guard::TestEvent::State::Passed);
+    CHECK(events[0].failure_messages.empty());
+}
+
+TEST_CASE("parse Catch2 without totals reports unknown state", "[parser][catch2]") {
+    std::string json = R"({"test-run": {"test-cases": [{"test-info": {"name": "no totals"}}]}})";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    auto events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].state == tdd_guard::TestEvent::State::Unknown);
+}
+
+TEST_CASE("parser reports tests while the JSON is still arriving", "[parser][googletest]") {
+    tdd_guard::Parser parser;
+    parser.feed_line("Running main() from gtest_main.cc");
+    parser.feed_line(R"({"testsuites": [{"name": "MathTest", "testsuite": [)");
+    parser.feed_line(R"(  {"name": "Addition", "status": "RUN"},)");
+
+    REQUIRE(parser.events().size() == 1);
+    CHECK(parser.events()[0].full_name == "MathTest.Addition");
+
+    parser.feed_line(R"(  {"name": "Division", "status": "RUN"}]}]})");
+    CHECK(parser.finish());
+    CHECK(parser.events().size() == 2);
+}
+
+TEST_CASE("parse truncated GoogleTest JSON keeps finished tests", "[parser][googletest]") {
+    std::string json = R"({
+        "testsuites": [{
+            "name": "MathTest",
+            "testsuite": [
+                {"name": "Addition", "status": "RUN"},
+                {"name": "Division", "status": "RU)";
+
+    tdd_guard::Parser parser;
+    CHECK_FALSE(parser.parse(json));
+    CHECK(parser.truncated());
+
+    const auto& events = parser.events();
+    REQUIRE(events.size() == 1);
+    CHECK(events[0].full_name == "MathTest.Addition");
+}
+
+TEST_CASE("parse truncated JSON of unknown shape is not partial", "[parser]") {
+    tdd_guard::Parser parser;
+
+    CHECK_FALSE(parser.parse(R"({"results": [{"name": "x")"));
+    CHECK_FALSE(parser.truncated());
+}
+
+TEST_CASE("parse GoogleTest repeated runs merges their tests", "[parser][googletest]") {
+    std::string output = R"(Repeating all tests (iteration 1) . . .
+{"testsuites": [{"name": "MathTest", "testsuite": [
+  {"name": "Addition", "status": "RUN", "result": "COMPLETED", "time": "0.002s"},
+  {"name": "Division", "status": "RUN", "result": "COMPLETED", "time": "0.001s"}]}]}
+Repeating all tests (iteration 2) . . .
+{"testsuites": [{"name": "MathTest", "testsuite": [
+  {"name": "Addition", "status": "RUN", "result": "COMPLETED", "time": "0.003s"},
+  {"name": "Division", "status": "RUN", "result": "COMPLETED", "time": "0.001s",
+   "failures": [{"message": "flaky division"}]}]}]}
+)";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(output));
+
+    const auto& events = parser.events();
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].full_name == "MathTest.Addition");
+    CHECK(events[0].state == tdd_guard::TestEvent::State::Passed);
+    CHECK(events[0].duration == std::chrono::microseconds(5000));
+    CHECK(events[1].full_name == "MathTest.Division");
+    CHECK(events[1].state == tdd_guard::TestEvent::State::Failed);
+    CHECK(events[1].failure_messages == std::vector<std::string>{"flaky division"});
+}
+
+TEST_CASE("parse compact reports on one line", "[parser][googletest]") {
+    std::string output =
+        R"({"testsuites": [{"name": "A", "testsuite": [{"name": "One", "status": "RUN"}]}]} )"
+        R"({"testsuites": [{"name": "A", "testsuite": [{"name": "Two", "status": "RUN"}]}]})";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(output));
+
+    const auto& events = parser.events();
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].full_name == "A.One");
+    CHECK(events[1].full_name == "A.Two");
+}
+
+TEST_CASE("parse skips output interleaved with the report", "[parser][googletest]") {
+    std::string output = R"({"config": {"seed": 42}}
+{"testsuites": [{"name": "MathTest", "testsuite": [
+  {"name": "Addition", "status": "RUN"},
+warning: leaked 1 object {at 0x1234}
+  {"name": "Division", "status": "RUN"}]}]}
+)";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(output));
+
+    const auto& events = parser.events();
+    REQUIRE(events.size() == 2);
+    CHECK(events[0].full_name == "MathTest.Addition");
+    CHECK(events[1].full_name == "MathTest.Division");
+}
+
+TEST_CASE("parse GoogleTest durations", "[parser][duration]") {
+    using std::chrono::microseconds;
+
+    CHECK(tdd_guard::parse_duration("0.013s") == microseconds(13000));
+    CHECK(tdd_guard::parse_duration("2s") == microseconds(2000000));
+    CHECK(tdd_guard::parse_duration("1.5s") == microseconds(1500000));
+    CHECK(tdd_guard::parse_duration("0.0000019s") == microseconds(1));
+
+    for (const auto* text : {"", "s", "0.013", ".5s", "1.s", "-1s", "1.2.3s", "1e3s", "99999999999999999999s"}) {
+        INFO(text);
+        CHECK_FALSE(tdd_guard::parse_duration(text).has_value());
+    }
+
+    tdd_guard::testing::AllocationScope scope;
+    CHECK(tdd_guard::parse_duration("12345.678901s") == microseconds(12345678901));
+    CHECK(scope.stats().count == 0);
+}
+
+TEST_CASE("GoogleTest tests without a usable time have no duration", "[parser][duration]") {
+    std::string json = R"({
+        "testsuites": [{
+            "name": "Suite",
+            "testsuite": [
+                {"name": "NoTime", "status": "RUN"},
+                {"name": "NumericTime", "status": "RUN", "time": 0.5},
+                {"name": "Malformed", "status": "RUN", "time": "soon"}
+            ]
+        }]
+    })";
+
+    tdd_guard::Parser parser;
+    REQUIRE(parser.parse(json));
+
+    const auto& events = parser.events();
+    REQUIRE(events.size() == 3);
+    for (const auto& event : events) {
+        CHECK_FALSE(event.duration.has_value());
+    }
+}
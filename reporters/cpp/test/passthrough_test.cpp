@@ -0,0 +1,172 @@
+#include <catch2/catch_test_macros.hpp>
+#include "passthrough.hpp"
+#include "test_support.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+using tdd_guard::testing::Pipe;
+using tdd_guard::testing::read_all;
+
+using ForwardFn = bool (*)(int, int, tdd_guard::InputBuffer&, const tdd_guard::InputCallback&);
+
+// Feeds data through forward between two pipes while draining the output
+// concurrently, so inputs larger than the pipe capacity work
+auto forward_through_pipes(const std::string& data, tdd_guard::InputBuffer& input,
+                           ForwardFn forward = tdd_guard::forward_stream,
+                           const tdd_guard::InputCallback& on_input = {}) -> std::string {
+    Pipe in;
+    Pipe out;
+
+    std::thread producer([&] {
+        std::size_t offset = 0;
+        while (offset < data.size()) {
+            auto written = ::write(in.write_fd, data.data() + offset, data.size() - offset);
+            if (written <= 0) break;
+            offset += static_cast<std::size_t>(written);
+        }
+        in.close_write();
+    });
+
+    std::string forwarded;
+    std::thread consumer([&] { forwarded = read_all(out.read_fd); });
+
+    CHECK(forward(in.read_fd, out.write_fd, input, on_input));
+    out.close_write();
+
+    producer.join();
+    consumer.join();
+    return forwarded;
+}
+
+} // anonymous namespace
+
+TEST_CASE("forward pipe output unchanged", "[passthrough]") {
+    tdd_guard::InputBuffer input;
+
+    auto forwarded = forward_through_pipes("first\nsecond\n", input);
+
+    CHECK(forwarded == "first\nsecond\n");
+    CHECK(input.content() == "first\nsecond\n");
+}
+
+TEST_CASE("forward final line without newline unchanged", "[passthrough]") {
+    tdd_guard::InputBuffer input;
+
+    auto forwarded = forward_through_pipes("first\nlast", input);
+
+    CHECK(forwarded == "first\nlast");
+    REQUIRE(input.line_count() == 2);
+    CHECK(input.line(1) == "last");
+}
+
+TEST_CASE("forward input larger than pipe capacity", "[passthrough]") {
+    std::string data;
+    for (int i = 0; data.size() < 1024 * 1024; ++i) {
+        data += "[ RUN      ] Suite.Test" + std::to_string(i) + "\n";
+    }
+    tdd_guard::InputBuffer input;
+
+    auto forwarded = forward_through_pipes(data, input);
+
+    CHECK(forwarded == data);
+    CHECK(input.content() == data);
+}
+
+TEST_CASE("forward to a regular file using block copies", "[passthrough]") {
+    Pipe in;
+    std::FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    REQUIRE(::write(in.write_fd, "a\nb", 3) == 3);
+    in.close_write();
+
+    tdd_guard::InputBuffer input;
+    CHECK(tdd_guard::forward_stream(in.read_fd, ::fileno(file), input));
+
+    ::lseek(::fileno(file), 0, SEEK_SET);
+    CHECK(read_all(::fileno(file)) == "a\nb");
+    CHECK(input.content() == "a\nb");
+    std::fclose(file);
+}
+
+TEST_CASE("keep capturing after output is closed", "[passthrough]") {
+    Pipe in;
+    Pipe out;
+    out.close_read();
+    REQUIRE(::write(in.write_fd, "still captured\n", 15) == 15);
+    in.close_write();
+
+    auto previous = std::signal(SIGPIPE, SIG_IGN);
+    tdd_guard::InputBuffer input;
+    CHECK(tdd_guard::forward_stream(in.read_fd, out.write_fd, input));
+    std::signal(SIGPIPE, previous);
+
+    CHECK(input.content() == "still captured\n");
+}
+
+TEST_CASE("pipelined forwarding captures the same input", "[passthrough]") {
+    std::string data;
+    for (int i = 0; data.size() < 1024 * 1024; ++i) {
+        data += "[ RUN      ] Suite.Test" + std::to_string(i) + "\n";
+    }
+    tdd_guard::InputBuffer input;
+    std::size_t lines_seen = 0;
+
+    auto forwarded = forward_through_pipes(data, input, tdd_guard::forward_stream_pipelined,
+                                           [&] { lines_seen = input.complete_line_count(); });
+
+    CHECK(forwarded == data);
+    CHECK(input.content() == data);
+    CHECK(lines_seen == input.line_count());
+}
+
+TEST_CASE("pipelined forwarding does not wait for a slow consumer", "[passthrough]") {
+    const std::string data(4 * 1024 * 1024, 'x');
+    Pipe in;
+    Pipe out;
+    std::atomic<std::size_t> forwarded_bytes{0};
+
+    std::thread producer([&] {
+        std::size_t offset = 0;
+        while (offset < data.size()) {
+            auto written = ::write(in.write_fd, data.data() + offset, data.size() - offset);
+            if (written <= 0) break;
+            offset += static_cast<std::size_t>(written);
+        }
+        in.close_write();
+    });
+    std::thread consumer([&] {
+        char block[4096];
+        for (ssize_t count; (count = ::read(out.read_fd, block, sizeof(block))) > 0;) {
+            forwarded_bytes += static_cast<std::size_t>(count);
+        }
+    });
+
+    // The first callback holds the worker until every byte has been forwarded
+    bool forwarded_while_blocked = false;
+    bool first_call = true;
+    tdd_guard::InputBuffer input;
+    auto on_input = [&] {
+        if (!first_call) return;
+        first_call = false;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (forwarded_bytes < data.size() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        forwarded_while_blocked = forwarded_bytes == data.size();
+    };
+
+    CHECK(tdd_guard::forward_stream_pipelined(in.read_fd, out.write_fd, input, on_input));
+    out.close_write();
+    producer.join();
+    consumer.join();
+
+    CHECK(forwarded_while_blocked);
+    CHECK(input.content().size() == data.size());
+}
@@ -0,0 +1,203 @@
+#include <catch2/catch_test_macros.hpp>
+#include "allocation_tracker.hpp"
+#include "report.hpp"
+#include <string>
+
+namespace {
+
+auto make_build_log(std::size_t target_bytes) -> std::string {
+    std::string log;
+    for (std::size_t i = 0; log.size() < target_bytes; ++i) {
+        log += "[ " + std::to_string(i % 100) + "%] Building CXX object "
+               "CMakeFiles/app.dir/src/module_" + std::to_string(i) + ".cpp.o\n";
+        if (i % 50 == 0) {
+            log += "\x1b[1msrc/module_" + std::to_string(i) +
+                   ".cpp:12:7: \x1b[35mwarning:\x1b[0m unused variable 'x'\n";
+        }
+    }
+    return log;
+}
+
+// GoogleTest output with every test failing with a message of the given size
+auto make_failing_report(std::size_t tests, std::size_t message_bytes) -> std::string {
+    std::string out = "{\n\"testsuites\": [\n";
+    for (std::size_t i = 0; i < tests; ++i) {
+        if (i % 10 == 0) {
+            out += i == 0 ? "" : "]},\n";
+            out += "{\"name\": \"Suite" + std::to_string(i / 10) + "\", \"testsuite\": [\n";
+        } else {
+            out += ",\n";
+        }
+        out += "{\"name\": \"Test" + std::to_string(i) + "\", \"status\": \"RUN\", "
+               "\"failures\": [{\"message\": \"" + std::string(message_bytes, 'x') + "\"}]}";
+    }
+    return out + "]}\n]\n}\n";
+}
+
+auto count_report_allocations(const std::string& report) -> std::size_t {
+    tdd_guard::InputBuffer input;
+    input.append(report);
+
+    tdd_guard::testing::AllocationScope scope;
+    auto output = tdd_guard::build_report(input);
+    return scope.stats().count;
+}
+
+} // anonymous namespace
+
+TEST_CASE("report parses test JSON mixed with build output", "[report]") {
+    tdd_guard::InputBuffer input;
+    input.append("[100%] Built target tests\n");
+    input.append(R"({
+  "testsuites": [{
+    "name": "MathTest",
+    "testsuite": [{"name": "Addition", "status": "RUN"}]
+  }]
+})");
+
+    auto output = tdd_guard::build_report(input);
+
+    REQUIRE(output.test_modules.size() == 1);
+    CHECK(output.test_modules[0].module_id == "MathTest");
+    CHECK(output.reason == "passed");
+}
+
+TEST_CASE("report collects compiler errors from non-JSON lines", "[report]") {
+    tdd_guard::InputBuffer input;
+    input.append("src/main.cpp:10:5: error: 'foo' was not declared in this scope\n");
+
+    auto output = tdd_guard::build_report(input);
+
+    REQUIRE(output.test_modules.size() == 1);
+    CHECK(output.test_modules[0].module_id == "compilation");
+    REQUIRE(output.test_modules[0].tests[0].errors.size() == 1);
+    CHECK(output.test_modules[0].tests[0].errors[0].location == "src/main.cpp:10:5");
+}
+
+TEST_CASE("report flags output without test JSON", "[report]") {
+    tdd_guard::InputBuffer input;
+    input.append("Build completed successfully\n");
+
+    auto output = tdd_guard::build_report(input);
+
+    REQUIRE(output.test_modules.size() == 1);
+    REQUIRE(output.test_modules[0].tests[0].errors.size() == 1);
+    CHECK(output.test_modules[0].tests[0].errors[0].message == "Failed to parse test output");
+}
+
+TEST_CASE("report keeps finished tests from a crashed Catch2 run", "[report]") {
+    tdd_guard::InputBuffer input;
+    input.append(R"({
+  "test-run": {
+    "test-cases": [
+      {
+        "test-info": {"name": "adds numbers"},
+        "runs": [{"path": []}],
+        "totals": {"assertions": {"passed": 1, "failed": 0}}
+      },
+      {
+        "test-info": {"name": "divides numbers"},
+        "runs": [{"path": [
+)");
+    input.append("Segmentation fault (core dumped)\n");
+
+    auto output = tdd_guard::build_report(input);
+
+    REQUIRE(output.test_modules.size() == 2);
+    CHECK(output.reason == "failed");
+    bool found_test = false;
+    bool found_error = false;
+    for (const auto& module : output.test_modules) {
+        for (const auto& test : module.tests) {
+            found_test = found_test || test.name == "adds numbers";
+            found_error = found_error ||
+                (!test.errors.empty() && test.errors[0].message == "Incomplete test output");
+        }
+    }
+    CHECK(found_test);
+    CHECK(found_error);
+}
+
+TEST_CASE("report builder parses lines as they arrive", "[report]") {
+    tdd_guard::InputBuffer input;
+    tdd_guard::ReportBuilder builder(input);
+
+    input.append(R"({"testsuites": [{"name": "MathTest", "testsuite": [)" "\n");
+    builder.update();
+    input.append(R"({"name": "Addition", "status": "RUN"}]}]})");
+    builder.update();
+
+    auto output = builder.finish();
+
+    REQUIRE(output.test_modules.size() == 1);
+    CHECK(output.test_modules[0].tests[0].full_name == "MathTest.Addition");
+}
+
+TEST_CASE("report builder reads a report starting part way through a line", "[report]") {
+    tdd_guard::InputBuffer input;
+    tdd_guard::ReportBuilder builder(input);
+
+    input.append("[ 50%] Building CXX object app.cpp.o\n");
+    builder.update();
+    // The buffer grows between updates, so the offset must not point into it
+    input.append(std::string(4096, '.') + "\nrunning: " R"({"testsuites": [{"name": "MathTest", "testsuite": [)" "\n");
+    builder.update();
+    input.append(R"(  {"name": "Addition", "status": "RUN"}]}]})" "\n");
+
+    auto output = builder.finish();
+
+    REQUIRE(output.test_modules.size() == 1);
+    CHECK(output.test_modules[0].tests[0].full_name == "MathTest.Addition");
+}
+
+TEST_CASE("report builder finds errors between clean lines", "[report]") {
+    tdd_guard::InputBuffer input;
+    tdd_guard::ReportBuilder builder(input);
+
+    input.append("[ 50%] Building CXX object CMakeFiles/app.dir/src/a.cpp.o\n");
+    builder.update();
+    input.append("[ 75%] Building CXX object CMakeFiles/app.dir/src/b.cpp.o\n"
+                 "src/b.cpp:4:2: error: expected ';' after expression\n"
+                 "[ 90%] Building CXX object CMakeFiles/app.dir/src/c.cpp.o\n"
+                 "note: declared here\n");
+    builder.update();
+    input.append("\x1b[31merr\x1b[0mor: linker command failed\n");
+
+    auto output = builder.finish();
+
+    REQUIRE(output.test_modules.size() == 1);
+    const auto& errors = output.test_modules[0].tests[0].errors;
+    REQUIRE(errors.size() == 2);
+    CHECK(errors[0].location == "src/b.cpp:4:2");
+    CHECK(errors[0].note == "declared here");
+    CHECK(errors[1].message == "linker command failed");
+}
+
+TEST_CASE("report peak memory stays within a small multiple of the input", "[report][memory]") {
+    const auto log = make_build_log(8 * 1024 * 1024);
+
+    tdd_guard::testing::AllocationScope scope;
+    {
+        tdd_guard::InputBuffer input;
+        for (std::size_t pos = 0; pos < log.size(); pos += 4096) {
+            input.append(std::string_view(log).substr(pos, 4096));
+        }
+        auto output = tdd_guard::build_report(input);
+        CHECK(output.test_modules.size() == 1);
+    }
+    const auto stats = scope.stats();
+
+    CHECK(stats.peak_bytes < 3 * log.size());
+}
+
+TEST_CASE("report allocations follow the test count rather than message size", "[report][memory]") {
+    const auto small = count_report_allocations(make_failing_report(200, 16));
+    const auto large = count_report_allocations(make_failing_report(200, 16 * 1024));
+    const auto twice = count_report_allocations(make_failing_report(400, 16));
+
+    // Longer messages cost the same number of allocations, each one larger
+    CHECK(large <= small + 16);
+    // A fixed number per test, plus container growth
+    CHECK(twice - small <= 200 * 8);
+    CHECK(twice > small);
+}
@@ -0,0 +1,193 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include "reporter.hpp"
+#include "result_cache.hpp"
+#include "test_support.hpp"
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Catch::Matchers::ContainsSubstring;
+
+namespace {
+
+using tdd_guard::testing::TempDir;
+
+// A fake test binary in a fresh project, run through run_cached
+struct CachedProject {
+    TempDir dir;
+    fs::path binary = tdd_guard::testing::write_fake_googletest(dir.path, "unit_tests");
+    std::ostringstream err;
+    int results_fd = -1;
+
+    CachedProject() {
+        results_fd = tdd_guard::open_results_dir(dir.path, err);
+        REQUIRE(results_fd >= 0);
+    }
+
+    ~CachedProject() {
+        ::close(results_fd);
+    }
+
+    auto run(std::vector<std::string> args = {}, tdd_guard::CacheOptions cache = {}) -> int {
+        args.insert(args.begin(), binary.string());
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(arg.data());
+        }
+        return tdd_guard::run_cached(results_fd, argv, -1, -1, {}, cache, err);
+    }
+
+    auto runs() const -> std::size_t {
+        return tdd_guard::testing::fake_runs(dir.path);
+    }
+
+    auto saved() const -> std::string {
+        return tdd_guard::testing::saved_results(dir.path);
+    }
+};
+
+// A 64-bit ELF file with only what the loader reads to find the library
+// it needs: one loaded segment, holding a dynamic section and its strings
+auto write_elf(const fs::path& path, const std::string& needed, const std::string& runpath) -> void {
+    constexpr Elf64_Addr BASE = 0x400000;
+    constexpr std::size_t DYNAMIC = sizeof(Elf64_Ehdr) + 2 * sizeof(Elf64_Phdr);
+    constexpr std::size_t STRINGS = DYNAMIC + 4 * sizeof(Elf64_Dyn);
+    const std::string strings = std::string(1, '\0') + needed + '\0' + runpath + '\0';
+    std::string file(STRINGS, '\0');
+    file += strings;
+
+    Elf64_Ehdr header {};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = std::endian::native == std::endian::little ? ELFDATA2LSB : ELFDATA2MSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_type = ET_EXEC;
+    header.e_version = EV_CURRENT;
+    header.e_phoff = sizeof(Elf64_Ehdr);
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_phentsize = sizeof(Elf64_Phdr);
+    header.e_phnum = 2;
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    const Elf64_Phdr segments[2] = {
+        {.p_type = PT_LOAD, .p_flags = PF_R, .p_offset = 0, .p_vaddr = BASE, .p_paddr = BASE,
+         .p_filesz = file.size(), .p_memsz = file.size(), .p_align = 0x1000},
+        {.p_type = PT_DYNAMIC, .p_flags = PF_R, .p_offset = DYNAMIC, .p_vaddr = BASE + DYNAMIC,
+         .p_paddr = BASE + DYNAMIC, .p_filesz = STRINGS - DYNAMIC, .p_memsz = STRINGS - DYNAMIC, .p_align = 8}
+    };
+    std::memcpy(file.data() + sizeof(header), segments, sizeof(segments));
+
+    Elf64_Dyn entries[4] = {};
+    entries[0].d_tag = DT_NEEDED;
+    entries[0].d_un.d_val = 1;
+    entries[1].d_tag = DT_STRTAB;
+    entries[1].d_un.d_ptr = BASE + STRINGS;
+    entries[2].d_tag = DT_RUNPATH;
+    entries[2].d_un.d_val = 1 + needed.size() + 1;
+    entries[3].d_tag = DT_NULL;
+    std::memcpy(file.data() + DYNAMIC, entries, sizeof(entries));
+
+    std::ofstream(path, std::ios::binary) << file;
+}
+
+auto key_of(int cache_fd, const fs::path& binary) -> std::optional<std::uint64_t> {
+    auto path = binary.string();
+    std::vector<char*> argv = {path.data()};
+    return tdd_guard::run_key(cache_fd, argv, {});
+}
+
+} // anonymous namespace
+
+TEST_CASE("an unchanged passing run is reused instead of run again", "[cache]") {
+    CachedProject project;
+
+    CHECK(project.run() == 0);
+    CHECK(project.runs() == 1);
+    CHECK(project.err.str().empty());
+    // Stands in for results a later run saved
+    std::ofstream(project.dir.path / ".claude" / "tdd-guard" / "data" / "test.json") << "{}";
+
+    CHECK(project.run() == 0);
+    CHECK(project.runs() == 1);
+    CHECK_THAT(project.err.str(), ContainsSubstring("reused the results"));
+    CHECK_THAT(project.saved(), ContainsSubstring(R"("fullName":"Math.Adds")"));
+    CHECK_THAT(project.saved(), ContainsSubstring(R"("reason":"passed")"));
+
+    CHECK(project.run({}, {.rerun = true, .env = {}}) == 0);
+    CHECK(project.runs() == 2);
+}
+
+TEST_CASE("the cache key covers the binary, its arguments and its environment", "[cache]") {
+    CachedProject project;
+    REQUIRE(project.run() == 0);
+
+    CHECK(project.run({"--gtest_filter=Math.*"}) == 0);
+    CHECK(project.runs() == 2);
+    CHECK(project.run({"--gtest_filter=Math.*"}) == 0);
+    CHECK(project.runs() == 2);
+
+    ::setenv("GTEST_SHUFFLE", "1", 1);
+    CHECK(project.run() == 0);
+    ::unsetenv("GTEST_SHUFFLE");
+    CHECK(project.runs() == 3);
+
+    ::setenv("TDD_GUARD_CACHE_TEST", "1", 1);
+    CHECK(project.run() == 0);
+    CHECK(project.runs() == 3);
+    CHECK(project.run({}, {.rerun = false, .env = {"TDD_GUARD_CACHE_TEST"}}) == 0);
+    ::unsetenv("TDD_GUARD_CACHE_TEST");
+    CHECK(project.runs() == 4);
+
+    // A rebuild changes the content, whatever the size and mtime
+    std::ofstream(project.binary, std::ios::app) << "# rebuilt\n";
+    CHECK(project.run() == 0);
+    CHECK(project.runs() == 5);
+}
+
+TEST_CASE("failing runs are not cached", "[cache]") {
+    CachedProject project;
+    std::ofstream(project.dir.path / "failing") << "Math.Divides\n";
+
+    CHECK(project.run() == 1);
+    CHECK(project.run() == 1);
+    CHECK(project.runs() == 2);
+    CHECK_THAT(project.saved(), ContainsSubstring(R"("reason":"failed")"));
+}
+
+TEST_CASE("the cache key covers the project libraries the binary loads", "[cache]") {
+    TempDir dir;
+    const auto binary = dir.path / "unit_tests";
+    const auto library = dir.path / "lib" / "libcore.so";
+    fs::create_directories(library.parent_path());
+    write_elf(binary, "libcore.so", "$ORIGIN/lib");
+    std::ofstream(library) << "version 1";
+    const int cache_fd = ::open(dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+    REQUIRE(cache_fd >= 0);
+
+    const auto before = key_of(cache_fd, binary);
+    REQUIRE(before);
+    CHECK(key_of(cache_fd, binary) == before);
+
+    // A rebuilt library changes the key though the binary stays the same
+    std::ofstream(library) << "version 2";
+    const auto rebuilt = key_of(cache_fd, binary);
+    CHECK(rebuilt);
+    CHECK(rebuilt != before);
+
+    // A library only the system directories hold is not part of the build
+    write_elf(binary, "libsystem-only.so", "$ORIGIN/lib");
+    CHECK(key_of(cache_fd, binary));
+    ::close(cache_fd);
+}
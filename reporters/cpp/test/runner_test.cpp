@@ -0,0 +1,154 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include "reporter.hpp"
+#include "runner.hpp"
+#include "test_support.hpp"
+#include <csignal>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Catch::Matchers::ContainsSubstring;
+
+namespace {
+
+// Outputs in these tests fit in a pipe, so nothing needs draining while
+// the child runs
+using tdd_guard::testing::Pipe;
+
+// argv for sh -c script; the strings must outlive the returned pointers
+auto shell(std::string& script) -> std::vector<char*> {
+    static std::string sh = "/bin/sh";
+    static std::string dash_c = "-c";
+    return {sh.data(), dash_c.data(), script.data()};
+}
+
+} // anonymous namespace
+
+TEST_CASE("run_child forwards and captures stdout and stderr apart", "[runner]") {
+    std::string script = "printf 'to stdout\\n'; printf 'to stderr\\n' >&2; printf 'more stdout'; exit 3";
+    const auto argv = shell(script);
+    Pipe out;
+    Pipe errors_out;
+    tdd_guard::InputBuffer output;
+    tdd_guard::InputBuffer errors;
+    std::ostringstream err;
+    int updates = 0;
+
+    const auto exit = tdd_guard::run_child(argv, out.write_fd, errors_out.write_fd, output, errors,
+                                           [&] { ++updates; }, err);
+
+    REQUIRE(exit.has_value());
+    CHECK(exit->exit_code == 3);
+    CHECK_FALSE(exit->signal.has_value());
+    CHECK(tdd_guard::exit_status(*exit) == 3);
+    CHECK(output.content() == "to stdout\nmore stdout");
+    CHECK(errors.content() == "to stderr\n");
+    CHECK(out.drain() == "to stdout\nmore stdout");
+    CHECK(errors_out.drain() == "to stderr\n");
+    CHECK(updates > 0);
+    CHECK(err.str().empty());
+}
+
+TEST_CASE("run_child reports the signal that ended the child", "[runner]") {
+    std::string script = "kill -TERM $$";
+    const auto argv = shell(script);
+    Pipe out;
+    tdd_guard::InputBuffer output;
+    tdd_guard::InputBuffer errors;
+    std::ostringstream err;
+
+    const auto exit = tdd_guard::run_child(argv, out.write_fd, out.write_fd, output, errors, {}, err);
+
+    REQUIRE(exit.has_value());
+    CHECK(exit->signal == SIGTERM);
+    CHECK_FALSE(exit->exit_code.has_value());
+    CHECK(tdd_guard::exit_status(*exit) == 128 + SIGTERM);
+}
+
+TEST_CASE("run_child reports commands that cannot be started", "[runner]") {
+    std::string command = "/nonexistent/tdd-guard-test-binary";
+    const std::vector<char*> argv = {command.data()};
+    Pipe out;
+    tdd_guard::InputBuffer output;
+    tdd_guard::InputBuffer errors;
+    std::ostringstream err;
+
+    const auto exit = tdd_guard::run_child(argv, out.write_fd, out.write_fd, output, errors, {}, err);
+
+    CHECK_FALSE(exit.has_value());
+    CHECK_THAT(err.str(), ContainsSubstring("Error starting /nonexistent/tdd-guard-test-binary"));
+}
+
+TEST_CASE("run_child reports children whose status cannot be collected", "[runner]") {
+    // With SIGCHLD ignored the kernel reaps the child itself and waitpid fails
+    struct sigaction ignore {};
+    ignore.sa_handler = SIG_IGN;
+    ::sigemptyset(&ignore.sa_mask);
+    struct sigaction previous {};
+    REQUIRE(::sigaction(SIGCHLD, &ignore, &previous) == 0);
+    std::string script = "exit 0";
+    const auto argv = shell(script);
+    tdd_guard::InputBuffer output;
+    tdd_guard::InputBuffer errors;
+    std::ostringstream err;
+
+    const auto exit = tdd_guard::run_child(argv, -1, -1, output, errors, {}, err);
+    ::sigaction(SIGCHLD, &previous, nullptr);
+
+    CHECK_FALSE(exit.has_value());
+    CHECK_THAT(err.str(), ContainsSubstring("Error waiting for /bin/sh"));
+}
+
+TEST_CASE("run_command saves the report and how the command ended", "[runner]") {
+    tdd_guard::testing::TempDir dir;
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+
+    // The stderr line would break the report if the streams were merged
+    std::string script =
+        R"(printf '{"testsuites": [{"name": "Math", "testsuite": [\n'; )"
+        R"(printf 'leaked {1 object}\n' >&2; )"
+        R"(printf '{"name": "Adds", "status": "RUN", "result": "COMPLETED"}]}]}\n'; exit 1)";
+    const auto argv = shell(script);
+    Pipe out;
+    Pipe errors_out;
+
+    const int status = tdd_guard::run_command(results_fd, argv, out.write_fd, errors_out.write_fd, {}, err);
+    ::close(results_fd);
+    const auto saved = tdd_guard::testing::saved_results(dir.path);
+
+    CHECK(status == 1);
+    CHECK(err.str().empty());
+    CHECK_THAT(saved, ContainsSubstring(R"("fullName":"Math.Adds")"));
+    CHECK_THAT(saved, ContainsSubstring(R"("process":{"exitCode":1})"));
+    CHECK_THAT(saved, ContainsSubstring(R"("reason":"failed")"));
+}
+
+TEST_CASE("run_command saves a failed run when the command cannot be started", "[runner]") {
+    tdd_guard::testing::TempDir dir;
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    // A passing run from before must not stand for this one
+    std::string script = R"(printf '{"testsuites": [{"name": "Math", "testsuite": [{"name": "Adds"}]}]}\n')";
+    REQUIRE(tdd_guard::run_command(results_fd, shell(script), -1, -1, {}, err) == 0);
+    std::string command = "/nonexistent/tdd-guard-test-binary";
+    const std::vector<char*> argv = {command.data()};
+
+    const int status = tdd_guard::run_command(results_fd, argv, -1, -1, {}, err);
+    ::close(results_fd);
+    const auto saved = tdd_guard::testing::saved_results(dir.path);
+
+    CHECK(status == 127);
+    CHECK_THAT(err.str(), ContainsSubstring("Error starting /nonexistent/tdd-guard-test-binary"));
+    CHECK_THAT(saved, ContainsSubstring("Test command not started"));
+    CHECK_THAT(saved, ContainsSubstring(R"("process":{"exitCode":127})"));
+    CHECK_THAT(saved, ContainsSubstring(R"("reason":"failed")"));
+    CHECK_THAT(saved, !ContainsSubstring("Math.Adds"));
+}
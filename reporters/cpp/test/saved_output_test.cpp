@@ -0,0 +1,44 @@
+#include <catch2/catch_test_macros.hpp>
+#include "saved_output.hpp"
+
+using tdd_guard::TestEvent;
+
+TEST_CASE("saved output reads back as it was written", "[saved_output]") {
+    auto output = tdd_guard::transform_events({
+        {.name = "Adds", .full_name = "Math.Adds", .state = TestEvent::State::Passed,
+         .duration = std::chrono::microseconds(2500)},
+        {.name = "Divides", .full_name = "Math.Divides", .state = TestEvent::State::Failed,
+         .failure_messages = {"Expected: 2\n  Actual: \"1\""}},
+        {.name = "Skips", .full_name = "Text.Skips", .state = TestEvent::State::Skipped}
+    }, {{.code = "E1", .file = "a.cpp", .line = 3, .column = 1, .message = "use of undeclared identifier 'x'",
+         .note = "here"}});
+    tdd_guard::record_process_exit(output, {.exit_code = 2});
+    const auto json = output.to_json();
+
+    const auto read = tdd_guard::parse_saved_output(json);
+
+    REQUIRE(read.has_value());
+    CHECK(read->to_json() == json);
+}
+
+TEST_CASE("saved output keeps a signal", "[saved_output]") {
+    tdd_guard::TddGuardOutput output;
+    tdd_guard::record_process_exit(output, {.signal = 11});
+
+    const auto read = tdd_guard::parse_saved_output(output.to_json());
+
+    REQUIRE(read.has_value());
+    REQUIRE(read->process.has_value());
+    CHECK(read->process->signal == 11);
+    CHECK_FALSE(read->process->exit_code.has_value());
+}
+
+TEST_CASE("saved output rejects anything else", "[saved_output]") {
+    CHECK_FALSE(tdd_guard::parse_saved_output("").has_value());
+    CHECK_FALSE(tdd_guard::parse_saved_output(R"({"testModules": [{"moduleId": "M", "tests": [)").has_value());
+    CHECK_FALSE(tdd_guard::parse_saved_output(R"({"testModules": [], "extra": 1})").has_value());
+    CHECK_FALSE(tdd_guard::parse_saved_output(
+        R"({"testModules": [{"moduleId": "M", "tests": [{"fullName": "M.A", "name": "A", "state": "odd"}]}]})")
+                    .has_value());
+    CHECK_FALSE(tdd_guard::parse_saved_output(R"([])").has_value());
+}
@@ -0,0 +1,287 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include "reporter.hpp"
+#include "shards.hpp"
+#include "test_support.hpp"
+#include "transformer.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using Catch::Matchers::ContainsSubstring;
+using std::chrono::milliseconds;
+
+namespace {
+
+using tdd_guard::testing::TempDir;
+using tdd_guard::testing::read_file;
+using tdd_guard::testing::saved_results;
+using tdd_guard::testing::write_fake_googletest;
+
+// The fake binary fails Math.Divides in these tests
+auto write_failing_fake(const fs::path& dir) -> std::string {
+    std::ofstream(dir / "failing") << "Math.Divides\n";
+    return write_fake_googletest(dir);
+}
+
+// Runs the fake binary in dir with its output discarded
+auto run_fake_googletest(const fs::path& dir, unsigned jobs, std::ostream& err) -> int {
+    const int results_fd = tdd_guard::open_results_dir(dir, err);
+    REQUIRE(results_fd >= 0);
+    auto path = (dir / "fake_tests").string();
+    std::vector<char*> argv = {path.data()};
+    const int status = tdd_guard::run_sharded(results_fd, argv, -1, -1, {.jobs = jobs}, err);
+    ::close(results_fd);
+    return status;
+}
+
+auto lines_of(const std::string& text) -> std::vector<std::string> {
+    std::vector<std::string> lines;
+    std::istringstream stream(text);
+    for (std::string line; std::getline(stream, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+} // anonymous namespace
+
+TEST_CASE("GoogleTest listings name every test with its suite", "[shards]") {
+    const auto tests = tdd_guard::parse_googletest_listing(
+        "Running main() from gtest_main.cc\n"
+        "Math.\n"
+        "  Adds\n"
+        "  Divides\n"
+        "Typed/0.  # TypeParam = int\n"
+        "  Works\n"
+        "Values/Param.\n"
+        "  Holds/1  # GetParam() = 2\n");
+
+    CHECK(tests == std::vector<std::string>{"Math.Adds", "Math.Divides", "Typed/0.Works", "Values/Param.Holds/1"});
+}
+
+TEST_CASE("Catch2 listings name one test case per line", "[shards]") {
+    const auto tests = tdd_guard::parse_catch2_listing("adds numbers\r\nsplits, then joins\n\n");
+
+    CHECK(tests == std::vector<std::string>{"adds numbers", "splits, then joins"});
+}
+
+TEST_CASE("Catch2 test names starting with # are listed and selected", "[shards]") {
+    const auto tests = tdd_guard::parse_catch2_listing("\"#12 keeps the hash\"\nadds numbers\n");
+
+    REQUIRE(tests == std::vector<std::string>{"#12 keeps the hash", "adds numbers"});
+    CHECK(tdd_guard::catch2_spec_line(tests[0]) == "\\#12 keeps the hash");
+    CHECK(tdd_guard::catch2_spec_line(R"(says "hi" \ there)") == R"(says \"hi\" \\ there)");
+}
+
+TEST_CASE("batches are balanced by the time tests took before", "[shards]") {
+    std::vector<tdd_guard::TestEvent> previous = {
+        {.name = "Slow", .full_name = "M.Slow", .state = tdd_guard::TestEvent::State::Passed, .duration = milliseconds(90)},
+        {.name = "A", .full_name = "M.A", .state = tdd_guard::TestEvent::State::Passed, .duration = milliseconds(30)},
+        {.name = "B", .full_name = "M.B", .state = tdd_guard::TestEvent::State::Passed, .duration = milliseconds(30)},
+        {.name = "C", .full_name = "M.C", .state = tdd_guard::TestEvent::State::Passed, .duration = milliseconds(30)}
+    };
+    const auto history = tdd_guard::TestHistory::parse(tdd_guard::transform_events(previous, {}).to_json());
+    const std::vector<std::string> tests = {"M.A", "M.B", "M.Slow", "M.C", "M.New"};
+
+    const auto batches = tdd_guard::plan_batches(tests, history, 2);
+
+    // The new test is expected to take the mean, 45 ms: 90 + 30 against 45 + 30 + 30
+    REQUIRE(batches.size() == 2);
+    CHECK(batches[0] == std::vector<std::size_t>{2, 3});
+    CHECK(batches[1] == std::vector<std::size_t>{0, 1, 4});
+    CHECK(tdd_guard::plan_batches(tests, history, 100).size() == tests.size());
+    CHECK(tdd_guard::plan_batches({}, history, 4).empty());
+}
+
+TEST_CASE("batches stay within the filter size however long their tests take", "[shards]") {
+    std::vector<tdd_guard::TestEvent> previous = {
+        {.name = "Slow", .full_name = "M.Slow", .state = tdd_guard::TestEvent::State::Passed, .duration = milliseconds(900)}
+    };
+    std::vector<std::string> tests = {"M.Slow"};
+    for (int i = 0; i < 200; ++i) {
+        previous.push_back({.name = "T" + std::to_string(i), .full_name = "M.T" + std::to_string(i),
+                            .state = tdd_guard::TestEvent::State::Passed, .duration = milliseconds(1)});
+        tests.push_back("M.T" + std::to_string(i));
+    }
+    const auto history = tdd_guard::TestHistory::parse(tdd_guard::transform_events(previous, {}).to_json());
+    constexpr std::size_t max_bytes = 100;
+
+    // Balanced by time alone, the slow test would be alone and the short
+    // ones would all share the other batch
+    const auto batches = tdd_guard::plan_batches(tests, history, 2, max_bytes);
+
+    std::vector<std::size_t> planned;
+    for (const auto& batch : batches) {
+        std::size_t bytes = 0;
+        for (const auto test : batch) {
+            bytes += tests[test].size() + 1;
+            planned.push_back(test);
+        }
+        CHECK(bytes <= max_bytes);
+    }
+    std::sort(planned.begin(), planned.end());
+    CHECK(planned.size() == tests.size());
+    CHECK(std::adjacent_find(planned.begin(), planned.end()) == planned.end());
+    CHECK(batches.front() == std::vector<std::size_t>{0});
+}
+
+TEST_CASE("sharded runs merge every batch into one report", "[shards]") {
+    TempDir dir;
+    auto path = write_failing_fake(dir.path);
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    std::vector<char*> argv = {path.data()};
+    char out_name[] = "/tmp/tdd-guard-shards-out-XXXXXX";
+    const int out_fd = ::mkstemp(out_name);
+    REQUIRE(out_fd >= 0);
+
+    const int status = tdd_guard::run_sharded(results_fd, argv, out_fd, -1, {.jobs = 2}, err);
+    ::close(results_fd);
+    ::close(out_fd);
+    const auto forwarded = read_file(out_name);
+    ::unlink(out_name);
+    const auto saved = saved_results(dir.path);
+
+    CHECK(status == 1);
+    CHECK(err.str().empty());
+    CHECK_THAT(forwarded, ContainsSubstring("ran "));
+    CHECK_THAT(saved, ContainsSubstring(R"("process":{"exitCode":1})"));
+    const auto history = tdd_guard::TestHistory::parse(saved);
+    REQUIRE(history.records().size() == 3);
+    CHECK(history.find("Math.Adds")->state == tdd_guard::TestEvent::State::Passed);
+    CHECK(history.find("Math.Divides")->state == tdd_guard::TestEvent::State::Failed);
+    CHECK(history.find("Text.Joins")->duration == milliseconds(2));
+}
+
+TEST_CASE("tests that failed last time run first and are saved before the rest", "[shards]") {
+    TempDir dir;
+    (void)write_failing_fake(dir.path);
+    std::ostringstream err;
+    REQUIRE(run_fake_googletest(dir.path, 1, err) == 1);
+    fs::remove(dir.path / "runs.log");
+
+    const int status = run_fake_googletest(dir.path, 1, err);
+
+    CHECK(status == 1);
+    CHECK(err.str().empty());
+    const auto filters = lines_of(read_file(dir.path / "runs.log"));
+    REQUIRE(filters.size() == 3);
+    CHECK(filters[0] == "Math.Divides");
+    // The rest of the suite found the result of the failed test alone
+    const auto intermediate = tdd_guard::TestHistory::parse(read_file(dir.path / ("seen-" + filters[1] + ".json")));
+    REQUIRE(intermediate.records().size() == 1);
+    CHECK(intermediate.failed("Math.Divides"));
+    const auto saved = saved_results(dir.path);
+    CHECK(tdd_guard::TestHistory::parse(saved).records().size() == 3);
+    CHECK_THAT(saved, ContainsSubstring(R"("process":{"exitCode":1})"));
+}
+
+TEST_CASE("sharded runs keep the command line's own test filter", "[shards]") {
+    TempDir dir;
+    auto path = write_fake_googletest(dir.path);
+    std::string filter = "--gtest_filter=Math.*";
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    std::vector<char*> argv = {path.data(), filter.data()};
+    const int status = tdd_guard::run_sharded(results_fd, argv, -1, -1, {.jobs = 2}, err);
+    ::close(results_fd);
+
+    CHECK(status == 0);
+    CHECK(err.str().empty());
+    for (const auto& batch : lines_of(read_file(dir.path / "runs.log"))) {
+        CHECK_THAT(batch, !ContainsSubstring("Text.Joins"));
+    }
+    const auto history = tdd_guard::TestHistory::parse(saved_results(dir.path));
+    CHECK(history.records().size() == 2);
+    CHECK(history.find("Text.Joins") == nullptr);
+}
+
+TEST_CASE("batches that cannot be started fail the run and name their tests", "[shards]") {
+    TempDir dir;
+    // Lists two tests, then removes itself when the first batch runs
+    const auto path = (dir.path / "vanishing_tests").string();
+    std::ofstream(path) << R"(#!/bin/sh
+for arg; do
+    case "$arg" in
+        --gtest_list_tests) printf 'Math.\n  Adds\n  Divides\n'; exit 0 ;;
+        --gtest_filter=*) filter="${arg#--gtest_filter=}" ;;
+        --gtest_output=json:*) report="${arg#--gtest_output=json:}" ;;
+    esac
+done
+rm "$0"
+echo "{\"testsuites\": [{\"name\": \"Math\", \"testsuite\": [{\"name\": \"${filter#Math.}\", \"status\": \"RUN\", \"result\": \"COMPLETED\", \"time\": \"0.001s\"}]}]}" > "$report"
+)";
+    fs::permissions(path, fs::perms::owner_all);
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    auto argv_path = path;
+    std::vector<char*> argv = {argv_path.data()};
+    const int status = tdd_guard::run_sharded(results_fd, argv, -1, -1, {.jobs = 1}, err);
+    ::close(results_fd);
+
+    CHECK(status == 127);
+    CHECK_THAT(err.str(), ContainsSubstring("Error starting"));
+    const auto saved = saved_results(dir.path);
+    CHECK_THAT(saved, ContainsSubstring(R"("reason":"failed")"));
+    CHECK_THAT(saved, ContainsSubstring(R"("process":{"exitCode":127})"));
+    CHECK_THAT(saved, ContainsSubstring("Test batch not started"));
+    // The first batch runs the test the other batch names
+    const auto history = tdd_guard::TestHistory::parse(saved);
+    CHECK(history.find("compilation::build") != nullptr);
+    const auto not_run = history.find("Math.Adds") != nullptr ? "Math.Divides" : "Math.Adds";
+    CHECK(history.find(not_run) == nullptr);
+    CHECK_THAT(saved, ContainsSubstring(std::string("not run: ") + not_run));
+}
+
+TEST_CASE("runs where no batch starts still replace the previous results", "[shards]") {
+    TempDir dir;
+    // Lists its tests, then removes itself before any batch runs
+    const auto path = (dir.path / "listing_only").string();
+    std::ofstream(path) << "#!/bin/sh\nrm \"$0\"\nprintf 'Math.\\n  Adds\\n'\n";
+    fs::permissions(path, fs::perms::owner_all);
+
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    auto argv_path = path;
+    std::vector<char*> argv = {argv_path.data()};
+    const int status = tdd_guard::run_sharded(results_fd, argv, -1, -1, {.jobs = 1}, err);
+    ::close(results_fd);
+
+    CHECK(status == 127);
+    const auto saved = saved_results(dir.path);
+    CHECK_THAT(saved, ContainsSubstring(R"("process":{"exitCode":127})"));
+    CHECK_THAT(saved, ContainsSubstring("not run: Math.Adds"));
+}
+
+TEST_CASE("Catch2 test specs and input files select tests", "[shards]") {
+    auto selects = [](std::vector<std::string> args) {
+        std::vector<char*> argv;
+        for (auto& arg : args) {
+            argv.push_back(arg.data());
+        }
+        return tdd_guard::catch2_selects_tests(argv);
+    };
+
+    CHECK(selects({"[fast]"}));
+    CHECK(selects({"--order", "rand", "adds numbers"}));
+    CHECK(selects({"-f", "specs.txt"}));
+    CHECK(selects({"--input-file=specs.txt"}));
+    CHECK_FALSE(selects({}));
+    CHECK_FALSE(selects({"--order", "rand", "-r", "console", "--success"}));
+    CHECK_FALSE(selects({"--rng-seed=7", "-v", "high"}));
+}
@@ -0,0 +1,54 @@
+#include <catch2/catch_test_macros.hpp>
+#include "spsc_ring.hpp"
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ring pops values in push order", "[spsc_ring]") {
+    tdd_guard::SpscRing<int, 4> ring;
+
+    for (int value : {1, 2, 3}) {
+        REQUIRE(ring.try_push(value));
+    }
+
+    CHECK(ring.try_pop() == 1);
+    CHECK(ring.try_pop() == 2);
+    CHECK(ring.try_pop() == 3);
+    CHECK_FALSE(ring.try_pop().has_value());
+}
+
+TEST_CASE("ring rejects pushes when full", "[spsc_ring]") {
+    tdd_guard::SpscRing<int, 2> ring;
+    int value = 1;
+
+    CHECK(ring.try_push(value));
+    CHECK(ring.try_push(value));
+    CHECK_FALSE(ring.try_push(value));
+
+    CHECK(ring.try_pop() == 1);
+    CHECK(ring.try_push(value));
+}
+
+TEST_CASE("ring hands values between threads in order", "[spsc_ring]") {
+    constexpr int COUNT = 200000;
+    tdd_guard::SpscRing<int, 8> ring;
+
+    std::thread producer([&] {
+        for (int i = 0; i < COUNT; ++i) {
+            ring.push(i);
+        }
+    });
+
+    std::vector<int> received;
+    received.reserve(COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+        received.push_back(ring.pop());
+    }
+    producer.join();
+
+    bool in_order = true;
+    for (int i = 0; i < COUNT; ++i) {
+        in_order = in_order && received[static_cast<std::size_t>(i)] == i;
+    }
+    CHECK(in_order);
+}
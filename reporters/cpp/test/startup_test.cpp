@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+#include "test_support.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <optional>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// What an empty run may add to the cost of starting any process
+constexpr auto STARTUP_BUDGET = std::chrono::milliseconds(2);
+constexpr int RUNS = 15;
+
+// Runs argv with stdin and stdout on /dev/null and returns the median wall
+// time of the runs, or nullopt if any run failed
+auto median_run_time(std::vector<std::string> argv) -> std::optional<std::chrono::nanoseconds> {
+    std::vector<char*> args;
+    for (auto& arg : argv) {
+        args.push_back(arg.data());
+    }
+    args.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::vector<std::chrono::nanoseconds> times;
+    bool succeeded = true;
+    for (int i = 0; i < RUNS && succeeded; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        pid_t pid = 0;
+        int status = 0;
+        succeeded = ::posix_spawn(&pid, args[0], &actions, nullptr, args.data(), environ) == 0 &&
+                    ::waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        times.push_back(std::chrono::steady_clock::now() - start);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (!succeeded) {
+        return std::nullopt;
+    }
+    std::nth_element(times.begin(), times.begin() + RUNS / 2, times.end());
+    return times[RUNS / 2];
+}
+
+} // anonymous namespace
+
+// Wall-clock budgets fail on loaded machines and in Debug or sanitizer
+// builds, so this is hidden from the default run; scripts/test.sh runs it
+TEST_CASE("an empty run stays within the startup budget", "[.][startup]") {
+    tdd_guard::testing::TempDir root;
+
+    const auto baseline = median_run_time({fs::exists("/bin/true") ? "/bin/true" : "/usr/bin/true"});
+    const auto reporter = median_run_time({TDD_GUARD_CPP_BINARY, "--project-root", root.path.string(),
+                                           "--passthrough", "--no-daemon"});
+    const bool saved = fs::exists(root.path / ".claude" / "tdd-guard" / "data" / "test.json");
+
+    REQUIRE(baseline.has_value());
+    REQUIRE(reporter.has_value());
+    CHECK(saved);
+    const auto overhead = *reporter - *baseline;
+    INFO("reporter " << reporter->count() / 1000 << " us, process baseline " << baseline->count() / 1000 << " us");
+    CHECK(overhead < STARTUP_BUDGET);
+}
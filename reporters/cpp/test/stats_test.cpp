@@ -0,0 +1,143 @@
+#include <catch2/catch_test_macros.hpp>
+#include "report.hpp"
+#include "reporter.hpp"
+#include "stats.hpp"
+#include "test_support.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+auto calls(const tdd_guard::RunStats& stats, tdd_guard::Phase phase) -> std::uint64_t {
+    return stats.phases[static_cast<std::size_t>(phase)].calls;
+}
+
+// Leaves stats disabled and cleared for the next test
+struct StatsScope {
+    explicit StatsScope(bool enable) {
+        tdd_guard::reset_stats();
+        tdd_guard::set_stats_enabled(enable);
+    }
+    ~StatsScope() {
+        tdd_guard::set_stats_enabled(false);
+        tdd_guard::reset_stats();
+    }
+};
+
+} // anonymous namespace
+
+TEST_CASE("phase timers record nothing while disabled", "[stats]") {
+    StatsScope scope(false);
+    {
+        TDD_GUARD_TIME_PHASE(Transform);
+    }
+
+    CHECK(calls(tdd_guard::collect_stats(), tdd_guard::Phase::Transform) == 0);
+}
+
+TEST_CASE("phase timers accumulate wall and CPU time", "[stats]") {
+    StatsScope scope(true);
+    for (int i = 0; i < 3; ++i) {
+        TDD_GUARD_TIME_PHASE(Serialize);
+        volatile std::uint64_t sink = 0;
+        for (std::uint64_t n = 0; n < 100000; ++n) {
+            sink = sink + n;
+        }
+    }
+
+    const auto stats = tdd_guard::collect_stats();
+    const auto& serialize = stats.phases[static_cast<std::size_t>(tdd_guard::Phase::Serialize)];
+    CHECK(serialize.calls == 3);
+    CHECK(serialize.wall.count() > 0);
+    CHECK(serialize.cpu.count() > 0);
+    CHECK(stats.peak_rss_bytes > 0);
+}
+
+TEST_CASE("building a report times each phase", "[stats]") {
+    StatsScope scope(true);
+    tdd_guard::InputBuffer input;
+    input.append("src/a.cpp:1:2: error: boom\n");
+    input.append(R"({"testsuites": [{"name": "S", "testsuite": [{"name": "T", "status": "RUN"}]}]})");
+
+    auto output = tdd_guard::build_report(input);
+
+    const auto stats = tdd_guard::collect_stats();
+    CHECK(calls(stats, tdd_guard::Phase::ScanLines) == 2);
+    CHECK(calls(stats, tdd_guard::Phase::ParseJson) >= 1);
+    CHECK(calls(stats, tdd_guard::Phase::ParseErrors) >= 1);
+    CHECK(calls(stats, tdd_guard::Phase::Transform) == 1);
+}
+
+TEST_CASE("nested phases are left out of the phase around them", "[stats]") {
+    StatsScope scope(true);
+    const auto start = std::chrono::steady_clock::now();
+    {
+        TDD_GUARD_TIME_PHASE(Forward);
+        {
+            TDD_GUARD_TIME_PHASE(ParseJson);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const auto stats = tdd_guard::collect_stats();
+    const auto& forward = stats.phases[static_cast<std::size_t>(tdd_guard::Phase::Forward)];
+    const auto& parse = stats.phases[static_cast<std::size_t>(tdd_guard::Phase::ParseJson)];
+    CHECK(parse.wall >= std::chrono::milliseconds(20));
+    CHECK(forward.wall + parse.wall <= elapsed);
+    CHECK(forward.calls == 1);
+}
+
+TEST_CASE("stats serialize as JSON", "[stats]") {
+    tdd_guard::RunStats stats;
+    stats.bytes = 1234;
+    stats.lines = 56;
+    stats.tests = 7;
+    stats.peak_rss_bytes = 4096;
+    stats.phases[static_cast<std::size_t>(tdd_guard::Phase::ParseJson)] = {
+        .wall = std::chrono::microseconds(1500), .cpu = std::chrono::microseconds(1250), .calls = 2};
+
+    tdd_guard::JsonWriter writer;
+    tdd_guard::write_stats_json(writer, stats);
+    auto json = nlohmann::json::parse(writer.take());
+
+    CHECK(json["bytes"] == 1234);
+    CHECK(json["lines"] == 56);
+    CHECK(json["tests"] == 7);
+    CHECK(json["peakRssBytes"] == 4096);
+    CHECK(json["phases"].size() == tdd_guard::PHASE_COUNT);
+    CHECK(json["phases"]["parse_json"] == nlohmann::json{{"calls", 2}, {"cpuMs", 1.25}, {"wallMs", 1.5}});
+    CHECK(json["phases"]["save"]["calls"] == 0);
+}
+
+TEST_CASE("runs with stats save stats.json beside test.json", "[stats]") {
+    StatsScope scope(true);
+    tdd_guard::testing::TempDir dir;
+    std::ostringstream err;
+    const int results_fd = tdd_guard::open_results_dir(dir.path, err);
+    REQUIRE(results_fd >= 0);
+    std::string sh = "/bin/sh";
+    std::string dash_c = "-c";
+    std::string script = R"(printf '{"testsuites": [{"name": "Math", "testsuite": [{"name": "Adds"}]}]}\n')";
+    std::vector<char*> argv = {sh.data(), dash_c.data(), script.data()};
+
+    const int status = tdd_guard::run_command(results_fd, argv, -1, -1, {}, err);
+    ::close(results_fd);
+
+    CHECK(status == 0);
+    const auto data = dir.path / ".claude" / "tdd-guard" / "data";
+    std::vector<std::string> files;
+    for (const auto& entry : std::filesystem::directory_iterator(data)) {
+        files.push_back(entry.path().filename().string());
+    }
+    std::sort(files.begin(), files.end());
+    CHECK(files == std::vector<std::string>{"stats.json", "test.json"});
+    const auto stats = nlohmann::json::parse(tdd_guard::testing::read_file(data / "stats.json"));
+    CHECK(stats.is_object());
+}
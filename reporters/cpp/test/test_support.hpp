@@ -0,0 +1,179 @@
+#pragma once
+
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+namespace tdd_guard::testing {
+
+// A fresh directory under /tmp, removed with everything in it
+struct TempDir {
+    std::filesystem::path path;
+
+    TempDir() {
+        char name[] = "/tmp/tdd-guard-test-XXXXXX";
+        REQUIRE(::mkdtemp(name) != nullptr);
+        path = name;
+    }
+
+    ~TempDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    auto operator=(const TempDir&) -> TempDir& = delete;
+};
+
+// Everything fd has left to read
+inline auto read_all(int fd) -> std::string {
+    std::string content;
+    char block[4096];
+    for (ssize_t count; (count = ::read(fd, block, sizeof(block))) > 0;) {
+        content.append(block, static_cast<std::size_t>(count));
+    }
+    return content;
+}
+
+struct Pipe {
+    int read_fd = -1;
+    int write_fd = -1;
+
+    Pipe() {
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+        read_fd = fds[0];
+        write_fd = fds[1];
+    }
+
+    ~Pipe() {
+        close_read();
+        close_write();
+    }
+
+    Pipe(const Pipe&) = delete;
+    auto operator=(const Pipe&) -> Pipe& = delete;
+
+    void close_read() {
+        if (read_fd >= 0) ::close(read_fd);
+        read_fd = -1;
+    }
+
+    void close_write() {
+        if (write_fd >= 0) ::close(write_fd);
+        write_fd = -1;
+    }
+
+    // Everything written so far; closes the writing end first
+    auto drain() -> std::string {
+        close_write();
+        return read_all(read_fd);
+    }
+};
+
+inline auto read_file(const std::filesystem::path& path) -> std::string {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+// test.json of a project root
+inline auto saved_results(const std::filesystem::path& root) -> std::string {
+    return read_file(root / ".claude" / "tdd-guard" / "data" / "test.json");
+}
+
+// Stands in for a GoogleTest binary with the tests Math.Adds, Math.Divides
+// and Text.Joins. It lists and runs the tests --gtest_filter selects, fails
+// those named in the file "failing" next to it, and writes its report to
+// the --gtest_output file or else to stdout. Each run appends its filter to
+// runs.log next to it and keeps a copy of the test.json it found there.
+inline const std::string FAKE_GOOGLETEST = R"(#!/bin/sh
+dir=$(dirname "$0")
+filter='*'
+list=''
+report=''
+for arg; do
+    case "$arg" in
+        --gtest_list_tests) list=1 ;;
+        --gtest_filter=*) filter="${arg#--gtest_filter=}" ;;
+        --gtest_output=json:*) report="${arg#--gtest_output=json:}" ;;
+    esac
+done
+
+matches() (
+    set -f
+    IFS=:
+    for pattern in $2; do
+        case "$1" in $pattern) return 0 ;; esac
+    done
+    return 1
+)
+
+selected() {
+    case "$filter" in
+        *-*) positive="${filter%%-*}"; negative="${filter#*-}" ;;
+        *) positive="$filter"; negative='' ;;
+    esac
+    matches "$1" "${positive:-*}" && ! matches "$1" "$negative"
+}
+
+if [ -n "$list" ]; then
+    echo 'Running main() from gtest_main.cc'
+    suite=''
+    for test in Math.Adds Math.Divides Text.Joins; do
+        selected "$test" || continue
+        if [ "${test%%.*}" != "$suite" ]; then
+            suite="${test%%.*}"
+            echo "$suite."
+        fi
+        comment=''
+        if [ "$test" = Text.Joins ]; then comment='  # GetParam() = 1'; fi
+        echo "  ${test#*.}$comment"
+    done
+    exit 0
+fi
+
+echo "$filter" >> "$dir/runs.log"
+cp "$dir/.claude/tdd-guard/data/test.json" "$dir/seen-$filter.json" 2>/dev/null
+status=0
+json='{"testsuites": ['
+separator=''
+for test in Math.Adds Math.Divides Text.Joins; do
+    selected "$test" || continue
+    failures=''
+    if grep -qx "$test" "$dir/failing" 2>/dev/null; then
+        failures=', "failures": [{"failure": "expected 2"}]'
+        status=1
+    fi
+    json="$json$separator{\"name\": \"${test%%.*}\", \"testsuite\": [{\"name\": \"${test#*.}\", \"status\": \"RUN\", \"result\": \"COMPLETED\", \"time\": \"0.002s\"$failures}]}"
+    separator=', '
+done
+json="$json]}"
+if [ -n "$report" ]; then
+    echo "$json" > "$report"
+    echo "ran $filter"
+else
+    echo "$json"
+fi
+exit $status
+)";
+
+// Writes FAKE_GOOGLETEST into dir and returns its path
+inline auto write_fake_googletest(const std::filesystem::path& dir, const std::string& name = "fake_tests")
+    -> std::string {
+    const auto binary = dir / name;
+    std::ofstream(binary) << FAKE_GOOGLETEST;
+    std::filesystem::permissions(binary, std::filesystem::perms::owner_all);
+    return binary.string();
+}
+
+// How many times the fake in dir ran its tests
+inline auto fake_runs(const std::filesystem::path& dir) -> std::size_t {
+    const auto log = read_file(dir / "runs.log");
+    return static_cast<std::size_t>(std::count(log.begin(), log.end(), '\n'));
+}
+
+} // namespace tdd_guard::testing
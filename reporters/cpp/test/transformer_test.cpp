@@ -1,6 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 #include "transformer.hpp"
+#include <nlohmann/json.hpp>
 
 using Catch::Matchers::ContainsSubstring;
 
@@ -20,7 +21,7 @@ TEST_CASE("transform passing test", "[transformer]") {
     CHECK(output.test_modules[0].module_id == "MathTest");
     REQUIRE(output.test_modules[0].tests.size() == 1);
     CHECK(output.test_modules[0].tests[0].name == "Addition");
-    CHECK(output.test_modules[0].tests[0].state == "passed");
+    CHECK(output.test_modules[0].tests[0].state == tdd_guard::TestEvent::State::Passed);
     CHECK(output.reason == "passed");
 }
 
@@ -37,7 +38,7 @@ TEST_CASE("transform failing test", "[transformer]") {
     auto output = tdd_guard::transform_events(events, {});
 
     REQUIRE(output.test_modules.size() == 1);
-    CHECK(output.test_modules[0].tests[0].state == "failed");
+    CHECK(output.test_modules[0].tests[0].state == tdd_guard::TestEvent::State::Failed);
     CHECK(output.test_modules[0].tests[0].errors.size() == 1);
     CHECK(output.reason == "failed");
 }
@@ -59,7 +60,7 @@ TEST_CASE("transform compilation errors", "[transformer]") {
     CHECK(output.test_modules[0].module_id == "compilation");
     REQUIRE(output.test_modules[0].tests.size() == 1);
     CHECK(output.test_modules[0].tests[0].name == "build");
-    CHECK(output.test_modules[0].tests[0].state == "failed");
+    CHECK(output.test_modules[0].tests[0].state == tdd_guard::TestEvent::State::Failed);
     CHECK(output.reason == "failed");
 }
 
@@ -96,3 +97,219 @@ TEST_CASE("modules are sorted alphabetically", "[transformer]") {
     CHECK(output.test_modules[1].module_id == "Middle");
     CHECK(output.test_modules[2].module_id == "Zoo");
 }
+
+TEST_CASE("to_json matches the nlohmann document byte for byte", "[transformer]") {
+    std::vector<tdd_guard::TestEvent> events = {
+        {.name = "Ok", .full_name = "Suite.Ok", .state = tdd_guard::TestEvent::State::Passed},
+        {.name = "Bad", .full_name = "Suite.Bad", .state = tdd_guard::TestEvent::State::Failed,
+         .failure_messages = {"expected \"1\"\n\tgot\\ \x01 caf\xc3\xa9"}},
+        {.name = "Later", .full_name = "Other.Later", .state = tdd_guard::TestEvent::State::Skipped}
+    };
+    std::vector<tdd_guard::CompilationError> errors = {{
+        .code = "E1", .file = "main.cpp", .line = 3, .column = 7,
+        .message = "no member", .help = "did you mean", .note = "declared here"
+    }};
+
+    auto output = tdd_guard::transform_events(events, errors);
+    output.test_modules[1].tests[1].errors[0].expected = "1";
+    output.test_modules[1].tests[1].errors[0].actual = "2";
+
+    nlohmann::json modules = nlohmann::json::array();
+    for (const auto& module : output.test_modules) {
+        nlohmann::json tests = nlohmann::json::array();
+        for (const auto& test : module.tests) {
+            nlohmann::json test_obj = {{"name", test.name}, {"fullName", test.full_name}, {"state", tdd_guard::state_name(test.state)}};
+            for (const auto& error : test.errors) {
+                nlohmann::json error_obj = {{"message", error.message}};
+                for (const auto& [key, value] : {std::pair{"location", error.location}, {"code", error.code},
+                                                 {"help", error.help}, {"note", error.note},
+                                                 {"expected", error.expected}, {"actual", error.actual}}) {
+                    if (value.has_value()) {
+                        error_obj[key] = *value;
+                    }
+                }
+                test_obj["errors"].push_back(error_obj);
+            }
+            tests.push_back(test_obj);
+        }
+        modules.push_back({{"moduleId", module.module_id}, {"tests", tests}});
+    }
+    nlohmann::json expected = {{"testModules", modules}, {"reason", *output.reason}};
+
+    CHECK(output.to_json() == expected.dump());
+}
+
+TEST_CASE("invalid UTF-8 is replaced before serialization", "[transformer]") {
+    std::vector<tdd_guard::TestEvent> events = {{
+        .name = "Bytes", .full_name = "Caf\xE9.Bytes", .state = tdd_guard::TestEvent::State::Failed,
+        .failure_messages = {"buffer: \xFF\xFE\x01"}
+    }};
+
+    auto json = tdd_guard::transform_events(events, {}).to_json();
+    auto parsed = nlohmann::json::parse(json);
+
+    CHECK(parsed["testModules"][0]["moduleId"] == "Caf\xEF\xBF\xBD");
+    CHECK_THAT(parsed["testModules"][0]["tests"][0]["errors"][0]["message"].get<std::string>(),
+               ContainsSubstring("buffer: \xEF\xBF\xBD\xEF\xBF\xBD"));
+}
+
+TEST_CASE("modules differing only in invalid bytes are one module", "[transformer]") {
+    std::vector<tdd_guard::TestEvent> events = {
+        {.name = "A", .full_name = "Caf\xE9.A", .state = tdd_guard::TestEvent::State::Passed},
+        {.name = "B", .full_name = "Caf\xE8.B", .state = tdd_guard::TestEvent::State::Passed}
+    };
+
+    auto output = tdd_guard::transform_events(events, {});
+
+    REQUIRE(output.test_modules.size() == 1);
+    CHECK(output.test_modules[0].module_id == "Caf\xEF\xBF\xBD");
+    CHECK(output.test_modules[0].tests.size() == 2);
+}
+
+TEST_CASE("tests keep their order within interleaved modules", "[transformer]") {
+    std::vector<tdd_guard::TestEvent> events;
+    for (int i = 0; i < 100; ++i) {
+        events.push_back({.name = "T" + std::to_string(i), .full_name = "M" + std::to_string(i % 7) + ".T" + std::to_string(i),
+                          .state = tdd_guard::TestEvent::State::Passed});
+    }
+
+    auto output = tdd_guard::transform_events(events, {});
+
+    REQUIRE(output.test_modules.size() == 7);
+    for (int m = 0; m < 7; ++m) {
+        const auto& module = output.test_modules[static_cast<std::size_t>(m)];
+        CHECK(module.module_id == "M" + std::to_string(m));
+        for (std::size_t i = 0; i < module.tests.size(); ++i) {
+            CHECK(module.tests[i].name == "T" + std::to_string(m + 7 * static_cast<int>(i)));
+        }
+    }
+}
+
+TEST_CASE("parallel grouping produces the sequential output", "[transformer]") {
+    std::vector<tdd_guard::TestEvent> events;
+    for (int i = 0; i < 100000; ++i) {
+        const bool failed = i % 97 == 0;
+        events.push_back({
+            .name = "Case/" + std::to_string(i),
+            .full_name = "Suite" + std::to_string((i * 7919) % 1013) + ".Case/" + std::to_string(i),
+            .state = failed ? tdd_guard::TestEvent::State::Failed : tdd_guard::TestEvent::State::Passed,
+            .failure_messages = failed ? std::vector<std::string>{"failure " + std::to_string(i)}
+                                       : std::vector<std::string>{}
+        });
+    }
+    std::vector<tdd_guard::CompilationError> errors = {{.message = "warning treated as error"}};
+
+    const auto sequential = tdd_guard::transform_events(events, errors, 1).to_json();
+    const auto parallel = tdd_guard::transform_events(events, errors, 4).to_json();
+
+    CHECK(parallel == sequential);
+}
+
+TEST_CASE("durations are reported with the slowest tests and module totals", "[transformer][duration]") {
+    using std::chrono::microseconds;
+    std::vector<tdd_guard::TestEvent> events = {
+        {.name = "A", .full_name = "Fast.A", .state = tdd_guard::TestEvent::State::Passed, .duration = microseconds(1000)},
+        {.name = "B", .full_name = "Fast.B", .state = tdd_guard::TestEvent::State::Passed, .duration = microseconds(2500)},
+        {.name = "C", .full_name = "Slow.C", .state = tdd_guard::TestEvent::State::Passed, .duration = microseconds(900000)},
+        {.name = "D", .full_name = "Slow.D", .state = tdd_guard::TestEvent::State::Passed, .duration = microseconds(2500)},
+        {.name = "E", .full_name = "Untimed.E", .state = tdd_guard::TestEvent::State::Passed}
+    };
+
+    auto output = tdd_guard::transform_events(events, {});
+    REQUIRE(output.timing.has_value());
+
+    const auto& slowest = output.timing->slowest;
+    REQUIRE(slowest.size() == 4);
+    CHECK(slowest[0].full_name == "Slow.C");
+    CHECK(slowest[1].full_name == "Fast.B");
+    CHECK(slowest[2].full_name == "Slow.D");
+    CHECK(slowest[3].full_name == "Fast.A");
+
+    const auto& modules = output.timing->modules;
+    REQUIRE(modules.size() == 2);
+    CHECK(modules[0].module_id == "Fast");
+    CHECK(modules[0].duration == microseconds(3500));
+    CHECK(modules[1].module_id == "Slow");
+    CHECK(modules[1].duration == microseconds(902500));
+
+    auto json = nlohmann::json::parse(output.to_json());
+    CHECK(json["testModules"][0]["tests"][1]["duration"] == 2.5);
+    CHECK_FALSE(json["testModules"][2]["tests"][0].contains("duration"));
+    CHECK(json["timing"]["slowest"][0] == nlohmann::json{{"fullName", "Slow.C"}, {"duration", 900}});
+    CHECK(json["timing"]["modules"][1] == nlohmann::json{{"moduleId", "Slow"}, {"duration", 902.5}});
+}
+
+TEST_CASE("slowest list is capped", "[transformer][duration]") {
+    std::vector<tdd_guard::TestEvent> events;
+    for (int i = 0; i < 25; ++i) {
+        events.push_back({.name = "T" + std::to_string(i), .full_name = "M.T" + std::to_string(i),
+                          .state = tdd_guard::TestEvent::State::Passed, .duration = std::chrono::milliseconds(i)});
+    }
+
+    auto output = tdd_guard::transform_events(events, {});
+
+    REQUIRE(output.timing.has_value());
+    REQUIRE(output.timing->slowest.size() == tdd_guard::SLOWEST_TEST_COUNT);
+    CHECK(output.timing->slowest.front().full_name == "M.T24");
+    CHECK(output.timing->slowest.back().full_name == "M.T15");
+}
+
+TEST_CASE("output without durations has no timing", "[transformer][duration]") {
+    std::vector<tdd_guard::TestEvent> events = {
+        {.name = "A", .full_name = "M.A", .state = tdd_guard::TestEvent::State::Passed}
+    };
+
+    auto output = tdd_guard::transform_events(events, {});
+
+    CHECK_FALSE(output.timing.has_value());
+    CHECK_THAT(output.to_json(), !ContainsSubstring("timing"));
+}
+
+TEST_CASE("merged outputs read as one run", "[transformer]") {
+    using tdd_guard::TestEvent;
+    auto first = tdd_guard::transform_events({
+        {.name = "A", .full_name = "Math.A", .state = TestEvent::State::Passed, .duration = std::chrono::milliseconds(1)},
+        {.name = "A", .full_name = "Text.A", .state = TestEvent::State::Passed}
+    }, {});
+    tdd_guard::record_process_exit(first, {.exit_code = 0});
+    auto second = tdd_guard::transform_events({
+        {.name = "B", .full_name = "Math.B", .state = TestEvent::State::Failed,
+         .failure_messages = {"expected 2"}, .duration = std::chrono::milliseconds(3)}
+    }, {});
+    tdd_guard::record_process_exit(second, {.exit_code = 1});
+
+    std::vector<tdd_guard::TddGuardOutput> parts;
+    parts.push_back(std::move(first));
+    parts.push_back(std::move(second));
+    const auto merged = tdd_guard::merge_outputs(std::move(parts));
+
+    REQUIRE(merged.test_modules.size() == 2);
+    CHECK(merged.test_modules[0].module_id == "Math");
+    REQUIRE(merged.test_modules[0].tests.size() == 2);
+    CHECK(merged.test_modules[0].tests[1].full_name == "Math.B");
+    CHECK(merged.test_modules[1].module_id == "Text");
+    CHECK(merged.reason == "failed");
+    REQUIRE(merged.process.has_value());
+    CHECK(merged.process->exit_code == 1);
+    REQUIRE(merged.timing.has_value());
+    CHECK(merged.timing->slowest[0].full_name == "Math.B");
+}
+
+TEST_CASE("the worst exit is the one a signal ended", "[transformer]") {
+    const tdd_guard::ProcessExit passed{.exit_code = 0};
+    const tdd_guard::ProcessExit failed{.exit_code = 1};
+    const tdd_guard::ProcessExit killed{.signal = 9};
+
+    CHECK(tdd_guard::worst_exit(passed, failed).exit_code == 1);
+    CHECK(tdd_guard::worst_exit(failed, passed).exit_code == 1);
+    CHECK(tdd_guard::worst_exit(failed, killed).signal == 9);
+    CHECK(tdd_guard::worst_exit(killed, failed).signal == 9);
+}
+
+TEST_CASE("states read back as the names they were saved as", "[transformer]") {
+    using State = tdd_guard::TestEvent::State;
+    for (const auto state : {State::Passed, State::Failed, State::Skipped, State::Unknown}) {
+        CHECK(tdd_guard::parse_state(tdd_guard::state_name(state)) == state);
+    }
+    CHECK_FALSE(tdd_guard::parse_state("broken").has_value());
+}
@@ -0,0 +1,73 @@
+#include <catch2/catch_test_macros.hpp>
+#include "utf8.hpp"
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+
+namespace {
+
+const std::string FFFD = "\xEF\xBF\xBD";
+
+auto repaired(std::string text) -> std::string {
+    tdd_guard::repair_utf8(text);
+    return text;
+}
+
+// nlohmann validates while dumping, which makes it an independent oracle
+auto accepted_by_nlohmann(const std::string& text) -> bool {
+    try {
+        (void)nlohmann::json(text).dump();
+        return true;
+    } catch (const nlohmann::json::type_error&) {
+        return false;
+    }
+}
+
+} // anonymous namespace
+
+TEST_CASE("well-formed text is left untouched", "[utf8]") {
+    for (const std::string text : {std::string(), std::string("plain ascii that spans more than sixteen bytes"),
+                                   std::string("caf\xC3\xA9 \xE2\x9C\x93 \xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF"),
+                                   std::string("\xED\x9F\xBF\xEE\x80\x80"), std::string(1, '\0')}) {
+        auto copy = text;
+        CHECK(tdd_guard::is_valid_utf8(text));
+        CHECK_FALSE(tdd_guard::repair_utf8(copy));
+        CHECK(copy == text);
+    }
+}
+
+TEST_CASE("each maximal ill-formed subpart becomes one replacement", "[utf8]") {
+    // The example from the Unicode standard, section 3.9
+    CHECK(repaired("\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64") ==
+          "a" + FFFD + FFFD + FFFD + "b" + FFFD + "c" + FFFD + FFFD + "d");
+
+    CHECK(repaired("\xC0\xAF") == FFFD + FFFD);
+    CHECK(repaired("\xE0\x80\xAF") == FFFD + FFFD + FFFD);
+    CHECK(repaired("\xED\xA0\x80") == FFFD + FFFD + FFFD);
+    CHECK(repaired("\xF4\x90\x80\x80") == FFFD + FFFD + FFFD + FFFD);
+    CHECK(repaired("\xF5\xFF") == FFFD + FFFD);
+    CHECK(repaired("path/caf\xE9.cpp") == "path/caf" + FFFD + ".cpp");
+    CHECK(repaired("ends mid sequence \xF0\x9F\x98") == "ends mid sequence " + FFFD);
+}
+
+TEST_CASE("validation agrees with nlohmann on random bytes", "[utf8]") {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> length(0, 100);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> lead(0, 3);
+
+    for (int i = 0; i < 20000; ++i) {
+        std::string text;
+        for (int n = length(rng); n > 0; --n) {
+            // Bias towards ASCII and continuation bytes so valid sequences occur
+            const int pick = lead(rng);
+            text.push_back(static_cast<char>(pick == 0 ? byte(rng) & 0x7F : pick == 1 ? 0x80 | (byte(rng) & 0x3F) : byte(rng)));
+        }
+
+        INFO(i);
+        CHECK(tdd_guard::is_valid_utf8(text) == accepted_by_nlohmann(text));
+        auto fixed = repaired(text);
+        CHECK(tdd_guard::is_valid_utf8(fixed));
+        CHECK(accepted_by_nlohmann(fixed));
+    }
+}